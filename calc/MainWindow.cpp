@@ -1,6 +1,12 @@
 #include "MainWindow.h"
+#include "bigword.h"
+#include "divmagic.h"
+#include "format.h"
 
+#include <QClipboard>
+#include <QGuiApplication>
 #include <QLineEdit>
+#include <QMessageBox>
 #include <QLabel>
 #include <QPushButton>
 #include <QRadioButton>
@@ -8,17 +14,28 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
-#include <bitset>
+#include <QButtonGroup>
+#include <QKeyEvent>
+#include <QTimer>
+#include <QStringList>
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <future>
+#include <stdexcept>
 
 // helpers
-static QPushButton* makeBtn(const QString& t, MainWindow* r) {
+static QPushButton* makeBtn(const QString& t) {
     auto* b = new QPushButton(t);
     b->setFixedSize(52, 36);
-    QObject::connect(b, &QPushButton::clicked, r, &MainWindow::onButtonClicked);
     return b;
 }
 
+// the number theory ops are 64-bit; a wide value must fit them
+static bool fitsQword(const BigWord& v) {
+    return BigWord(v.low(), v.bits()) == v;
+}
+
 static QWidget* spacer() {
     auto* w = new QWidget();
     w->setFixedSize(52, 36);
@@ -29,7 +46,7 @@ void MainWindow::setError(const QString& msg)
 {
     error = true;
     errorText = msg;
-    display->setText(msg);
+    setDisplayText(msg);
     waitingForValue = true;
 }
 
@@ -50,6 +67,25 @@ MainWindow::MainWindow(QWidget* parent)
     bitView->setAlignment(Qt::AlignCenter);
     bitView->setStyleSheet("font-family: monospace;");
 
+    flagView = new QLabel();
+    flagView->setAlignment(Qt::AlignRight);
+    flagView->setStyleSheet("font-family: monospace;");
+
+    // all bases at once, scrolled rather than wrapped for wide words
+    auto* panel = new QGridLayout();
+    panel->setVerticalSpacing(2);
+    const char* panelNames[] = { "HEX", "DEC", "OCT", "BIN" };
+    for (int i = 0; i < 4; ++i) {
+        auto* field = new QLineEdit();
+        field->setReadOnly(true);
+        field->setFrame(false);
+        field->setAlignment(Qt::AlignRight);
+        field->setStyleSheet("font-family: monospace;");
+        basePanel[i] = field;
+        panel->addWidget(new QLabel(panelNames[i]), i, 0);
+        panel->addWidget(field, i, 1);
+    }
+
     // base
     rbHex = new QRadioButton("Hex");
     rbDec = new QRadioButton("Dec");
@@ -70,12 +106,14 @@ MainWindow::MainWindow(QWidget* parent)
     baseL->addWidget(rbBin);
 
     // word size
+    rbDqword = new QRadioButton("Dqword");
     rbQword = new QRadioButton("Qword");
     rbDword = new QRadioButton("Dword");
     rbWord  = new QRadioButton("Word");
     rbByte  = new QRadioButton("Byte");
     rbQword->setChecked(true);
 
+    connect(rbDqword, &QRadioButton::clicked, this, &MainWindow::onWordSizeChanged);
     connect(rbQword, &QRadioButton::clicked, this, &MainWindow::onWordSizeChanged);
     connect(rbDword, &QRadioButton::clicked, this, &MainWindow::onWordSizeChanged);
     connect(rbWord,  &QRadioButton::clicked, this, &MainWindow::onWordSizeChanged);
@@ -83,6 +121,7 @@ MainWindow::MainWindow(QWidget* parent)
 
     auto* wordBox = new QGroupBox();
     auto* wordL = new QVBoxLayout(wordBox);
+    wordL->addWidget(rbDqword);
     wordL->addWidget(rbQword);
     wordL->addWidget(rbDword);
     wordL->addWidget(rbWord);
@@ -97,47 +136,81 @@ MainWindow::MainWindow(QWidget* parent)
     auto* grid = new QGridLayout();
     grid->setSpacing(6);
 
-    auto B = [&](int r,int c,const char* t){
-        auto* b = makeBtn(t,this);
+    // every button is an Action id in one group, clicks and keys dispatch
+    // on the id and never look at the text
+    buttons = new QButtonGroup(this);
+    connect(buttons, &QButtonGroup::idClicked, this, &MainWindow::onButtonClicked);
+
+    magicPoll = new QTimer(this);
+    magicPoll->setInterval(50);
+    connect(magicPoll, &QTimer::timeout, this, &MainWindow::finishMagic);
+
+    auto bind = [&](QPushButton* b, Action a) {
+        buttons->addButton(b, static_cast<int>(a));
+        if (a <= Action::DigitF)
+            digitButtons[static_cast<size_t>(a)] = b;
+    };
+
+    auto B = [&](int r, int c, const char* t, Action a) {
+        auto* b = makeBtn(t);
         grid->addWidget(b, r, c);
-        if (QString("0123456789ABCDEF").contains(t))
-            registerDigit(b);
+        if (a != Action::None)
+            bind(b, a);
     };
 
 
     for (int r=0;r<6;r++) grid->addWidget(spacer(), r, 0);
 
     grid->addWidget(spacer(), 0, 1);
-    B(0,3,"A"); B(0,4,"MC"); B(0,5,"MR");
-    B(0,6,"MS"); B(0,7,"M+"); B(0,8,"M-");
+    B(0,3,"A",Action::DigitA); B(0,4,"MC",Action::MemoryClear); B(0,5,"MR",Action::MemoryRecall);
+    B(0,6,"MS",Action::MemoryStore); B(0,7,"M+",Action::MemoryAdd); B(0,8,"M-",Action::MemorySubtract);
 
-    B(1,1,"("); B(1,2,")"); B(1,3,"B"); B(1,4,"←");
-    B(1,5,"CE"); B(1,6,"Clear"); B(1,7,"±"); B(1,8,"√");
+    B(1,1,"(",Action::None); B(1,2,")",Action::None); B(1,3,"B",Action::DigitB); B(1,4,"←",Action::Backspace);
+    B(1,5,"CE",Action::ClearEntry); B(1,6,"Clear",Action::Clear); B(1,7,"±",Action::Negate); B(1,8,"√",Action::Sqrt);
 
-    B(2,1,"RoL"); B(2,2,"RoR"); B(2,3,"C");
-    B(2,4,"7"); B(2,5,"8"); B(2,6,"9"); B(2,7,"/"); B(2,8,"%");
+    B(2,1,"RoL",Action::Rol); B(2,2,"RoR",Action::Ror); B(2,3,"C",Action::DigitC);
+    B(2,4,"7",Action::Digit7); B(2,5,"8",Action::Digit8); B(2,6,"9",Action::Digit9);
+    B(2,7,"/",Action::Div); B(2,8,"%",Action::Mod);
 
-    B(3,1,"Or"); B(3,2,"Xor"); B(3,3,"D");
-    B(3,4,"4"); B(3,5,"5"); B(3,6,"6"); B(3,7,"*"); B(3,8,"1/x");
+    B(3,1,"Or",Action::Or); B(3,2,"Xor",Action::Xor); B(3,3,"D",Action::DigitD);
+    B(3,4,"4",Action::Digit4); B(3,5,"5",Action::Digit5); B(3,6,"6",Action::Digit6);
+    B(3,7,"*",Action::Mul); B(3,8,"1/x",Action::Reciprocal);
 
-    B(4,1,"Lsh"); B(4,2,"Rsh"); B(4,3,"E");
-    B(4,4,"1"); B(4,5,"2"); B(4,6,"3"); B(4,7,"-");
+    B(4,1,"Lsh",Action::Lsh); B(4,2,"Rsh",Action::Rsh); B(4,3,"E",Action::DigitE);
+    B(4,4,"1",Action::Digit1); B(4,5,"2",Action::Digit2); B(4,6,"3",Action::Digit3); B(4,7,"-",Action::Sub);
 
-    B(5,1,"Not"); B(5,2,"And"); B(5,3,"F");
+    B(5,1,"Not",Action::Not); B(5,2,"And",Action::And); B(5,3,"F",Action::DigitF);
 
-    auto* zero = makeBtn("0", this);
+    // bit manipulation
+    B(6,1,"Pop",Action::Popcount); B(6,2,"Par",Action::Parity); B(6,3,"Clz",Action::Clz); B(6,4,"Ctz",Action::Ctz);
+    B(6,5,"HiBit",Action::HighestBit); B(6,6,"LoBit",Action::LowestBit); B(6,7,"Blsr",Action::Blsr); B(6,8,"Blsi",Action::Blsi);
+    B(7,1,"BSwap",Action::Bswap); B(7,2,"BRev",Action::BitReverse); B(7,3,"PDep",Action::Pdep); B(7,4,"PExt",Action::Pext);
+    B(7,5,"Adc",Action::Adc); B(7,6,"Sbb",Action::Sbb); B(7,7,"x^y",Action::Pow);
+
+    // number theory
+    B(8,1,"Gcd",Action::Gcd); B(8,2,"Lcm",Action::Lcm); B(8,3,"ModInv",Action::ModInv);
+    B(8,4,"Prime",Action::Prime); B(8,5,"Factor",Action::Factor);
+
+    // modular mode: the displayed value becomes the modulus, 0 leaves it
+    B(8,6,"ModN",Action::ModN);
+
+    // C for dividing by the displayed value without a divide, signed and unsigned
+    B(8,7,"Magic",Action::Magic); B(8,8,"UMagic",Action::UMagic);
+
+    auto* zero = makeBtn("0");
     zero->setFixedSize(110, 36);
-    registerDigit(zero);
+    bind(zero, Action::Digit0);
     grid->addWidget(zero, 5, 4, 1, 2);
 
-    auto* dot = makeBtn(".", this);
+    auto* dot = makeBtn(".");
     dot->setFixedSize(52, 36);
     dot->setEnabled(false);
     grid->addWidget(dot, 5, 6);
-    B(5,7,"+");
+    B(5,7,"+",Action::Add);
 
-    auto* eq = makeBtn("=", this);
+    auto* eq = makeBtn("=");
     eq->setFixedSize(52, 78);
+    bind(eq, Action::Equals);
     grid->addWidget(eq, 4, 8, 2, 1);
 
     auto* center = new QHBoxLayout();
@@ -146,126 +219,393 @@ MainWindow::MainWindow(QWidget* parent)
 
     auto* main = new QVBoxLayout(this);
     main->addWidget(display);
+    main->addLayout(panel);
     main->addWidget(bitView);
+    main->addWidget(flagView);
     main->addLayout(center);
 
     setLayout(main);
     setFixedSize(sizeHint());
 
     onBaseChanged();
-    updateBitView();
+    refresh();
 }
 
 // window helpers
 
-void MainWindow::registerDigit(QPushButton* b)
+int MainWindow::wordBits() const
 {
-    digitButtons.insert(b->text(), b);
+    return rbByte->isChecked()   ? 8  :
+           rbWord->isChecked()   ? 16 :
+           rbDword->isChecked()  ? 32 :
+           rbDqword->isChecked() ? 128 : 64;
 }
 
-int MainWindow::wordBits() const
+ParseResult MainWindow::parseText(const QString& s) const
 {
-    return rbByte->isChecked()  ? 8  :
-           rbWord->isChecked()  ? 16 :
-           rbDword->isChecked() ? 32 : 64;
+    std::u16string_view text(reinterpret_cast<const char16_t*>(s.utf16()),
+                             static_cast<size_t>(s.size()));
+    return parseNumber(text, calc.getBase(), calc.getWordSize());
 }
 
 int64_t MainWindow::parseDisplay() const
 {
-    int base =
-        rbHex->isChecked() ? 16 :
-        rbOct->isChecked() ? 8  :
-        rbBin->isChecked() ? 2  : 10;
+    // the display is about to show the calculator's value
+    if (dirty & RefreshDisplay) return calc.getValue();
+
+    ParseResult r = parseText(display->text());
+    if (!r) return calc.getValue();
+
+    return r.value;
+}
+
+BigWord MainWindow::parseWideDisplay() const
+{
+    BigWord v = calc.getWide();
+    if (dirty & RefreshDisplay) return v;
+
+    BigWord r(0, v.bits());
+    if (bigword::parse(display->text().toStdString(), calc.getBase(), r) != ParseError::None)
+        return v;
 
-    bool ok = false;
-    qlonglong v = display->text().toLongLong(&ok, base);
-    if (!ok) return calc.getValue();
+    return r;
+}
 
-    return static_cast<int64_t>(v);
+// the pending operation with the displayed value, at the current width
+void MainWindow::applyDisplay()
+{
+    if (calc.isWide())
+        applyWideOperation(parseWideDisplay());
+    else
+        applyOperation(parseDisplay());
 }
 
 void MainWindow::applyOperation(int64_t value)
 {
     int64_t cur = calc.getValue();
+    OpError err = OpError::None;
 
-    try {
-        switch (pendingOp) {
+    switch (pendingOp) {
 
-            case Op::Add:
-                calc.add(cur, value);
-                break;
+        case Op::Add:
+            calc.add(cur, value);
+            break;
 
-            case Op::Sub:
-                calc.subtract(cur, value);
-                break;
+        case Op::Sub:
+            calc.subtract(cur, value);
+            break;
 
-            case Op::Mul:
-                calc.multiply(cur, value);
-                break;
+        case Op::Mul:
+            calc.multiply(cur, value);
+            break;
 
-            case Op::Div:
-                calc.divide(cur, value);
-                break;
+        case Op::Div:
+            err = calc.tryDivide(cur, value).error;
+            break;
 
-            case Op::Mod:
-                calc.mod(cur, value);
-                break;
+        case Op::Mod:
+            err = calc.tryMod(cur, value).error;
+            break;
 
-            case Op::And:
-                calc.bitAnd(cur, value);
-                break;
+        case Op::And:
+            calc.bitAnd(cur, value);
+            break;
 
-            case Op::Or:
-                calc.bitOr(cur, value);
-                break;
+        case Op::Or:
+            calc.bitOr(cur, value);
+            break;
 
-            case Op::Xor:
-                calc.bitXor(cur, value);
-                break;
+        case Op::Xor:
+            calc.bitXor(cur, value);
+            break;
 
-            case Op::Lsh:
-                calc.shl(cur, value);
-                break;
+        case Op::Lsh:
+            calc.shl(cur, value);
+            break;
 
-            case Op::Rsh:
-                calc.shr(cur, value);
-                break;
+        case Op::Rsh:
+            calc.shr(cur, value);
+            break;
 
-            case Op::None:
-                calc.add(0, value);
-                break;
-        }
+        case Op::Pdep:
+            calc.pdep(cur, value);
+            break;
+
+        case Op::Pext:
+            calc.pext(cur, value);
+            break;
+
+        case Op::Adc:
+            calc.adc(cur, value);
+            break;
+
+        case Op::Sbb:
+            calc.sbb(cur, value);
+            break;
+
+        case Op::Pow:
+            err = calc.tryPow(cur, value).error;
+            break;
+
+        case Op::PowMod:
+            err = calc.tryPowmod(cur, powExponent.low(), value).error;
+            break;
+
+        case Op::Gcd:
+            calc.gcd(cur, value);
+            break;
+
+        case Op::Lcm:
+            calc.lcm(cur, value);
+            break;
+
+        case Op::ModInv:
+            err = calc.tryModInverse(cur, value).error;
+            break;
 
+        case Op::None:
+            calc.add(0, value);
+            break;
     }
-    catch (...) {
+
+    if (err != OpError::None) {
+        setError("Error");
+        return;
+    }
+
+    markDirty(RefreshDisplay | RefreshViews);
+}
+
+
+void MainWindow::applyWideOperation(const BigWord& value)
+{
+    BigWord cur = calc.getWide();
+    int count = static_cast<int>(value.low());
+    OpError err = OpError::None;
+
+    switch (pendingOp) {
+
+        case Op::Add:
+            calc.add(cur, value);
+            break;
+
+        case Op::Sub:
+            calc.subtract(cur, value);
+            break;
+
+        case Op::Mul:
+            calc.multiply(cur, value);
+            break;
+
+        case Op::Div:
+            err = calc.tryDivide(cur, value).error;
+            break;
+
+        case Op::Mod:
+            err = calc.tryMod(cur, value).error;
+            break;
+
+        case Op::And:
+            calc.bitAnd(cur, value);
+            break;
+
+        case Op::Or:
+            calc.bitOr(cur, value);
+            break;
+
+        case Op::Xor:
+            calc.bitXor(cur, value);
+            break;
+
+        case Op::Lsh:
+            calc.shl(cur, count);
+            break;
+
+        case Op::Rsh:
+            calc.shr(cur, count);
+            break;
+
+        case Op::Pdep:
+            calc.pdep(cur, value);
+            break;
+
+        case Op::Pext:
+            calc.pext(cur, value);
+            break;
+
+        case Op::Adc:
+            calc.adc(cur, value);
+            break;
+
+        case Op::Sbb:
+            calc.sbb(cur, value);
+            break;
+
+        case Op::Pow:
+            err = calc.tryPow(cur, value).error;
+            break;
+
+        case Op::PowMod:
+            err = calc.tryPowmod(cur, powExponent.resized(cur.bits()), value).error;
+            break;
+
+        case Op::Gcd:
+        case Op::Lcm:
+        case Op::ModInv:
+            if (!fitsQword(cur) || !fitsQword(value)) {
+                setError("N/A");
+                return;
+            }
+            if (pendingOp == Op::Gcd) calc.gcd(cur.low(), value.low());
+            else if (pendingOp == Op::Lcm) calc.lcm(cur.low(), value.low());
+            else err = calc.tryModInverse(cur.low(), value.low()).error;
+            break;
+
+        case Op::None:
+            calc.setWide(value);
+            break;
+    }
+
+    if (err != OpError::None) {
         setError("Error");
         return;
     }
 
-    display->setText(QString::fromStdString(calc.display()));
-    updateBitView();
+    markDirty(RefreshDisplay | RefreshViews);
+}
+
+
+// Handlers only mark what they changed; the first mark queues one refresh()
+// for the next pass of the event loop and later ones join it, so a key that
+// sets the value and touches every view redraws each of them once.
+void MainWindow::markDirty(unsigned what)
+{
+    ++refreshStats.marks;
+    if (!dirty)
+        QTimer::singleShot(0, this, &MainWindow::refresh);
+    dirty |= what;
+}
+
+void MainWindow::refresh()
+{
+    const unsigned what = dirty;
+    if (!what)
+        return;
+    dirty = 0;
+    ++refreshStats.passes;
+
+    // the display text comes from baseTexts, which then match the display
+    // and only need showing on the panel
+    if (what & RefreshDisplay) {
+        baseTexts.set(calc);
+        display->setText(QString::fromStdString(baseTexts.text(calc.getBase())));
+    }
+    if (what & RefreshBits)
+        updateBitView();
+    if (what & RefreshFlags)
+        updateFlagView();
+    if ((what & RefreshBases) && !(what & RefreshDisplay))
+        updateBasePanel();
+    else if (what & (RefreshBases | RefreshBaseTexts))
+        showBasePanel();
+    if (what & RefreshDigits)
+        updateDigitButtons();
+
+    const RefreshStats& r = refreshStats;
+    bitView->setToolTip(QString("%1 refresh requests, %2 passes, %3 coalesced, %4 views already current")
+                            .arg(r.marks).arg(r.passes).arg(r.marks - r.passes).arg(r.unchanged));
+}
+
+// the display text once the pending refresh has run
+QString MainWindow::displayText() const
+{
+    if (dirty & RefreshDisplay)
+        return QString::fromStdString(calc.display());
+    return display->text();
+}
+
+// text the display shows in place of the calculator's value
+void MainWindow::setDisplayText(const QString& s)
+{
+    dirty &= ~RefreshDisplay;
+    display->setText(s);
 }
 
 
 void MainWindow::updateBitView()
 {
-    int wordBits =
-        rbByte->isChecked()  ? 8  :
-        rbWord->isChecked()  ? 16 :
-        rbDword->isChecked() ? 32 : 64;
-
-    std::bitset<64> bits(static_cast<uint64_t>(calc.getValue()));
-    QString s;
-
-    for (int i = 63; i >= 0; --i) {
-        if (i < wordBits)
-            s += QChar(bits[i] ? '1' : '0');
-        else
-            s += QChar(0x00B7); // ·
-        if (i % 4 == 0) s += ' ';
+    int bits = wordBits();
+
+    // narrow values come sign-extended to 128 bits
+    BigWord wide = calc.getWide().resized(128);
+    if (bits == bitViewBits && wide == bitViewShown) {
+        ++refreshStats.unchanged;
+        return;
+    }
+    bitViewBits = bits;
+    bitViewShown = wide;
+
+    // Latin-1: a char per bit, · above the word, a space after each nibble
+    int shown = bits > 64 ? 128 : 64;
+    char s[128 + 128 / 4];
+    size_t n = 0;
+
+    for (int i = shown - 1; i >= 0; --i) {
+        uint64_t limb = wide.limbs()[static_cast<size_t>(i / 64)];
+        s[n++] = i < bits ? static_cast<char>('0' + ((limb >> (i % 64)) & 1)) : '\xB7';
+        if (i == 64) s[n++] = '\n';
+        else if (i % 4 == 0) s[n++] = ' ';
+    }
+
+    bitView->setText(QString::fromLatin1(s, static_cast<qsizetype>(n)));
+}
+
+// the flags belong to the value the bit view shows; set ones are upper case
+void MainWindow::updateFlagView()
+{
+    static const struct { uint32_t bit; const char* name; } shown[] = {
+        { flags::CF, "cf" }, { flags::OF, "of" }, { flags::ZF, "zf" },
+        { flags::SF, "sf" }, { flags::PF, "pf" },
+    };
+
+    uint32_t f = calc.getFlags();
+    QStringList s;
+    for (const auto& flag : shown) {
+        QString name = flag.name;
+        s << ((f & flag.bit) ? name.toUpper() : name);
+    }
+
+    if (int64_t m = calc.getModulus())
+        s << QString("mod %1").arg(m);
+
+    flagView->setText(s.join(' '));
+}
+
+// The panel follows the display, typed digits included. BaseTexts formats
+// a base only when the value or the width really changed, so keystrokes
+// that leave the value alone and repeated refreshes touch no text.
+void MainWindow::updateBasePanel()
+{
+    if (calc.isWide())
+        baseTexts.set(parseWideDisplay());
+    else
+        baseTexts.set(static_cast<uint64_t>(parseDisplay()), calc.getWordSize());
+    showBasePanel();
+}
+
+// baseTexts on the panel, unless it shows them already
+void MainWindow::showBasePanel()
+{
+    if (baseTexts.changes() == basePanelShown) {
+        ++refreshStats.unchanged;
+        return;
     }
+    basePanelShown = baseTexts.changes();
 
-    bitView->setText(s);
+    basePanel[0]->setText(QString::fromStdString(baseTexts.text(NumberBase::HEX)));
+    basePanel[1]->setText(QString::fromStdString(baseTexts.text(NumberBase::DEC)));
+    basePanel[2]->setText(QString::fromStdString(baseTexts.text(NumberBase::OCT)));
+    basePanel[3]->setText(QString::fromStdString(baseTexts.groupedBinary()));
 }
 
 void MainWindow::updateDigitButtons()
@@ -275,256 +615,471 @@ void MainWindow::updateDigitButtons()
         rbOct->isChecked() ? 8 :
         rbDec->isChecked() ? 10 : 16;
 
-    for (auto it = digitButtons.begin(); it != digitButtons.end(); ++it) {
-        QString k = it.key();
-        int v = k[0].isDigit() ? k.toInt() : (k[0].unicode() - 'A' + 10);
-        it.value()->setEnabled(v < max);
+    if (max == digitsShown) {
+        ++refreshStats.unchanged;
+        return;
     }
+    digitsShown = max;
+
+    for (int d = 0; d < 16; ++d)
+        digitButtons[static_cast<size_t>(d)]->setEnabled(d < max);
 }
 
 
-void MainWindow::onButtonClicked()
+// keys that type a character, as the action of the button with that text;
+// the rest are None. Return, Backspace and the like are in keyPressEvent().
+static const auto keyActions = [] {
+    using A = MainWindow::Action;
+    std::array<A, 128> t;
+    t.fill(A::None);
+    for (int d = 0; d < 10; ++d)
+        t[static_cast<size_t>('0' + d)] = static_cast<A>(d);
+    for (int d = 10; d < 16; ++d) {
+        t[static_cast<size_t>('A' + d - 10)] = static_cast<A>(d);
+        t[static_cast<size_t>('a' + d - 10)] = static_cast<A>(d);
+    }
+    t['+'] = A::Add;   t['-'] = A::Sub;  t['*'] = A::Mul;  t['/'] = A::Div;
+    t['%'] = A::Mod;   t['&'] = A::And;  t['|'] = A::Or;   t['^'] = A::Xor;
+    t['<'] = A::Lsh;   t['>'] = A::Rsh;  t['~'] = A::Not;  t['='] = A::Equals;
+    return t;
+}();
+
+static int radix(NumberBase b)
 {
-    auto* b = qobject_cast<QPushButton*>(sender());
-    if (!b) return;
+    switch (b) {
+        case NumberBase::BIN: return 2;
+        case NumberBase::OCT: return 8;
+        case NumberBase::DEC: return 10;
+        case NumberBase::HEX: return 16;
+    }
+    return 10;
+}
 
-    QString t = b->text();
 
-    // only allow clear on error
-    if (error) {
+void MainWindow::onButtonClicked(int id)
+{
+    runAction(static_cast<Action>(id));
+}
 
-        if (t == "CE") {
-            error = false;
-            display->setText("0");
-            waitingForValue = true;
-            updateBitView();
-            updateDigitButtons();
-            return;
-        }
+void MainWindow::keyPressEvent(QKeyEvent* e)
+{
+    if (e->matches(QKeySequence::Paste)) {
+        typeText(QGuiApplication::clipboard()->text());
+        return;
+    }
 
-        if (t == "Clear") {
-            error = false;
-            calc = Calculator();
-            pendingOp = Op::None;
-            display->setText("0");
-            waitingForValue = true;
-            updateBitView();
-            updateDigitButtons();
-            return;
+    Action a = Action::None;
+    switch (e->key()) {
+        case Qt::Key_Return:
+        case Qt::Key_Enter:     a = Action::Equals; break;
+        case Qt::Key_Backspace: a = Action::Backspace; break;
+        case Qt::Key_Delete:    a = Action::ClearEntry; break;
+        case Qt::Key_Escape:    a = Action::Clear; break;
+        default: {
+            QString t = e->text();
+            if (t.size() == 1 && t[0].unicode() < keyActions.size())
+                a = keyActions[t[0].unicode()];
         }
+    }
 
+    if (a == Action::None) {
+        QWidget::keyPressEvent(e);
         return;
     }
+    runAction(a);
+}
 
-    // digits
-    if (digitButtons.contains(t)) {
+// Appends digit d to the number being typed. A digit of another base, or
+// one that would not fit the word size, is ignored and false returned.
+// The value is parsed once, here, and handed to the base panel cache.
+bool MainWindow::typeDigit(int d)
+{
+    if (d >= radix(calc.getBase()))
+        return false;
+
+    QChar c = QLatin1Char("0123456789ABCDEF"[d]);
+    QString s = waitingForValue ? QString(c) : displayText() + c;
+
+    if (calc.isWide()) {
+        BigWord v = calc.getWide();
+        ParseError err = bigword::parse(s.toStdString(), calc.getBase(), v);
+        if (err == ParseError::Overflow)
+            return false;
+        baseTexts.set(err == ParseError::None ? v : calc.getWide());
+    }
+    else {
+        ParseResult r = parseText(s);
+        if (r.error == ParseError::Overflow)
+            return false;
+        baseTexts.set(static_cast<uint64_t>(r ? r.value : calc.getValue()), calc.getWordSize());
+    }
+
+    setDisplayText(s);
+    waitingForValue = false;
+    return true;
+}
 
-        display->setText(waitingForValue ? t : display->text() + t);
-        waitingForValue = false;
+// pasted text: its digits are typed and the rest skipped, with one panel
+// refresh at the end
+void MainWindow::typeText(const QString& text)
+{
+    if (error)
         return;
+
+    bool typed = false;
+    for (QChar c : text) {
+        if (c.unicode() >= keyActions.size())
+            continue;
+        Action a = keyActions[c.unicode()];
+        if (a <= Action::DigitF)
+            typed |= typeDigit(static_cast<int>(a));
     }
+    if (typed)
+        markDirty(RefreshBaseTexts);
+}
+
+// the calculator's value on the display, taken as a finished number
+void MainWindow::showResult()
+{
+    waitingForValue = true;
+    markDirty(RefreshDisplay | RefreshViews);
+}
 
-    // backspace
-    if (t == "←") {
+void MainWindow::runAction(Action a)
+{
+    // only allow clear on error
+    if (error && a != Action::ClearEntry && a != Action::Clear)
+        return;
 
-        if (waitingForValue) return;
+    // digits
+    if (a <= Action::DigitF) {
+        if (typeDigit(static_cast<int>(a)))
+            markDirty(RefreshBaseTexts);
+        return;
+    }
 
-        QString s = display->text();
+    // operators
+    if (a >= Action::Add) {
 
-        if (s.size() <= 1) {
-            display->setText("0");
+        // Mod right after x^y and its exponent takes a modulus next, so the
+        // power is reduced as it is built instead of wrapping first
+        if (a == Action::Mod && pendingOp == Op::Pow && !waitingForValue) {
+            powExponent = calc.isWide() ? parseWideDisplay() : BigWord(parseDisplay(), BigWord::minBits);
+            pendingOp = Op::PowMod;
             waitingForValue = true;
+            return;
         }
-        else {
-            s.chop(1);
 
-            if (s == "-") {
-                display->setText("0");
+        if (!waitingForValue)
+            applyDisplay();
+
+        // the binary operations, in Action order from Action::Add
+        static constexpr Op actionOps[] = {
+            Op::Add, Op::Sub, Op::Mul, Op::Div, Op::Mod, Op::And, Op::Or, Op::Xor,
+            Op::Lsh, Op::Rsh, Op::Pdep, Op::Pext, Op::Adc, Op::Sbb, Op::Pow,
+            Op::Gcd, Op::Lcm, Op::ModInv,
+        };
+        static_assert(std::size(actionOps) == static_cast<size_t>(Action::Count) - static_cast<size_t>(Action::Add));
+
+        pendingOp = actionOps[static_cast<size_t>(a) - static_cast<size_t>(Action::Add)];
+        waitingForValue = true;
+        return;
+    }
+
+    // bit manipulation on the displayed value
+    auto bitOp = [&](auto fn) {
+
+        if (calc.isWide()) fn(parseWideDisplay());
+        else fn(parseDisplay());
+
+        showResult();
+    };
+
+    switch (a) {
+
+        case Action::Backspace: {
+
+            if (waitingForValue) return;
+
+            QString s = displayText();
+
+            if (s.size() <= 1) {
+                setDisplayText("0");
                 waitingForValue = true;
             }
             else {
-                display->setText(s);
+                s.chop(1);
+
+                if (s == "-") {
+                    setDisplayText("0");
+                    waitingForValue = true;
+                }
+                else {
+                    setDisplayText(s);
+                }
             }
-        }
 
-        updateBitView();
-        return;
-    }
+            markDirty(RefreshViews);
+            return;
+        }
 
-    // memory
-    if (t == "MC") {
-        memory = 0;
-        hasMemory = false;
-        return;
-    }
+        // clear display
+        case Action::ClearEntry:
+            error = false;
+            setDisplayText("0");
+            waitingForValue = true;
+            markDirty(RefreshViews | RefreshDigits);
+            return;
 
-    if (t == "MR") {
+        // clear all
+        case Action::Clear:
+            calc = Calculator();
+            pendingOp = Op::None;
+            error = false;
+            setDisplayText("0");
+            waitingForValue = true;
+            markDirty(RefreshViews | RefreshDigits);
+            return;
 
-        if (!hasMemory) return;
+        // memory
+        case Action::MemoryClear:
+            memory = 0;
+            hasMemory = false;
+            return;
 
-        // behave like typing a number
-        display->setText(QString::number(memory));
+        case Action::MemoryRecall:
 
-        waitingForValue = false;
+            if (!hasMemory) return;
 
-        updateBitView();
-        return;
-    }
+            // behave like typing a number
+            setDisplayText(QString::number(memory));
 
+            waitingForValue = false;
 
-    if (t == "MS") {
-        memory = parseDisplay();
-        hasMemory = true;
-        return;
-    }
+            markDirty(RefreshViews);
+            return;
 
-    if (t == "M+") {
-        memory = (hasMemory ? memory : 0) + parseDisplay();
-        hasMemory = true;
-        return;
-    }
+        case Action::MemoryStore:
+            memory = parseDisplay();
+            hasMemory = true;
+            return;
 
-    if (t == "M-") {
-        memory = (hasMemory ? memory : 0) - parseDisplay();
-        hasMemory = true;
-        return;
-    }
+        case Action::MemoryAdd:
+            memory = (hasMemory ? memory : 0) + parseDisplay();
+            hasMemory = true;
+            return;
 
-    // change sign
-    if (t == "±") {
+        case Action::MemorySubtract:
+            memory = (hasMemory ? memory : 0) - parseDisplay();
+            hasMemory = true;
+            return;
 
-        calc.setValue(-parseDisplay());
+        // change sign
+        case Action::Negate:
 
-        display->setText(QString::fromStdString(calc.display()));
-        waitingForValue = true;
-        updateBitView();
-        return;
-    }
+            if (calc.isWide()) {
+                BigWord v = parseWideDisplay();
+                calc.subtract(BigWord(0, v.bits()), v);
+            }
+            else {
+                calc.setValue(-parseDisplay());
+            }
 
-    // NOT
-    if (t == "Not") {
+            showResult();
+            return;
 
-        calc.bitNot(parseDisplay());
+        case Action::Not:
+            if (calc.isWide()) calc.bitNot(parseWideDisplay());
+            else calc.bitNot(parseDisplay());
+            showResult();
+            return;
 
-        display->setText(QString::fromStdString(calc.display()));
-        waitingForValue = true;
-        updateBitView();
-        return;
-    }
+        case Action::Rol:
+            if (calc.isWide()) calc.rol(parseWideDisplay(), 1);
+            else calc.rol(parseDisplay(), 1);
+            showResult();
+            return;
 
-    // ROL
-    if (t == "RoL") {
+        case Action::Ror:
+            if (calc.isWide()) calc.ror(parseWideDisplay(), 1);
+            else calc.ror(parseDisplay(), 1);
+            showResult();
+            return;
 
-        calc.rol(parseDisplay(), 1);
+        case Action::Sqrt: {
 
-        display->setText(QString::fromStdString(calc.display()));
-        waitingForValue = true;
-        updateBitView();
-        return;
-    }
+            OpError err = calc.isWide() ? calc.tryIsqrt(parseWideDisplay()).error
+                                        : calc.tryIsqrt(parseDisplay()).error;
+            if (err != OpError::None) {
+                setError("N/A");
+                return;
+            }
 
-    // ROR
-    if (t == "RoR") {
+            showResult();
+            return;
+        }
 
-        calc.ror(parseDisplay(), 1);
+        // RECIPROCAL 1/x
+        case Action::Reciprocal: {
 
-        display->setText(QString::fromStdString(calc.display()));
-        waitingForValue = true;
-        updateBitView();
-        return;
-    }
+            OpError err = calc.isWide() ? calc.tryReciprocal(parseWideDisplay()).error
+                                        : calc.tryReciprocal(parseDisplay()).error;
+            if (err != OpError::None) {
+                setError("N/A");
+                return;
+            }
 
+            showResult();
+            return;
+        }
 
-    // SQRT
-    if (t == "√") {
+        case Action::Popcount:   return bitOp([&](const auto& v) { calc.popcount(v); });
+        case Action::Parity:     return bitOp([&](const auto& v) { calc.parity(v); });
+        case Action::Clz:        return bitOp([&](const auto& v) { calc.clz(v); });
+        case Action::Ctz:        return bitOp([&](const auto& v) { calc.ctz(v); });
+        case Action::HighestBit: return bitOp([&](const auto& v) { calc.highestBit(v); });
+        case Action::LowestBit:  return bitOp([&](const auto& v) { calc.lowestBit(v); });
+        case Action::Blsr:       return bitOp([&](const auto& v) { calc.blsr(v); });
+        case Action::Blsi:       return bitOp([&](const auto& v) { calc.blsi(v); });
+        case Action::Bswap:      return bitOp([&](const auto& v) { calc.bswap(v); });
+        case Action::BitReverse: return bitOp([&](const auto& v) { calc.bitReverse(v); });
+
+        // primality test, 1 or 0
+        case Action::Prime: {
+
+            BigWord v = calc.isWide() ? parseWideDisplay() : BigWord(parseDisplay(), BigWord::minBits);
+            if (!fitsQword(v)) {
+                setError("N/A");
+                return;
+            }
 
-        try {
-            calc.isqrt(parseDisplay());
+            calc.isPrime(v.low());
+            showResult();
+            return;
         }
-        catch (...) {
-            setError("N/A");
+
+        // the prime factors of |x| in place of the value, which stays current
+        case Action::Factor: {
+
+            BigWord v = calc.isWide() ? parseWideDisplay() : BigWord(parseDisplay(), BigWord::minBits);
+            if (!fitsQword(v)) {
+                setError("N/A");
+                return;
+            }
+
+            if (calc.isWide()) calc.setWide(v);
+            else calc.setValue(v.low());
+
+            QStringList parts;
+            for (int64_t f : calc.factor(v.low())) {
+                char buf[maxDisplayLength];
+                size_t n = formatValue(buf, static_cast<uint64_t>(f), WordSize::QWORD, calc.getBase());
+                parts << QString::fromLatin1(buf, static_cast<qsizetype>(n));
+            }
+
+            if (parts.isEmpty()) markDirty(RefreshDisplay);
+            else setDisplayText(parts.join(QChar(0x00D7)));   // ×
+            waitingForValue = true;
+            markDirty(RefreshViews);
             return;
         }
 
-        display->setText(QString::fromStdString(calc.display()));
-        waitingForValue = true;
-        updateBitView();
-        return;
-    }
+        // enter or leave modular mode
+        case Action::ModN: {
 
-    // RECIPROCAL 1/x
-    if (t == "1/x") {
+            BigWord v = calc.isWide() ? parseWideDisplay() : BigWord(parseDisplay(), BigWord::minBits);
+            if (!fitsQword(v) || v.isNegative()) {
+                setError("N/A");
+                return;
+            }
 
-        try {
-            calc.reciprocal(parseDisplay());
+            calc.setModulus(v.low());
+            waitingForValue = true;
+            markDirty(RefreshFlags);
+            return;
         }
-        catch (...) {
-            setError("N/A");
+
+        // the magic multiplier for x as a divisor, shown as C and copied to the
+        // clipboard; the value stays as it is
+        case Action::Magic:
+        case Action::UMagic: {
+
+            if (calc.isWide()) {
+                setError("N/A");
+                return;
+            }
+
+            // at DWORD divisionMagic() checks every dividend, seconds of
+            // work, so it runs on a copy of calc off the UI thread and
+            // finishMagic() picks the result up
+            if (magicJob.valid())
+                return;
+
+            magicSigned = a == Action::Magic;
+            magicJob = std::async(std::launch::async, [c = calc, d = parseDisplay(), s = magicSigned] {
+                return c.divisionMagic(d, s);
+            });
+            setMagicRunning(true);
+            waitingForValue = true;
             return;
         }
 
-        display->setText(QString::fromStdString(calc.display()));
-        waitingForValue = true;
-        updateBitView();
-        return;
-    }
+        // equal
+        case Action::Equals:
 
-    // clear display
-    if (t == "CE") {
+            if (!waitingForValue)
+                applyDisplay();
 
-        error = false;
-        display->setText("0");
-        waitingForValue = true;
-        updateBitView();
-        updateDigitButtons();
-        return;
-    }
+            pendingOp = Op::None;
+            waitingForValue = true;
+            return;
 
-    // clear all
-    if (t == "Clear") {
+        default:
+            return;
+    }
+}
 
-        calc = Calculator();
-        pendingOp = Op::None;
-        error = false;
-        display->setText("0");
-        waitingForValue = true;
-        updateBitView();
-        updateDigitButtons();
-        return;
+void MainWindow::setMagicRunning(bool running)
+{
+    buttons->button(static_cast<int>(Action::Magic))->setEnabled(!running);
+    buttons->button(static_cast<int>(Action::UMagic))->setEnabled(!running);
+    if (running) {
+        setCursor(Qt::BusyCursor);
+        magicPoll->start();
     }
+    else {
+        unsetCursor();
+        magicPoll->stop();
+    }
+}
 
-    // equal
-    if (t == "=") {
+// the C for the magic multiplier, copied to the clipboard; the value stays
+// as it is
+void MainWindow::finishMagic()
+{
+    if (magicJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
 
-        if (!waitingForValue)
-            applyOperation(parseDisplay());
+    setMagicRunning(false);
 
-        pendingOp = Op::None;
-        waitingForValue = true;
+    DivisionMagic m;
+    try {
+        m = magicJob.get();
+    }
+    catch (const std::invalid_argument& ex) {
+        setError(ex.what());
         return;
     }
 
-    // operators
-    auto op = [&](Op o) {
-
-        if (!waitingForValue)
-            applyOperation(parseDisplay());
-
-        pendingOp = o;
-        waitingForValue = true;
-    };
+    QString code = QString::fromStdString(divmagic::toC(m));
+    QGuiApplication::clipboard()->setText(code);
 
-    if (t == "+")   op(Op::Add);
-    if (t == "-")   op(Op::Sub);
-    if (t == "*")   op(Op::Mul);
-    if (t == "/")   op(Op::Div);
-    if (t == "Mod") op(Op::Mod);
-    if (t == "And") op(Op::And);
-    if (t == "Or")  op(Op::Or);
-    if (t == "Xor") op(Op::Xor);
-    if (t == "Lsh") op(Op::Lsh);
-    if (t == "Rsh") op(Op::Rsh);
-    if (t == "%")   op(Op::Mod);
+    QMessageBox box(QMessageBox::Information, magicSigned ? "Magic" : "UMagic", code,
+                    QMessageBox::Ok, this);
+    box.setTextFormat(Qt::PlainText);
+    box.setTextInteractionFlags(Qt::TextSelectableByMouse);
+    box.setStyleSheet("QLabel { font-family: monospace; }");
+    box.exec();
 }
 
 void MainWindow::onBaseChanged()
@@ -534,9 +1089,8 @@ void MainWindow::onBaseChanged()
     else if (rbOct->isChecked()) calc.setBase(NumberBase::OCT);
     else if (rbBin->isChecked()) calc.setBase(NumberBase::BIN);
 
-    display->setText(QString::fromStdString(calc.display()));
-    updateDigitButtons();
-    updateBitView();
+    // the panel has usually formatted this base already, see refresh()
+    markDirty(RefreshDisplay | RefreshViews | RefreshDigits);
 }
 
 void MainWindow::onWordSizeChanged()
@@ -545,7 +1099,7 @@ void MainWindow::onWordSizeChanged()
     if (rbWord->isChecked())  calc.setWordSize(WordSize::WORD);
     if (rbDword->isChecked()) calc.setWordSize(WordSize::DWORD);
     if (rbQword->isChecked()) calc.setWordSize(WordSize::QWORD);
+    if (rbDqword->isChecked()) calc.setWordSize(WordSize::DQWORD);
 
-    display->setText(QString::fromStdString(calc.display()));
-    updateBitView();
+    markDirty(RefreshDisplay | RefreshViews);
 }
@@ -1,14 +1,20 @@
 #pragma once
 
 #include <QWidget>
-#include <QMap>
+#include <array>
 #include <cstdint>
+#include <future>
+#include "bigword.h"
 #include "calculator.h"
+#include "format.h"
 
+class QButtonGroup;
+class QKeyEvent;
 class QLineEdit;
 class QLabel;
 class QPushButton;
 class QRadioButton;
+class QTimer;
 
 class MainWindow : public QWidget {
     Q_OBJECT
@@ -16,18 +22,72 @@ class MainWindow : public QWidget {
 public:
     explicit MainWindow(QWidget* parent = nullptr);
 
+    // What a button or key does, its id in the button group. The digits are
+    // their own values and the binary operations come last, from Add on.
+    enum class Action {
+        Digit0, Digit1, Digit2, Digit3, Digit4, Digit5, Digit6, Digit7,
+        Digit8, Digit9, DigitA, DigitB, DigitC, DigitD, DigitE, DigitF,
+        None,
+        Backspace, ClearEntry, Clear,
+        MemoryClear, MemoryRecall, MemoryStore, MemoryAdd, MemorySubtract,
+        Negate, Not, Rol, Ror, Sqrt, Reciprocal,
+        Popcount, Parity, Clz, Ctz, HighestBit, LowestBit, Blsr, Blsi, Bswap, BitReverse,
+        Prime, Factor, ModN, Magic, UMagic,
+        Equals,
+        Add, Sub, Mul, Div, Mod, And, Or, Xor, Lsh, Rsh, Pdep, Pext, Adc, Sbb, Pow,
+        Gcd, Lcm, ModInv,
+        Count
+    };
+
 public slots:
-    void onButtonClicked();
+    void onButtonClicked(int id);
     void onBaseChanged();
     void onWordSizeChanged();
+    void refresh();
+    void finishMagic();
+
+protected:
+    // the buttons' actions from the keyboard; paste types the digits
+    void keyPressEvent(QKeyEvent* e) override;
 
 private:
     // ui
     QLineEdit* display;
     QLabel* bitView;
+    QLabel* flagView;
+
+    // the displayed value in HEX, DEC, OCT and BIN, in that order
+    std::array<QLineEdit*, 4> basePanel;
+    BaseTexts baseTexts;
+    size_t basePanelShown = 0;      // baseTexts.changes() the panel shows
+
+    // What refresh() redraws on the next pass of the event loop. Handlers
+    // mark instead of drawing, see markDirty().
+    enum Refresh : unsigned {
+        RefreshDisplay   = 1 << 0,  // the display shows calc's value
+        RefreshBits      = 1 << 1,
+        RefreshFlags     = 1 << 2,
+        RefreshBases     = 1 << 3,  // the base panel, from the display text
+        RefreshBaseTexts = 1 << 4,  // the base panel, baseTexts already set
+        RefreshDigits    = 1 << 5,  // digit buttons enabled for the base
+        RefreshViews     = RefreshBits | RefreshFlags | RefreshBases,
+    };
+    unsigned dirty = 0;
+
+    // how much drawing the coalescing saved, in the bit view's tooltip
+    struct RefreshStats {
+        size_t marks = 0;       // markDirty() calls
+        size_t passes = 0;      // refresh() runs that drew something
+        size_t unchanged = 0;   // views a pass found already current
+    } refreshStats;
+
+    // what the bit view and the digit buttons show
+    BigWord bitViewShown;
+    int bitViewBits = 0;
+    int digitsShown = 0;
 
     QRadioButton *rbHex, *rbDec, *rbOct, *rbBin;
-    QRadioButton *rbQword, *rbDword, *rbWord, *rbByte;
+    QRadioButton *rbDqword, *rbQword, *rbDword, *rbWord, *rbByte;
 
     // calculator
     Calculator calc;
@@ -42,19 +102,46 @@ private:
         Add, Sub, Mul, Div, Mod,
         And, Or, Xor,
         Lsh, Rsh,
-        Pow
+        Pdep, Pext,
+        Adc, Sbb,
+        Pow,
+        PowMod,     // a x^y e Mod m: a^e mod m, the power itself never formed
+        Gcd, Lcm, ModInv
     };
     int wordBits() const;
     Op pendingOp = Op::None;
+    BigWord powExponent;    // e while a PowMod waits for its modulus
     bool waitingForValue = true;
 
 
-    QMap<QString, QPushButton*> digitButtons;
+    QButtonGroup* buttons;
+
+    // the Magic/UMagic check in flight, polled by magicPoll; the two
+    // buttons are disabled until it finishes
+    std::future<DivisionMagic> magicJob;
+    bool magicSigned = false;
+    QTimer* magicPoll;
+    void setMagicRunning(bool running);
+    std::array<QPushButton*, 16> digitButtons{};   // by digit value
 
     // helpers
+    ParseResult parseText(const QString& s) const;
     int64_t parseDisplay() const;
+    BigWord parseWideDisplay() const;
     void applyOperation(int64_t value);
+    void applyWideOperation(const BigWord& value);
+    void applyDisplay();
+    void markDirty(unsigned what);
+    QString displayText() const;
+    void setDisplayText(const QString& s);
     void updateBitView();
+    void updateFlagView();
+    void updateBasePanel();
     void updateDigitButtons();
-    void registerDigit(QPushButton* b);
+    void showBasePanel();
+    void showResult();
+
+    void runAction(Action a);
+    bool typeDigit(int d);
+    void typeText(const QString& text);
 };
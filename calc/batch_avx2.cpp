@@ -0,0 +1,10 @@
+// Batch kernels for AVX2, BMI1/2 and LZCNT; built with
+// -mavx2 -mbmi -mbmi2 -mlzcnt -mpopcnt (/arch:AVX2 on MSVC).
+#if defined(__x86_64__) || defined(_M_X64)
+#if !defined(__AVX2__)
+#error "batch_avx2.cpp needs -mavx2 -mbmi -mbmi2 -mlzcnt -mpopcnt, see CMakeLists.txt"
+#endif
+#define CALC_BATCH_NAME avx2
+#define CALC_BATCH_LEVEL IsaLevel::AVX2
+#include "batch_kernels.inc"
+#endif
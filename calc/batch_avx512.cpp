@@ -0,0 +1,14 @@
+// Batch kernels for AVX-512 F/CD/BW/DQ/VL; built with the AVX2 flags plus
+// -mavx512f -mavx512cd -mavx512bw -mavx512dq -mavx512vl (/arch:AVX512 on MSVC).
+#if defined(__x86_64__) || defined(_M_X64)
+#if !defined(__AVX512F__) || !defined(__AVX512BW__)
+#error "batch_avx512.cpp needs the AVX-512 flags, see CMakeLists.txt"
+#endif
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC 12's avx512fintrin.h trips this on its own undefined-vector helpers
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#define CALC_BATCH_NAME avx512
+#define CALC_BATCH_LEVEL IsaLevel::AVX512
+#include "batch_kernels.inc"
+#endif
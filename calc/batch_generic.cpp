@@ -0,0 +1,6 @@
+// Batch kernels in portable C++, no vector code: the fallback on every CPU
+// and the reference the other levels are tested against.
+#define CALC_BATCH_GENERIC 1
+#define CALC_BATCH_NAME generic
+#define CALC_BATCH_LEVEL IsaLevel::Generic
+#include "batch_kernels.inc"
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "calculator.h"
+#include "isa.h"
+
+// Batch kernels behind the Calculator span ops and formatBulk().
+//
+// batch_kernels.inc is compiled once per IsaLevel, each time with that
+// level's instruction set enabled (batch_generic.cpp ... batch_avx512.cpp,
+// flags in CMakeLists.txt), and every build fills in one BatchKernels
+// table. batchKernels() hands out the table of activeIsa().
+
+// how a 64-bit lane result is narrowed to the word size:
+// ((v & mask) ^ sign) - sign
+struct Lanes {
+    uint64_t mask;
+    uint64_t sign;
+    int bits;
+};
+
+enum class ShiftKind { Left, Right, RotLeft, RotRight };
+
+enum class FlagKind { Add, Subtract, Multiply };
+
+enum class BitKind {
+    Popcount, Parity, Clz, Ctz, HighestBit, LowestBit,
+    Bswap, BitReverse, Blsr, Blsi
+};
+
+// One divisor for a whole batch as a multiply-shift reciprocal (Granlund
+// and Montgomery, in libdivide's form): q = mulhi(n, magic) >> shift, with
+// the numerator added back in when the magic needs 65 bits. Signed is the
+// 64-bit IDIV of the scalar ops, MIN / -1 wrapping; unsigned is DIV on the
+// masked word.
+struct Divider {
+    uint64_t magic;     // 0 when d is a power of two and a shift does it all
+    uint64_t divisor;   // d as the lanes see it, for the remainder
+    int shift;
+    bool add;           // the 65-bit magic case
+    bool negative;      // signed and d < 0
+    bool isSigned;
+};
+
+// d != 0 (after the mask, for unsigned); the one division of a batch
+Divider makeDivider(int64_t d, bool isSigned, uint64_t mask);
+
+struct BatchKernels {
+    IsaLevel level;
+
+    using Binary = void (*)(const int64_t* a, const int64_t* b, int64_t* out, size_t n, const Lanes& l);
+    Binary add, subtract, multiply;
+    Binary bitAnd, bitOr, bitXor;
+    Binary pdep, pext;
+
+    void (*bitNot)(const int64_t* a, int64_t* out, size_t n, const Lanes& l);
+
+    // n is already in [0, bits)
+    void (*shift)(ShiftKind k, const int64_t* a, int n, int64_t* out, size_t len, const Lanes& l);
+
+    void (*bits)(BitKind k, const int64_t* a, int64_t* out, size_t n, const Lanes& l);
+
+    // a[i] / d, or a[i] % d with `remainder`
+    void (*divideBy)(const int64_t* a, int64_t* out, size_t n, const Divider& d, bool remainder,
+                     const Lanes& l);
+
+    // add / subtract / multiply plus CF and OF per lane, one bit each: lane
+    // i is bit i % 64 of carry[i / 64] and overflow[i / 64]
+    void (*flagged)(FlagKind k, const int64_t* a, const int64_t* b, int64_t* out, size_t n,
+                    uint64_t* carry, uint64_t* overflow, const Lanes& l);
+
+    // formatBulk() for BIN, OCT and HEX: `digits` is the fixed digit count
+    // when padding, else 0; returns the end of the text. Stores may run up
+    // to 16 bytes past it.
+    char* (*formatDigits)(const int64_t* v, size_t n, char* out, NumberBase b,
+                          int digits, uint64_t mask, char separator);
+};
+
+namespace batch {
+extern const BatchKernels generic;
+#if defined(__x86_64__) || defined(_M_X64)
+extern const BatchKernels sse2;
+extern const BatchKernels sse42;
+extern const BatchKernels avx2;
+extern const BatchKernels avx512;
+#endif
+}
+
+// the table of activeIsa()
+const BatchKernels& batchKernels();
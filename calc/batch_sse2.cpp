@@ -0,0 +1,6 @@
+// Batch kernels for the x86-64 baseline, SSE2.
+#if defined(__x86_64__) || defined(_M_X64)
+#define CALC_BATCH_NAME sse2
+#define CALC_BATCH_LEVEL IsaLevel::SSE2
+#include "batch_kernels.inc"
+#endif
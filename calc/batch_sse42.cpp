@@ -0,0 +1,9 @@
+// Batch kernels for SSE4.2 and POPCNT; built with -msse4.2 -mpopcnt.
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(__GNUC__) && !defined(__SSE4_2__)
+#error "batch_sse42.cpp needs -msse4.2 -mpopcnt, see CMakeLists.txt"
+#endif
+#define CALC_BATCH_NAME sse42
+#define CALC_BATCH_LEVEL IsaLevel::SSE42
+#include "batch_kernels.inc"
+#endif
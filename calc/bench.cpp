@@ -0,0 +1,785 @@
+// calc_bench: timings for every Calculator operation, no Qt.
+//
+//   calc_bench [--format text|csv|json] [--output FILE] [--filter TEXT]
+//              [--baseline FILE] [--threshold PCT] [--samples N] [--list]
+//              [--isa generic|sse2|sse4.2|avx2|avx512]
+//
+// Each case runs one operation over a fixed array of inputs; the time per
+// operation is the median of N samples. Names are "op/word" or
+// "op/base/word", e.g. "add/byte" or "display/hex/qword".
+//
+// --baseline takes the CSV or JSON of an earlier run and adds the change
+// per case in percent (positive is slower). With --threshold the exit
+// code is 1 when any case got slower by more than PCT percent.
+//
+// --isa runs the batch and bulk kernels at that instruction set level
+// instead of the best one the CPU has (see isa.h), so the levels can be
+// compared on one machine.
+
+#include "calculator.h"
+#include "expression.h"
+#include "format.h"
+#include "isa.h"
+#include "jit.h"
+#include "numtheory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr size_t inputCount = 4096;
+
+// keeps results alive so the work is not optimised away
+volatile uint64_t sink;
+
+struct Case {
+    std::string name;
+    std::function<uint64_t()> pass;   // one run over the inputs
+    size_t opsPerPass = inputCount;
+};
+
+struct Result {
+    std::string name;
+    double nsPerOp = 0;
+    double minNsPerOp = 0;
+    double baseline = 0;     // 0 when there is none
+};
+
+const WordSize benchWordSizes[] = {
+    WordSize::BYTE, WordSize::WORD, WordSize::DWORD, WordSize::QWORD
+};
+
+const NumberBase benchBases[] = {
+    NumberBase::DEC, NumberBase::BIN, NumberBase::OCT, NumberBase::HEX
+};
+
+const char* wordName(WordSize w)
+{
+    switch (w) {
+        case WordSize::BYTE:  return "byte";
+        case WordSize::WORD:  return "word";
+        case WordSize::DWORD: return "dword";
+        case WordSize::QWORD: return "qword";
+        case WordSize::DQWORD: return "dqword";
+    }
+    return "?";
+}
+
+const char* baseName(NumberBase b)
+{
+    switch (b) {
+        case NumberBase::DEC: return "dec";
+        case NumberBase::BIN: return "bin";
+        case NumberBase::OCT: return "oct";
+        case NumberBase::HEX: return "hex";
+    }
+    return "?";
+}
+
+// ================= INPUTS =================
+
+struct Inputs {
+    std::vector<int64_t> a, b;       // any bit width
+    std::vector<int64_t> divisors;   // never zero
+    std::vector<int64_t> positive;   // never zero or negative: isqrt, logarithms
+    std::vector<int64_t> units;      // 1 and -1, the only values with a reciprocal
+    std::vector<int> counts;         // shift counts 0..63
+    std::vector<int64_t> exponents;  // 0 .. 2^63 - 1
+    std::vector<int64_t> semiprimes; // p * q with p, q of 31 bits, rho's worst case; only 64
+    std::vector<int64_t> residues;   // 1 .. inverseModulus - 1, all invertible
+};
+
+// prime and within a BYTE, so every residue has an inverse at every word size
+constexpr int64_t inverseModulus = 127;
+
+Inputs makeInputs()
+{
+    std::mt19937_64 rng(42);
+    Inputs in;
+    for (size_t i = 0; i < inputCount; ++i) {
+        in.a.push_back(static_cast<int64_t>(rng() >> (rng() % 64)));
+        in.b.push_back(static_cast<int64_t>(rng() >> (rng() % 64)));
+        in.divisors.push_back(static_cast<int64_t>((rng() >> (rng() % 64)) | 1));
+        in.positive.push_back(static_cast<int64_t>((rng() >> (1 + rng() % 63)) | 1));
+        in.units.push_back(rng() & 1 ? 1 : -1);
+        in.counts.push_back(static_cast<int>(rng() % 64));
+        in.exponents.push_back(static_cast<int64_t>(rng() >> 1));
+        in.residues.push_back(1 + static_cast<int64_t>(rng() % (inverseModulus - 1)));
+    }
+    auto prime31 = [&rng] {
+        uint64_t p;
+        do p = (rng() >> 33) | (1ULL << 30) | 1;
+        while (!numtheory::isPrime(p));
+        return p;
+    };
+    for (int i = 0; i < 64; ++i)
+        in.semiprimes.push_back(static_cast<int64_t>(prime31() * prime31()));
+    return in;
+}
+
+// ================= CASES =================
+
+using Binary = int64_t (Calculator::*)(int64_t, int64_t);
+using Unary = int64_t (Calculator::*)(int64_t);
+using Shift = int64_t (Calculator::*)(int64_t, int);
+using WideMultiply = HiLo (Calculator::*)(int64_t, int64_t);
+
+using BatchBinary = void (Calculator::*)(std::span<const int64_t>, std::span<const int64_t>,
+                                         std::span<int64_t>) const;
+using BatchUnary = void (Calculator::*)(std::span<const int64_t>, std::span<int64_t>) const;
+using BatchShift = void (Calculator::*)(std::span<const int64_t>, int, std::span<int64_t>) const;
+using BatchByDivisor = void (Calculator::*)(std::span<const int64_t>, int64_t, std::span<int64_t>) const;
+using BatchFlagged = void (Calculator::*)(std::span<const int64_t>, std::span<const int64_t>,
+                                          std::span<int64_t>, std::span<uint64_t>,
+                                          std::span<uint64_t>) const;
+
+uint64_t checksum(const std::vector<int64_t>& v)
+{
+    uint64_t s = 0;
+    for (int64_t x : v) s += static_cast<uint64_t>(x);
+    return s;
+}
+
+std::vector<Case> makeCases(const Inputs& in)
+{
+    std::vector<Case> cases;
+    auto calcFor = [](WordSize w, NumberBase b = NumberBase::DEC) {
+        Calculator c;
+        c.setWordSize(w);
+        c.setBase(b);
+        return c;
+    };
+
+    struct { const char* name; Binary op; bool divides; } binary[] = {
+        { "add", &Calculator::add, false },
+        { "subtract", &Calculator::subtract, false },
+        { "multiply", &Calculator::multiply, false },
+        { "divide", &Calculator::divide, true },
+        { "mod", &Calculator::mod, true },
+        { "bitAnd", &Calculator::bitAnd, false },
+        { "bitOr", &Calculator::bitOr, false },
+        { "bitXor", &Calculator::bitXor, false },
+        { "pdep", &Calculator::pdep, false },
+        { "pext", &Calculator::pext, false },
+        { "adc", &Calculator::adc, false },
+        { "sbb", &Calculator::sbb, false },
+        { "gcd", &Calculator::gcd, false },
+        { "lcm", &Calculator::lcm, false },
+    };
+    struct { const char* name; Shift op; } shifts[] = {
+        { "shl", &Calculator::shl }, { "shr", &Calculator::shr },
+        { "rol", &Calculator::rol }, { "ror", &Calculator::ror },
+    };
+    struct { const char* name; Unary op; const std::vector<int64_t>* args; } unary[] = {
+        { "bitNot", &Calculator::bitNot, &in.a },
+        { "isqrt", &Calculator::isqrt, &in.positive },
+        { "icbrt", &Calculator::icbrt, &in.a },
+        { "ilog2", &Calculator::ilog2, &in.positive },
+        { "ilog10", &Calculator::ilog10, &in.positive },
+        { "digitCount", &Calculator::digitCount, &in.a },
+        { "isPrime", &Calculator::isPrime, &in.a },
+        { "reciprocal", &Calculator::reciprocal, &in.units },
+        { "popcount", &Calculator::popcount, &in.a },
+        { "clz", &Calculator::clz, &in.a },
+        { "ctz", &Calculator::ctz, &in.a },
+        { "bswap", &Calculator::bswap, &in.a },
+        { "bitReverse", &Calculator::bitReverse, &in.a },
+        { "blsr", &Calculator::blsr, &in.a },
+        { "blsi", &Calculator::blsi, &in.a },
+        { "parity", &Calculator::parity, &in.a },
+        { "highestBit", &Calculator::highestBit, &in.a },
+        { "lowestBit", &Calculator::lowestBit, &in.a },
+    };
+
+    struct { const char* name; BatchBinary op; bool divides; } batchBinary[] = {
+        { "batch.add", &Calculator::add, false },
+        { "batch.subtract", &Calculator::subtract, false },
+        { "batch.multiply", &Calculator::multiply, false },
+        { "batch.divide", &Calculator::divide, true },
+        { "batch.mod", &Calculator::mod, true },
+        { "batch.bitAnd", &Calculator::bitAnd, false },
+        { "batch.bitOr", &Calculator::bitOr, false },
+        { "batch.bitXor", &Calculator::bitXor, false },
+        { "batch.pdep", &Calculator::pdep, false },
+        { "batch.pext", &Calculator::pext, false },
+        { "batch.gcd", &Calculator::gcd, false },
+        { "batch.lcm", &Calculator::lcm, false },
+    };
+    struct { const char* name; BatchFlagged op; } batchFlagged[] = {
+        { "batch.addFlags", &Calculator::add },
+        { "batch.subtractFlags", &Calculator::subtract },
+        { "batch.multiplyFlags", &Calculator::multiply },
+    };
+    struct { const char* name; BatchShift op; } batchShifts[] = {
+        { "batch.shl", &Calculator::shl }, { "batch.shr", &Calculator::shr },
+        { "batch.rol", &Calculator::rol }, { "batch.ror", &Calculator::ror },
+    };
+    // one divisor per batch, against batch.divide / batch.mod above
+    struct { const char* name; BatchByDivisor op; } batchByDivisor[] = {
+        { "batch.divideBy", &Calculator::divide },
+        { "batch.modBy", &Calculator::mod },
+        { "batch.udivideBy", &Calculator::divideUnsigned },
+        { "batch.umodBy", &Calculator::modUnsigned },
+    };
+    struct { const char* name; BatchUnary op; const std::vector<int64_t>* args; } batchUnary[] = {
+        { "batch.bitNot", &Calculator::bitNot, &in.a },
+        { "batch.isqrt", &Calculator::isqrt, &in.positive },
+        { "batch.icbrt", &Calculator::icbrt, &in.a },
+        { "batch.ilog2", &Calculator::ilog2, &in.positive },
+        { "batch.ilog10", &Calculator::ilog10, &in.positive },
+        { "batch.digitCount", &Calculator::digitCount, &in.a },
+        { "batch.reciprocal", &Calculator::reciprocal, &in.units },
+        { "batch.popcount", &Calculator::popcount, &in.a },
+        { "batch.clz", &Calculator::clz, &in.a },
+        { "batch.ctz", &Calculator::ctz, &in.a },
+        { "batch.bswap", &Calculator::bswap, &in.a },
+        { "batch.bitReverse", &Calculator::bitReverse, &in.a },
+        { "batch.blsr", &Calculator::blsr, &in.a },
+        { "batch.blsi", &Calculator::blsi, &in.a },
+        { "batch.parity", &Calculator::parity, &in.a },
+        { "batch.highestBit", &Calculator::highestBit, &in.a },
+        { "batch.lowestBit", &Calculator::lowestBit, &in.a },
+    };
+
+    struct { const char* name; WideMultiply op; } wideMultiply[] = {
+        { "mulHiLo", &Calculator::mulHiLo },
+        { "imulHiLo", &Calculator::imulHiLo },
+    };
+
+    for (WordSize w : benchWordSizes) {
+        std::string ws = wordName(w);
+
+        for (auto& op : binary) {
+            const auto& b = op.divides ? in.divisors : in.b;
+            cases.push_back({ std::string(op.name) + "/" + ws, [&in, &b, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                uint64_t s = 0;
+                for (size_t i = 0; i < inputCount; ++i)
+                    s += static_cast<uint64_t>((c.*f)(in.a[i], b[i]));
+                return s;
+            } });
+        }
+        for (auto& op : shifts)
+            cases.push_back({ std::string(op.name) + "/" + ws, [&in, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                uint64_t s = 0;
+                for (size_t i = 0; i < inputCount; ++i)
+                    s += static_cast<uint64_t>((c.*f)(in.a[i], in.counts[i]));
+                return s;
+            } });
+        for (auto& op : unary)
+            cases.push_back({ std::string(op.name) + "/" + ws, [args = op.args, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                uint64_t s = 0;
+                for (int64_t v : *args)
+                    s += static_cast<uint64_t>((c.*f)(v));
+                return s;
+            } });
+
+        for (auto& op : batchBinary) {
+            const auto& b = op.divides ? in.divisors : in.b;
+            cases.push_back({ std::string(op.name) + "/" + ws, [&in, &b, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                std::vector<int64_t> out(inputCount);
+                (c.*f)(in.a, b, out);
+                return checksum(out);
+            } });
+        }
+        for (auto& op : batchFlagged)
+            cases.push_back({ std::string(op.name) + "/" + ws, [&in, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                std::vector<int64_t> out(inputCount);
+                std::vector<uint64_t> carry((inputCount + 63) / 64), overflow(carry.size());
+                (c.*f)(in.a, in.b, out, carry, overflow);
+                uint64_t s = checksum(out);
+                for (size_t i = 0; i < carry.size(); ++i)
+                    s += carry[i] ^ (overflow[i] << 1);
+                return s;
+            } });
+        for (auto& op : batchShifts)
+            cases.push_back({ std::string(op.name) + "/" + ws, [&in, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                std::vector<int64_t> out(inputCount);
+                (c.*f)(in.a, 13, out);
+                return checksum(out);
+            } });
+        for (auto& op : batchUnary)
+            cases.push_back({ std::string(op.name) + "/" + ws, [args = op.args, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                std::vector<int64_t> out(inputCount);
+                (c.*f)(*args, out);
+                return checksum(out);
+            } });
+
+        cases.push_back({ "batch.tryDivide/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            std::vector<int64_t> out(inputCount);
+            std::vector<uint64_t> failed((inputCount + 63) / 64);
+            uint64_t s = c.tryDivide(in.a, in.divisors, out, failed);
+            return s + checksum(out);
+        } });
+
+        // a fifth root, past the square and cube roots' own code
+        cases.push_back({ "iroot/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (int64_t v : in.positive)
+                s += static_cast<uint64_t>(c.iroot(v, 5));
+            return s;
+        } });
+        cases.push_back({ "batch.iroot/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            std::vector<int64_t> out(inputCount);
+            c.iroot(in.positive, 5, out);
+            return checksum(out);
+        } });
+
+        cases.push_back({ "pow/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (size_t i = 0; i < inputCount; ++i)
+                s += static_cast<uint64_t>(c.pow(in.a[i], in.exponents[i]));
+            return s;
+        } });
+        cases.push_back({ "batch.pow/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            std::vector<int64_t> out(inputCount);
+            c.pow(in.a, in.exponents, out);
+            return checksum(out);
+        } });
+
+        // a new modulus every call: Montgomery setup included
+        cases.push_back({ "powmod/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (size_t i = 0; i < inputCount; ++i)
+                s += static_cast<uint64_t>(c.powmod(in.a[i], in.exponents[i], in.divisors[i]));
+            return s;
+        } });
+
+        // one odd and one even modulus for the whole batch
+        for (int64_t m : { (int64_t(1) << 61) - 1, int64_t(1) << 61 })
+            cases.push_back({ std::string(m & 1 ? "batch.powmod" : "batch.powmodEven") + "/" + ws,
+                              [&in, w, m, calcFor] {
+                Calculator c = calcFor(w);
+                std::vector<int64_t> out(inputCount);
+                c.powmod(in.a, in.exponents, m, out);
+                return checksum(out);
+            } });
+
+        // modular mode with a prime below 2^61 and an even modulus; the plain
+        // "mod" case above is the hardware divide they replace
+        for (int64_t m : { (int64_t(1) << 61) - 1, int64_t(1000000) << 20 }) {
+            std::string suffix = std::string(m & 1 ? "" : "Even") + "/" + ws;
+            auto modular = [w, m, calcFor] {
+                Calculator c = calcFor(w);
+                c.setModulus(m);
+                return c;
+            };
+            cases.push_back({ "modular.multiply" + suffix, [&in, modular] {
+                Calculator c = modular();
+                uint64_t s = 0;
+                for (size_t i = 0; i < inputCount; ++i)
+                    s += static_cast<uint64_t>(c.multiply(in.a[i], in.b[i]));
+                return s;
+            } });
+            cases.push_back({ "modular.pow" + suffix, [&in, modular] {
+                Calculator c = modular();
+                uint64_t s = 0;
+                for (size_t i = 0; i < inputCount; ++i)
+                    s += static_cast<uint64_t>(c.pow(in.a[i], in.exponents[i]));
+                return s;
+            } });
+            cases.push_back({ "batch.modular.multiply" + suffix, [&in, modular] {
+                Calculator c = modular();
+                std::vector<int64_t> out(inputCount);
+                c.multiply(in.a, in.b, out);
+                return checksum(out);
+            } });
+        }
+
+        cases.push_back({ "egcd/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (size_t i = 0; i < inputCount; ++i) {
+                Bezout r = c.egcd(in.a[i], in.b[i]);
+                s += static_cast<uint64_t>(r.g) ^ static_cast<uint64_t>(r.x) ^ static_cast<uint64_t>(r.y);
+            }
+            return s;
+        } });
+        cases.push_back({ "modInverse/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (int64_t v : in.residues)
+                s += static_cast<uint64_t>(c.modInverse(v, inverseModulus));
+            return s;
+        } });
+        cases.push_back({ "batch.modInverse/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            std::vector<int64_t> out(inputCount);
+            c.modInverse(in.residues, inverseModulus, out);
+            return checksum(out);
+        } });
+
+        // generation plus verification on one thread: every dividend of a
+        // BYTE or WORD, samples of a QWORD; DWORD's 2^32 take seconds a call
+        if (w != WordSize::DWORD)
+            cases.push_back({ "divisionMagic/" + ws, [w, calcFor] {
+                Calculator c = calcFor(w);
+                DivisionMagic m = c.divisionMagic(7, true, 1);
+                return m.multiplier + m.tested;
+            }, 1 });
+
+        // one thread and one per core
+        for (unsigned threads : { 1u, 0u })
+            cases.push_back({ std::string(threads ? "batch.isPrime" : "batch.isPrimeThreads") + "/" + ws,
+                              [&in, w, threads, calcFor] {
+                Calculator c = calcFor(w);
+                std::vector<int64_t> out(inputCount);
+                c.isPrime(in.a, out, threads);
+                return checksum(out);
+            } });
+
+        // 7 takes the 65-bit magic at QWORD, 10 the plain one
+        for (auto& op : batchByDivisor)
+            for (int64_t d : { 7, 10 })
+                cases.push_back({ std::string(op.name) + std::to_string(d) + "/" + ws,
+                                  [&in, w, d, f = op.op, calcFor] {
+                    Calculator c = calcFor(w);
+                    std::vector<int64_t> out(inputCount);
+                    (c.*f)(in.a, d, out);
+                    return checksum(out);
+                } });
+
+        cases.push_back({ "factor/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (int64_t v : in.semiprimes)
+                s += static_cast<uint64_t>(c.factor(v).front());
+            return s;
+        }, in.semiprimes.size() });
+
+        for (auto& op : wideMultiply)
+            cases.push_back({ std::string(op.name) + "/" + ws, [&in, w, f = op.op, calcFor] {
+                Calculator c = calcFor(w);
+                uint64_t s = 0;
+                for (size_t i = 0; i < inputCount; ++i) {
+                    HiLo p = (c.*f)(in.a[i], in.b[i]);
+                    s += static_cast<uint64_t>(p.hi) ^ static_cast<uint64_t>(p.lo);
+                }
+                return s;
+            } });
+
+        cases.push_back({ "setValue/" + ws, [&in, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (int64_t v : in.a) {
+                c.setValue(v);
+                s += static_cast<uint64_t>(c.getValue());
+            }
+            return s;
+        } });
+
+        for (NumberBase b : benchBases) {
+            std::string bs = std::string(baseName(b)) + "/" + ws;
+
+            cases.push_back({ "display/" + bs, [&in, w, b, calcFor] {
+                Calculator c = calcFor(w, b);
+                uint64_t s = 0;
+                for (int64_t v : in.a) {
+                    c.setValue(v);
+                    s += c.display().size();
+                }
+                return s;
+            } });
+
+            cases.push_back({ "displayBuffer/" + bs, [&in, w, b, calcFor] {
+                Calculator c = calcFor(w, b);
+                DisplayBuffer buf;
+                uint64_t s = 0;
+                for (int64_t v : in.a) {
+                    c.setValue(v);
+                    s += c.display(buf).size();
+                }
+                return s;
+            } });
+
+            // what display() shows for each input, read back
+            auto texts = std::make_shared<std::vector<std::string>>();
+            Calculator c = calcFor(w, b);
+            for (int64_t v : in.a) {
+                c.setValue(v);
+                texts->push_back(c.display());
+            }
+            cases.push_back({ "parse/" + bs, [texts, w, b] {
+                uint64_t s = 0;
+                for (const std::string& t : *texts)
+                    s += static_cast<uint64_t>(parseNumber(t, b, w).value);
+                return s;
+            } });
+
+            cases.push_back({ "formatBulk/" + bs, [&in, w, b] {
+                BulkFormat f;
+                f.base = b;
+                f.wordSize = w;
+                static std::string out(bulkFormatCapacity(inputCount), '\0');
+                return static_cast<uint64_t>(formatBulk(in.a, f, out.data()));
+            } });
+        }
+
+        // the GUI-independent path: bytecode interpreter and native code
+        auto expr = std::make_shared<Expression>(Expression::compile("(x * 3 + 7) ^ (x >> 2)"));
+        cases.push_back({ "expr.interpret/" + ws, [&in, expr, w] {
+            uint64_t s = 0;
+            for (int64_t v : in.a)
+                s += static_cast<uint64_t>(expr->evaluate(w, v));
+            return s;
+        } });
+        cases.push_back({ "expr.calculator/" + ws, [&in, expr, w, calcFor] {
+            Calculator c = calcFor(w);
+            uint64_t s = 0;
+            for (int64_t v : in.a)
+                s += static_cast<uint64_t>(expr->evaluate(c, v));
+            return s;
+        } });
+        auto native = std::make_shared<NativeExpression>(*expr, w);
+        cases.push_back({ "expr.native/" + ws, [&in, native] {
+            std::vector<int64_t> out(inputCount);
+            native->evaluate(in.a, out);
+            return checksum(out);
+        } });
+    }
+
+    return cases;
+}
+
+// ================= TIMING =================
+
+Result measure(const Case& c, int samples)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // passes per sample so that one sample takes about a millisecond
+    size_t passes = 1;
+    for (;;) {
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < passes; ++i) sink = sink + c.pass();
+        auto ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        if (ns > 1e6 || passes >= (1u << 20)) break;
+        passes *= 2;
+    }
+
+    std::vector<double> perOp;
+    for (int s = 0; s < samples; ++s) {
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < passes; ++i) sink = sink + c.pass();
+        auto ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        perOp.push_back(ns / double(passes * c.opsPerPass));
+    }
+
+    std::sort(perOp.begin(), perOp.end());
+    Result r;
+    r.name = c.name;
+    r.nsPerOp = perOp[perOp.size() / 2];
+    r.minNsPerOp = perOp.front();
+    return r;
+}
+
+// ================= OUTPUT =================
+
+double changePercent(const Result& r)
+{
+    return (r.nsPerOp / r.baseline - 1.0) * 100.0;
+}
+
+void writeText(FILE* f, const std::vector<Result>& results)
+{
+    for (const Result& r : results) {
+        std::fprintf(f, "%-28s %10.3f ns/op", r.name.c_str(), r.nsPerOp);
+        if (r.baseline > 0)
+            std::fprintf(f, "  %10.3f  %+7.1f%%", r.baseline, changePercent(r));
+        std::fputc('\n', f);
+    }
+}
+
+void writeCsv(FILE* f, const std::vector<Result>& results)
+{
+    std::fputs("name,ns_per_op,min_ns_per_op,baseline_ns_per_op,change_percent\n", f);
+    for (const Result& r : results) {
+        std::fprintf(f, "%s,%.4f,%.4f,", r.name.c_str(), r.nsPerOp, r.minNsPerOp);
+        if (r.baseline > 0)
+            std::fprintf(f, "%.4f,%.2f\n", r.baseline, changePercent(r));
+        else
+            std::fputs(",\n", f);
+    }
+}
+
+void writeJson(FILE* f, const std::vector<Result>& results)
+{
+    std::fputs("[\n", f);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(f, "  {\"name\": \"%s\", \"ns_per_op\": %.4f, \"min_ns_per_op\": %.4f",
+                     r.name.c_str(), r.nsPerOp, r.minNsPerOp);
+        if (r.baseline > 0)
+            std::fprintf(f, ", \"baseline_ns_per_op\": %.4f, \"change_percent\": %.2f",
+                         r.baseline, changePercent(r));
+        std::fputs(i + 1 < results.size() ? "},\n" : "}\n", f);
+    }
+    std::fputs("]\n", f);
+}
+
+// name -> ns/op from an earlier CSV or JSON run; empty if unreadable
+std::map<std::string, double> readBaseline(const char* path)
+{
+    std::map<std::string, double> m;
+    std::ifstream f(path, std::ios::binary);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string text = ss.str();
+
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && text[first] == '[') {
+        // only what writeJson produces: "name": "...", "ns_per_op": N
+        size_t pos = 0;
+        while ((pos = text.find("\"name\": \"", pos)) != std::string::npos) {
+            pos += 9;
+            size_t end = text.find('"', pos);
+            size_t val = text.find("\"ns_per_op\": ", end);
+            if (end == std::string::npos || val == std::string::npos) break;
+            m[text.substr(pos, end - pos)] = std::strtod(text.c_str() + val + 13, nullptr);
+            pos = val;
+        }
+        return m;
+    }
+
+    std::istringstream lines(text);
+    std::string line;
+    std::getline(lines, line);   // header
+    while (std::getline(lines, line)) {
+        size_t comma = line.find(',');
+        if (comma == std::string::npos) continue;
+        m[line.substr(0, comma)] = std::strtod(line.c_str() + comma + 1, nullptr);
+    }
+    return m;
+}
+
+void usage(FILE* f)
+{
+    std::fputs("usage: calc_bench [--format text|csv|json] [--output FILE] [--filter TEXT]\n"
+               "                  [--baseline FILE] [--threshold PCT] [--samples N] [--list]\n"
+               "                  [--isa generic|sse2|sse4.2|avx2|avx512]\n"
+               "\n"
+               "Times every Calculator operation. --baseline compares against the CSV or\n"
+               "JSON of an earlier run; with --threshold, slowdowns over PCT percent\n"
+               "make the exit code 1. --isa picks the instruction set of the batch\n"
+               "kernels, by default the best this CPU has.\n", f);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string_view format = "text";
+    const char* output = nullptr;
+    const char* baselinePath = nullptr;
+    std::string_view filter;
+    double threshold = -1;
+    int samples = 15;
+    bool list = false;
+    std::string_view isa;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (a == "-h" || a == "--help") { usage(stdout); return 0; }
+        if (a == "--list") { list = true; continue; }
+        if (a == "--format" && hasValue) { format = argv[++i]; continue; }
+        if (a == "--output" && hasValue) { output = argv[++i]; continue; }
+        if (a == "--filter" && hasValue) { filter = argv[++i]; continue; }
+        if (a == "--baseline" && hasValue) { baselinePath = argv[++i]; continue; }
+        if (a == "--threshold" && hasValue) { threshold = std::strtod(argv[++i], nullptr); continue; }
+        if (a == "--samples" && hasValue) { samples = std::max(1, std::atoi(argv[++i])); continue; }
+        if (a == "--isa" && hasValue) { isa = argv[++i]; continue; }
+
+        usage(stderr);
+        return 2;
+    }
+    if (format != "text" && format != "csv" && format != "json") {
+        usage(stderr);
+        return 2;
+    }
+
+    if (!isa.empty()) {
+        IsaLevel level;
+        if (!parseIsa(isa, level)) {
+            usage(stderr);
+            return 2;
+        }
+        if (level > detectedIsa()) {
+            std::fprintf(stderr, "Error: this CPU supports up to %s\n", isaName(detectedIsa()));
+            return 2;
+        }
+        setIsa(level);
+    }
+
+    Inputs in = makeInputs();
+    std::vector<Case> cases = makeCases(in);
+
+    std::map<std::string, double> baseline;
+    if (baselinePath) {
+        baseline = readBaseline(baselinePath);
+        if (baseline.empty()) {
+            std::fprintf(stderr, "Error: no results in %s\n", baselinePath);
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    for (const Case& c : cases) {
+        if (!filter.empty() && c.name.find(filter) == std::string::npos)
+            continue;
+        if (list) {
+            std::printf("%s\n", c.name.c_str());
+            continue;
+        }
+        Result r = measure(c, samples);
+        auto it = baseline.find(r.name);
+        if (it != baseline.end()) r.baseline = it->second;
+        results.push_back(r);
+    }
+    if (list)
+        return 0;
+
+    FILE* out = output ? std::fopen(output, "w") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "Error: cannot open %s\n", output);
+        return 2;
+    }
+    if (format == "csv")       writeCsv(out, results);
+    else if (format == "json") writeJson(out, results);
+    else                       writeText(out, results);
+    if (output) std::fclose(out);
+
+    int regressions = 0;
+    if (threshold >= 0)
+        for (const Result& r : results)
+            if (r.baseline > 0 && changePercent(r) > threshold) {
+                std::fprintf(stderr, "%s: %+.1f%%\n", r.name.c_str(), changePercent(r));
+                ++regressions;
+            }
+    return regressions ? 1 : 0;
+}
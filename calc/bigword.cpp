@@ -0,0 +1,909 @@
+#include "bigword.h"
+#include "wordops.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#if !defined(__SIZEOF_INT128__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Limb routines work on raw spans of 64-bit limbs, least significant
+// first; the BigWord functions wrap them and handle signs and widths.
+
+namespace {
+
+using Limbs = std::vector<uint64_t>;
+
+// ---- DQWORD through unsigned __int128 ----
+
+#if defined(__SIZEOF_INT128__)
+#define CALC_BIGWORD_INT128 1
+
+using u128 = unsigned __int128;
+using i128 = __int128;
+
+inline bool native(const BigWord& a) { return a.size() == 2; }
+
+inline u128 get128(const BigWord& a)
+{
+    auto l = a.limbs();
+    return (static_cast<u128>(l[1]) << 64) | l[0];
+}
+
+inline BigWord put128(u128 v)
+{
+    BigWord r(0, 128);
+    r.limbs()[0] = static_cast<uint64_t>(v);
+    r.limbs()[1] = static_cast<uint64_t>(v >> 64);
+    return r;
+}
+#endif
+
+// ================= LIMB PRIMITIVES =================
+
+// a * b as (hi, lo)
+inline uint64_t mulWide(uint64_t a, uint64_t b, uint64_t& hi)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+    hi = static_cast<uint64_t>(p >> 64);
+    return static_cast<uint64_t>(p);
+#else
+    return _umul128(a, b, &hi);
+#endif
+}
+
+// (hi:lo) / d with hi < d; remainder in r
+inline uint64_t divWide(uint64_t hi, uint64_t lo, uint64_t d, uint64_t& r)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 n = (static_cast<unsigned __int128>(hi) << 64) | lo;
+    r = static_cast<uint64_t>(n % d);
+    return static_cast<uint64_t>(n / d);
+#else
+    return _udiv128(hi, lo, d, &r);
+#endif
+}
+
+inline uint64_t addCarry(uint64_t a, uint64_t b, uint64_t& carry)
+{
+    uint64_t s = a + b;
+    uint64_t c = s < a;
+    uint64_t t = s + carry;
+    carry = c | (t < s);
+    return t;
+}
+
+inline uint64_t subBorrow(uint64_t a, uint64_t b, uint64_t& borrow)
+{
+    uint64_t d = a - b;
+    uint64_t c = a < b;
+    uint64_t t = d - borrow;
+    borrow = c | (d < borrow);
+    return t;
+}
+
+// out = a + b over n limbs, returns the carry out
+uint64_t addN(uint64_t* out, const uint64_t* a, const uint64_t* b, size_t n)
+{
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i)
+        out[i] = addCarry(a[i], b[i], carry);
+    return carry;
+}
+
+// a[0..n) += b[0..m) with m <= n, carry propagated through a
+void addInto(uint64_t* a, size_t n, const uint64_t* b, size_t m)
+{
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < m; ++i)
+        a[i] = addCarry(a[i], b[i], carry);
+    for (; carry && i < n; ++i)
+        a[i] = addCarry(a[i], 0, carry);
+}
+
+// a[0..n) -= b[0..m) with m <= n, borrow propagated through a
+void subInto(uint64_t* a, size_t n, const uint64_t* b, size_t m)
+{
+    uint64_t borrow = 0;
+    size_t i = 0;
+    for (; i < m; ++i)
+        a[i] = subBorrow(a[i], b[i], borrow);
+    for (; borrow && i < n; ++i)
+        a[i] = subBorrow(a[i], 0, borrow);
+}
+
+void negate(uint64_t* a, size_t n)
+{
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < n; ++i)
+        a[i] = subBorrow(0, a[i], borrow);
+}
+
+// limbs up to the most significant non-zero one
+size_t significant(const uint64_t* a, size_t n)
+{
+    while (n && a[n - 1] == 0) --n;
+    return n;
+}
+
+// ================= MULTIPLICATION =================
+
+// out[0..na+nb) = a * b
+void mulSchool(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out)
+{
+    std::fill(out, out + na + nb, 0);
+    for (size_t i = 0; i < na; ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < nb; ++j) {
+            uint64_t hi;
+            uint64_t lo = mulWide(a[i], b[j], hi);
+            uint64_t c = 0;
+            lo = addCarry(lo, out[i + j], c);
+            hi += c;
+            c = 0;
+            out[i + j] = addCarry(lo, carry, c);
+            carry = hi + c;
+        }
+        out[i + nb] = carry;
+    }
+}
+
+// out[0..2n) = a * b, both n limbs
+void mulKaratsuba(const uint64_t* a, const uint64_t* b, size_t n, uint64_t* out)
+{
+    if (n < bigword::karatsubaLimbs) {
+        mulSchool(a, n, b, n, out);
+        return;
+    }
+
+    // a = a1 * B^h + a0, a0 has h limbs and a1 has m >= h
+    size_t h = n / 2;
+    size_t m = n - h;
+
+    mulKaratsuba(a, b, h, out);                    // z0 = a0 b0 -> out[0..2h)
+    mulKaratsuba(a + h, b + h, m, out + 2 * h);    // z2 = a1 b1 -> out[2h..2n)
+
+    Limbs sa(m + 1, 0), sb(m + 1, 0);
+    std::copy(a + h, a + n, sa.begin());
+    std::copy(b + h, b + n, sb.begin());
+    addInto(sa.data(), m + 1, a, h);
+    addInto(sb.data(), m + 1, b, h);
+
+    // z1 = (a0 + a1)(b0 + b1) - z0 - z2 = a0 b1 + a1 b0
+    Limbs z1(2 * (m + 1));
+    mulKaratsuba(sa.data(), sb.data(), m + 1, z1.data());
+    subInto(z1.data(), z1.size(), out, 2 * h);
+    subInto(z1.data(), z1.size(), out + 2 * h, 2 * m);
+
+    size_t len = significant(z1.data(), z1.size());
+    addInto(out + h, 2 * n - h, z1.data(), std::min(len, 2 * n - h));
+}
+
+// out[0..n) = low n limbs of a * b, both n limbs
+void mulLow(const uint64_t* a, const uint64_t* b, size_t n, uint64_t* out)
+{
+    if (n < bigword::karatsubaLimbs) {
+        // schoolbook, skipping the products above the width
+        std::fill(out, out + n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; i + j < n; ++j) {
+                uint64_t hi;
+                uint64_t lo = mulWide(a[i], b[j], hi);
+                uint64_t c = 0;
+                lo = addCarry(lo, out[i + j], c);
+                hi += c;
+                c = 0;
+                out[i + j] = addCarry(lo, carry, c);
+                carry = hi + c;
+            }
+        }
+        return;
+    }
+
+    // low(a b) = a0 b0 + B^h (low(a1 b0) + low(a0 b1)) + B^2h a1 b1, the
+    // cross terms only matter up to the width and a1 b1 only for odd n
+    size_t h = n / 2;
+    size_t m = n - h;
+
+    mulKaratsuba(a, b, h, out);
+    if (2 * h < n) out[2 * h] = a[h] * b[h];
+
+    // a0 and b0 zero-extended to the m limbs of a1 and b1
+    Limbs a0(m, 0), b0(m, 0), cross(m);
+    std::copy(a, a + h, a0.begin());
+    std::copy(b, b + h, b0.begin());
+
+    mulLow(a + h, b0.data(), m, cross.data());
+    addInto(out + h, m, cross.data(), m);
+    mulLow(a0.data(), b + h, m, cross.data());
+    addInto(out + h, m, cross.data(), m);
+}
+
+// ================= DIVISION =================
+
+// q = u / d, returns u % d; u and q have n limbs
+uint64_t divSmall(const uint64_t* u, size_t n, uint64_t d, uint64_t* q)
+{
+    uint64_t r = 0;
+    for (size_t i = n; i-- > 0;)
+        q[i] = divWide(r, u[i], d, r);
+    return r;
+}
+
+// Knuth D on unsigned magnitudes: q = u / v, r = u % v, all n limbs, v != 0
+void divModUnsigned(const uint64_t* u, const uint64_t* v, size_t n, uint64_t* q, uint64_t* r)
+{
+    std::fill(q, q + n, 0);
+    std::fill(r, r + n, 0);
+
+    size_t nv = significant(v, n);
+    size_t nu = significant(u, n);
+
+    if (nv == 1) {
+        r[0] = divSmall(u, n, v[0], q);
+        return;
+    }
+    if (nu < nv) {
+        std::copy(u, u + n, r);
+        return;
+    }
+
+    // normalise so the top limb of v has its high bit set
+    int s = std::countl_zero(v[nv - 1]);
+    Limbs vn(nv), un(nu + 1);
+    for (size_t i = nv - 1; i > 0; --i)
+        vn[i] = s ? (v[i] << s) | (v[i - 1] >> (64 - s)) : v[i];
+    vn[0] = v[0] << s;
+    un[nu] = s ? u[nu - 1] >> (64 - s) : 0;
+    for (size_t i = nu - 1; i > 0; --i)
+        un[i] = s ? (u[i] << s) | (u[i - 1] >> (64 - s)) : u[i];
+    un[0] = u[0] << s;
+
+    const uint64_t top = vn[nv - 1];
+    const uint64_t next = vn[nv - 2];
+
+    for (size_t j = nu - nv + 1; j-- > 0;) {
+        // estimate the quotient limb from the top two limbs, at most 2 too big
+        uint64_t qhat, rhat;
+        bool rhatOverflow = false;
+        if (un[j + nv] >= top) {
+            qhat = ~0ULL;
+            rhat = un[j + nv - 1] + top;     // (un[j+nv]:un[j+nv-1]) - qhat * top
+            rhatOverflow = rhat < top;
+        } else {
+            qhat = divWide(un[j + nv], un[j + nv - 1], top, rhat);
+        }
+        while (!rhatOverflow) {
+            uint64_t hi;
+            uint64_t lo = mulWide(qhat, next, hi);
+            if (hi < rhat || (hi == rhat && lo <= un[j + nv - 2]))
+                break;
+            --qhat;
+            rhat += top;
+            rhatOverflow = rhat < top;
+        }
+
+        // un[j..j+nv] -= qhat * vn
+        uint64_t carry = 0, borrow = 0;
+        for (size_t i = 0; i < nv; ++i) {
+            uint64_t hi;
+            uint64_t lo = mulWide(qhat, vn[i], hi);
+            uint64_t c = 0;
+            lo = addCarry(lo, carry, c);
+            carry = hi + c;
+            un[i + j] = subBorrow(un[i + j], lo, borrow);
+        }
+        un[j + nv] = subBorrow(un[j + nv], carry, borrow);
+
+        // went negative: qhat was one too big, add v back
+        if (borrow) {
+            --qhat;
+            uint64_t c = 0;
+            for (size_t i = 0; i < nv; ++i)
+                un[i + j] = addCarry(un[i + j], vn[i], c);
+            un[j + nv] += c;
+        }
+        q[j] = qhat;
+    }
+
+    // un holds the normalised remainder
+    for (size_t i = 0; i < nv; ++i)
+        r[i] = s ? (un[i] >> s) | (un[i + 1] << (64 - s)) : un[i];
+}
+
+// ================= HELPERS =================
+
+void checkSizes(const BigWord& a, const BigWord& b)
+{
+    if (a.size() != b.size())
+        throw std::invalid_argument("Size mismatch");
+}
+
+template <class Fn>
+BigWord zipLimbs(const BigWord& a, const BigWord& b, Fn fn)
+{
+    checkSizes(a, b);
+    BigWord r(0, a.bits());
+    auto x = a.limbs();
+    auto y = b.limbs();
+    auto out = r.limbs();
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i] = fn(x[i], y[i]);
+    return r;
+}
+
+BigWord magnitude(const BigWord& a)
+{
+    BigWord m = a;
+    if (a.isNegative())
+        negate(m.limbs().data(), m.size());
+    return m;
+}
+
+// quotient or remainder with C semantics on the signed values
+BigWord divMod(const BigWord& a, const BigWord& b, bool wantRemainder)
+{
+    checkSizes(a, b);
+    if (b.isZero())
+        throw std::invalid_argument("Division by zero");
+
+#ifdef CALC_BIGWORD_INT128
+    if (native(a)) {
+        // the most negative value over -1 would trap, it wraps instead
+        i128 x = static_cast<i128>(get128(a)), y = static_cast<i128>(get128(b));
+        if (y == -1) return put128(wantRemainder ? 0 : 0 - get128(a));
+        return put128(static_cast<u128>(wantRemainder ? x % y : x / y));
+    }
+#endif
+
+    BigWord ua = magnitude(a), ub = magnitude(b);
+    BigWord q(0, a.bits()), r(0, a.bits());
+    divModUnsigned(ua.limbs().data(), ub.limbs().data(), a.size(),
+                   q.limbs().data(), r.limbs().data());
+
+    if (wantRemainder) {
+        if (a.isNegative()) negate(r.limbs().data(), r.size());
+        return r;
+    }
+    // the most negative value over -1 comes out as its own magnitude,
+    // which negates back to itself: the wrap the narrow words have
+    if (a.isNegative() != b.isNegative()) negate(q.limbs().data(), q.size());
+    return q;
+}
+
+// k bits (k <= 8) of v starting at bit `pos`
+inline unsigned bitsAt(std::span<const uint64_t> v, size_t pos, unsigned k)
+{
+    size_t i = pos / 64, s = pos % 64;
+    uint64_t x = v[i] >> s;
+    if (s + k > 64 && i + 1 < v.size())
+        x |= v[i + 1] << (64 - s);
+    return static_cast<unsigned>(x & ((1u << k) - 1));
+}
+
+// 64 bits of v starting at bit `pos`, zeros past the end
+inline uint64_t window64(std::span<const uint64_t> v, size_t pos)
+{
+    size_t i = pos / 64, s = pos % 64;
+    if (i >= v.size()) return 0;
+    uint64_t x = v[i] >> s;
+    if (s && i + 1 < v.size())
+        x |= v[i + 1] << (64 - s);
+    return x;
+}
+
+int digitOf(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 99;
+}
+
+
+} // namespace
+
+
+// ================= BIGWORD =================
+
+BigWord::BigWord(int64_t v, unsigned bits)
+{
+    if (!validBits(bits))
+        throw std::invalid_argument("Unsupported word size");
+
+    count = bits / 64;
+    if (count > inlineLimbs)
+        heap.resize(count);
+
+    auto l = limbs();
+    std::fill(l.begin(), l.end(), v < 0 ? ~0ULL : 0);
+    l[0] = static_cast<uint64_t>(v);
+}
+
+bool BigWord::validBits(unsigned bits)
+{
+    return bits >= minBits && bits <= maxBits && bits % 64 == 0;
+}
+
+bool BigWord::isZero() const
+{
+    return significant(limbs().data(), count) == 0;
+}
+
+BigWord BigWord::resized(unsigned bits) const
+{
+    BigWord r(isNegative() ? -1 : 0, bits);
+    std::copy_n(limbs().begin(), std::min(count, r.count), r.limbs().begin());
+    return r;
+}
+
+bool BigWord::operator==(const BigWord& other) const
+{
+    return std::ranges::equal(limbs(), other.limbs());
+}
+
+
+// ================= ARITHMETIC =================
+
+namespace bigword {
+
+BigWord add(const BigWord& a, const BigWord& b)
+{
+    checkSizes(a, b);
+#ifdef CALC_BIGWORD_INT128
+    if (native(a)) return put128(get128(a) + get128(b));
+#endif
+    BigWord r(0, a.bits());
+    addN(r.limbs().data(), a.limbs().data(), b.limbs().data(), a.size());
+    return r;
+}
+
+BigWord subtract(const BigWord& a, const BigWord& b)
+{
+    checkSizes(a, b);
+#ifdef CALC_BIGWORD_INT128
+    if (native(a)) return put128(get128(a) - get128(b));
+#endif
+    BigWord r = a;
+    subInto(r.limbs().data(), r.size(), b.limbs().data(), b.size());
+    return r;
+}
+
+// two's complement needs no sign handling: the low half of the unsigned
+// product is the wrapped signed product
+BigWord multiply(const BigWord& a, const BigWord& b)
+{
+    checkSizes(a, b);
+#ifdef CALC_BIGWORD_INT128
+    if (native(a)) return put128(get128(a) * get128(b));
+#endif
+    BigWord r(0, a.bits());
+    mulLow(a.limbs().data(), b.limbs().data(), a.size(), r.limbs().data());
+    return r;
+}
+
+BigWord multiplySchoolbook(const BigWord& a, const BigWord& b)
+{
+    checkSizes(a, b);
+    Limbs full(2 * a.size());
+    mulSchool(a.limbs().data(), a.size(), b.limbs().data(), b.size(), full.data());
+
+    BigWord r(0, a.bits());
+    std::copy_n(full.begin(), r.size(), r.limbs().begin());
+    return r;
+}
+
+BigWord divide(const BigWord& a, const BigWord& b)
+{
+    return divMod(a, b, false);
+}
+
+BigWord mod(const BigWord& a, const BigWord& b)
+{
+    return divMod(a, b, true);
+}
+
+// Newton's iteration from a power of two above the root
+BigWord isqrt(const BigWord& a)
+{
+    if (a.isZero() || a.isNegative())
+        return BigWord(0, a.bits());
+
+    auto l = a.limbs();
+    size_t n = significant(l.data(), l.size());
+    int width = static_cast<int>((n - 1) * 64) + std::bit_width(l[n - 1]);
+
+    BigWord x = shl(BigWord(1, a.bits()), (width + 1) / 2);
+    for (;;) {
+        BigWord y = shr(add(x, divide(a, x)), 1);
+        if (compare(y, x) >= 0)
+            return x;
+        x = y;
+    }
+}
+
+BigWord powmod(const BigWord& a, const BigWord& e, const BigWord& m)
+{
+    checkSizes(a, e);
+    checkSizes(a, m);
+    if (m.isZero())
+        throw std::invalid_argument("Division by zero");
+    if (e.isNegative())
+        throw std::invalid_argument("N/A");
+
+    const size_t n = a.size();
+    BigWord um = magnitude(m), r(0, a.bits());
+    if (significant(um.limbs().data(), n) == 1 && um.limbs()[0] == 1)
+        return r;
+
+    // the base as a residue in [0, |m|)
+    BigWord base(0, a.bits()), q(0, a.bits());
+    BigWord ua = magnitude(a);
+    divModUnsigned(ua.limbs().data(), um.limbs().data(), n, q.limbs().data(), base.limbs().data());
+    if (a.isNegative() && !base.isZero())
+        base = subtract(um, base);
+
+    // x = x * y mod |m| through a 2n-limb product
+    Limbs wideM(2 * n), product(2 * n), quotient(2 * n), rest(2 * n);
+    std::copy_n(um.limbs().begin(), n, wideM.begin());
+    auto mulMod = [&](BigWord& x, const BigWord& y) {
+        mulSchool(x.limbs().data(), n, y.limbs().data(), n, product.data());
+        divModUnsigned(product.data(), wideM.data(), 2 * n, quotient.data(), rest.data());
+        std::copy_n(rest.begin(), n, x.limbs().begin());
+    };
+
+    r.limbs()[0] = 1;
+    int top = highestBit(e);
+    auto exp = e.limbs();
+    for (int i = 0; i <= top; ++i) {
+        if ((exp[i / 64] >> (i % 64)) & 1)
+            mulMod(r, base);
+        if (i < top)
+            mulMod(base, base);
+    }
+    return r;
+}
+
+#ifdef CALC_BIGWORD_INT128
+BigWord fromInt128(unsigned __int128 v)
+{
+    return put128(v);
+}
+
+unsigned __int128 toInt128(const BigWord& v)
+{
+    auto l = v.limbs();
+    return (static_cast<u128>(l[1]) << 64) | l[0];
+}
+#endif
+
+int compare(const BigWord& a, const BigWord& b)
+{
+    checkSizes(a, b);
+#ifdef CALC_BIGWORD_INT128
+    if (native(a)) {
+        i128 x = static_cast<i128>(get128(a)), y = static_cast<i128>(get128(b));
+        return x < y ? -1 : x > y ? 1 : 0;
+    }
+#endif
+    if (a.isNegative() != b.isNegative())
+        return a.isNegative() ? -1 : 1;
+
+    auto x = a.limbs();
+    auto y = b.limbs();
+    for (size_t i = x.size(); i-- > 0;)
+        if (x[i] != y[i])
+            return x[i] < y[i] ? -1 : 1;
+    return 0;
+}
+
+// ================= BIT OPERATIONS =================
+
+BigWord bitAnd(const BigWord& a, const BigWord& b)
+{
+    return zipLimbs(a, b, [](uint64_t x, uint64_t y) { return x & y; });
+}
+
+BigWord bitOr(const BigWord& a, const BigWord& b)
+{
+    return zipLimbs(a, b, [](uint64_t x, uint64_t y) { return x | y; });
+}
+
+BigWord bitXor(const BigWord& a, const BigWord& b)
+{
+    return zipLimbs(a, b, [](uint64_t x, uint64_t y) { return x ^ y; });
+}
+
+BigWord bitNot(const BigWord& a)
+{
+    BigWord r = a;
+    for (uint64_t& x : r.limbs()) x = ~x;
+    return r;
+}
+
+// ================= SHIFT / ROTATE =================
+
+BigWord shl(const BigWord& a, int n)
+{
+    BigWord r(0, a.bits());
+    if (static_cast<unsigned>(n) >= a.bits())
+        return r;
+#ifdef CALC_BIGWORD_INT128
+    if (native(a)) return put128(get128(a) << n);
+#endif
+
+    auto in = a.limbs();
+    auto out = r.limbs();
+    size_t limbs = static_cast<size_t>(n) / 64;
+    int s = n % 64;
+    for (size_t i = out.size(); i-- > limbs;) {
+        size_t k = i - limbs;
+        out[i] = in[k] << s;
+        if (s && k > 0) out[i] |= in[k - 1] >> (64 - s);
+    }
+    return r;
+}
+
+BigWord shr(const BigWord& a, int n)
+{
+    BigWord r(0, a.bits());
+    if (static_cast<unsigned>(n) >= a.bits())
+        return r;
+#ifdef CALC_BIGWORD_INT128
+    if (native(a)) return put128(get128(a) >> n);
+#endif
+
+    auto in = a.limbs();
+    auto out = r.limbs();
+    size_t limbs = static_cast<size_t>(n) / 64;
+    int s = n % 64;
+    for (size_t i = 0; i + limbs < in.size(); ++i) {
+        size_t k = i + limbs;
+        out[i] = in[k] >> s;
+        if (s && k + 1 < in.size()) out[i] |= in[k + 1] << (64 - s);
+    }
+    return r;
+}
+
+BigWord rol(const BigWord& a, int n)
+{
+    int bits = static_cast<int>(a.bits());
+    n %= bits;
+    if (n < 0) n += bits;
+    if (n == 0) return a;
+    return bitOr(shl(a, n), shr(a, bits - n));
+}
+
+BigWord ror(const BigWord& a, int n)
+{
+    int bits = static_cast<int>(a.bits());
+    n %= bits;
+    if (n < 0) n += bits;
+    return rol(a, bits - n);
+}
+
+// ================= BIT MANIPULATION =================
+
+int popcount(const BigWord& a)
+{
+    int n = 0;
+    for (uint64_t x : a.limbs()) n += std::popcount(x);
+    return n;
+}
+
+int parity(const BigWord& a)
+{
+    uint64_t x = 0;
+    for (uint64_t l : a.limbs()) x ^= l;
+    return std::popcount(x) & 1;
+}
+
+int clz(const BigWord& a)
+{
+    return static_cast<int>(a.bits()) - 1 - highestBit(a);
+}
+
+int ctz(const BigWord& a)
+{
+    int i = lowestBit(a);
+    return i < 0 ? static_cast<int>(a.bits()) : i;
+}
+
+int highestBit(const BigWord& a)
+{
+    auto l = a.limbs();
+    for (size_t i = l.size(); i-- > 0;)
+        if (l[i]) return static_cast<int>(i * 64) + std::bit_width(l[i]) - 1;
+    return -1;
+}
+
+int lowestBit(const BigWord& a)
+{
+    auto l = a.limbs();
+    for (size_t i = 0; i < l.size(); ++i)
+        if (l[i]) return static_cast<int>(i * 64) + std::countr_zero(l[i]);
+    return -1;
+}
+
+// byte and bit order reverse over the whole word: the limbs swap ends too
+BigWord bswap(const BigWord& a)
+{
+    BigWord r(0, a.bits());
+    auto in = a.limbs();
+    auto out = r.limbs();
+    for (size_t i = 0; i < in.size(); ++i)
+        out[out.size() - 1 - i] = wordops::byteSwap64(in[i]);
+    return r;
+}
+
+BigWord bitReverse(const BigWord& a)
+{
+    BigWord r(0, a.bits());
+    auto in = a.limbs();
+    auto out = r.limbs();
+    for (size_t i = 0; i < in.size(); ++i)
+        out[out.size() - 1 - i] = wordops::bitReverse64(in[i]);
+    return r;
+}
+
+// each mask limb takes as many source bits as it has set bits
+BigWord pdep(const BigWord& a, const BigWord& mask)
+{
+    checkSizes(a, mask);
+    BigWord r(0, a.bits());
+    auto m = mask.limbs();
+    auto out = r.limbs();
+    size_t pos = 0;
+    for (size_t i = 0; i < m.size(); ++i) {
+        out[i] = wordops::deposit64(window64(a.limbs(), pos), m[i]);
+        pos += std::popcount(m[i]);
+    }
+    return r;
+}
+
+BigWord pext(const BigWord& a, const BigWord& mask)
+{
+    checkSizes(a, mask);
+    BigWord r(0, a.bits());
+    auto in = a.limbs();
+    auto m = mask.limbs();
+    auto out = r.limbs();
+    size_t pos = 0;
+    for (size_t i = 0; i < m.size(); ++i) {
+        uint64_t e = wordops::extract64(in[i], m[i]);
+        size_t k = pos / 64, s = pos % 64;
+        out[k] |= e << s;
+        if (s && k + 1 < out.size()) out[k + 1] |= e >> (64 - s);
+        pos += std::popcount(m[i]);
+    }
+    return r;
+}
+
+BigWord blsr(const BigWord& a)
+{
+    return bitAnd(a, subtract(a, BigWord(1, a.bits())));
+}
+
+BigWord blsi(const BigWord& a)
+{
+    return bitAnd(a, subtract(BigWord(0, a.bits()), a));
+}
+
+// ================= TEXT =================
+
+std::string format(const BigWord& v, NumberBase b)
+{
+    auto limbs = v.limbs();
+    const char* digits = "0123456789ABCDEF";
+
+    if (b == NumberBase::DEC) {
+        // 19 decimal digits at a time, least significant group first
+        BigWord m = magnitude(v);
+        Limbs x(m.limbs().begin(), m.limbs().end());
+        std::vector<uint64_t> groups;
+        size_t n = significant(x.data(), x.size());
+        do {
+            groups.push_back(divSmall(x.data(), n, 10000000000000000000ULL, x.data()));
+            n = significant(x.data(), n);
+        } while (n);
+
+        std::string s = v.isNegative() ? "-" : "";
+        s += std::to_string(groups.back());
+        for (size_t i = groups.size() - 1; i-- > 0;) {
+            std::string g = std::to_string(groups[i]);
+            s.append(19 - g.size(), '0');
+            s += g;
+        }
+        return s;
+    }
+
+    unsigned k = b == NumberBase::BIN ? 1 : b == NumberBase::OCT ? 3 : 4;
+    size_t top = 0;
+    for (size_t i = limbs.size(); i-- > 0;)
+        if (limbs[i]) {
+            top = i * 64 + static_cast<size_t>(std::bit_width(limbs[i]));
+            break;
+        }
+    if (top == 0)
+        return "0";
+
+    size_t count = (top + k - 1) / k;
+    std::string s(count, '0');
+    for (size_t i = 0; i < count; ++i)
+        s[count - 1 - i] = digits[bitsAt(limbs, i * k, k)];
+    return s;
+}
+
+ParseError parse(std::string_view text, NumberBase b, BigWord& out)
+{
+    bool neg = false;
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+        neg = text[0] == '-';
+        text.remove_prefix(1);
+    }
+
+    int radix = b == NumberBase::BIN ? 2 : b == NumberBase::OCT ? 8
+              : b == NumberBase::HEX ? 16 : 10;
+    if (text.size() > 1 && text[0] == '0') {
+        char c = text[1];
+        int prefixed = (c == 'x' || c == 'X') ? 16
+                     : b == NumberBase::HEX ? 0
+                     : (c == 'o' || c == 'O') ? 8
+                     : (c == 'b' || c == 'B') ? 2 : 0;
+        if (prefixed) {
+            radix = prefixed;
+            text.remove_prefix(2);
+        }
+    }
+    if (text.empty())
+        return ParseError::Empty;
+
+    Limbs mag(out.size(), 0);
+    bool overflow = false;
+    int k = radix == 16 ? 4 : radix == 8 ? 3 : 1;
+
+    for (char c : text) {
+        int d = digitOf(c);
+        if (d >= radix)
+            return ParseError::InvalidDigit;
+        if (overflow)
+            continue;
+
+        uint64_t carry = static_cast<uint64_t>(d);
+        for (uint64_t& x : mag) {
+            uint64_t hi;
+            if (radix == 10) {
+                uint64_t lo = mulWide(x, 10, hi);
+                uint64_t c2 = 0;
+                x = addCarry(lo, carry, c2);
+                carry = hi + c2;
+            } else {
+                hi = x >> (64 - k);
+                x = (x << k) | carry;
+                carry = hi;
+            }
+        }
+        overflow = carry != 0;
+    }
+    if (overflow)
+        return ParseError::Overflow;
+
+    // negative input stops at the most negative value, like the narrow words
+    if (neg && (mag.back() >> 63)) {
+        bool isMin = mag.back() == (1ULL << 63) &&
+                     significant(mag.data(), mag.size() - 1) == 0;
+        if (!isMin)
+            return ParseError::Overflow;
+    }
+    if (neg)
+        negate(mag.data(), mag.size());
+
+    std::copy(mag.begin(), mag.end(), out.limbs().begin());
+    return ParseError::None;
+}
+
+} // namespace bigword
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "calculator.h"
+
+// Wide two's-complement words, 128 to 4096 bits.
+//
+// A BigWord is an array of 64-bit limbs, least significant first; the width
+// is any multiple of 64 in that range. The operations behave like the
+// 8-64-bit ones: results wrap at the width, division truncates toward zero
+// and the most negative value divided by -1 wraps. Multiplication is
+// schoolbook below karatsubaLimbs limbs and Karatsuba from there on,
+// division is Knuth's algorithm D. 128-bit words (DQWORD) are stored
+// inline and go through the compiler's unsigned __int128 where it has one.
+
+class BigWord {
+public:
+    static constexpr unsigned minBits = 128;
+    static constexpr unsigned maxBits = 4096;
+
+    BigWord() : BigWord(0, minBits) {}
+
+    // v sign-extended to `bits`; throws std::invalid_argument for a width
+    // validBits() rejects
+    BigWord(int64_t v, unsigned bits);
+
+    // multiples of 64 from minBits to maxBits
+    static bool validBits(unsigned bits);
+
+    unsigned bits() const { return count * 64; }
+    size_t size() const { return count; }
+
+    std::span<const uint64_t> limbs() const { return { count <= inlineLimbs ? small : heap.data(), count }; }
+    std::span<uint64_t> limbs() { return { count <= inlineLimbs ? small : heap.data(), count }; }
+
+    bool isZero() const;
+    bool isNegative() const { return limbs().back() >> 63; }
+
+    // the low 64 bits
+    int64_t low() const { return static_cast<int64_t>(limbs()[0]); }
+
+    // the same value at another width: sign-extended or truncated
+    BigWord resized(unsigned bits) const;
+
+    bool operator==(const BigWord& other) const;
+
+private:
+    // a DQWORD fits inline, so 128-bit values never allocate
+    static constexpr unsigned inlineLimbs = 2;
+
+    uint64_t small[inlineLimbs] = {};
+    std::vector<uint64_t> heap;
+    unsigned count = 0;
+};
+
+// OpResult for wide words
+struct WideResult {
+    BigWord value;      // 0 at the operands' width on error
+    OpError error = OpError::None;
+
+    explicit operator bool() const { return error == OpError::None; }
+};
+
+namespace bigword {
+
+// from this many limbs (2048 bits) on, multiplication uses Karatsuba
+inline constexpr size_t karatsubaLimbs = 32;
+
+// Binary operations need operands of the same width and throw
+// std::invalid_argument("Size mismatch") otherwise.
+
+BigWord add(const BigWord& a, const BigWord& b);
+BigWord subtract(const BigWord& a, const BigWord& b);
+BigWord multiply(const BigWord& a, const BigWord& b);
+
+// O(n^2) at every width; the reference and baseline for multiply()
+BigWord multiplySchoolbook(const BigWord& a, const BigWord& b);
+
+// b must not be 0: throws std::invalid_argument("Division by zero")
+BigWord divide(const BigWord& a, const BigWord& b);
+BigWord mod(const BigWord& a, const BigWord& b);
+
+BigWord bitAnd(const BigWord& a, const BigWord& b);
+BigWord bitOr(const BigWord& a, const BigWord& b);
+BigWord bitXor(const BigWord& a, const BigWord& b);
+BigWord bitNot(const BigWord& a);
+
+// same count rules as the narrow words: shifts by the width or more, or by
+// a negative count, give 0; rotates take the count modulo the width
+BigWord shl(const BigWord& a, int n);
+BigWord shr(const BigWord& a, int n);
+BigWord rol(const BigWord& a, int n);
+BigWord ror(const BigWord& a, int n);
+
+// floor(sqrt(a)) for a >= 0
+BigWord isqrt(const BigWord& a);
+
+// a^e mod |m|, in [0, |m|), for e >= 0: every product is reduced at twice
+// the width, so nothing wraps. Throws std::invalid_argument("Division by
+// zero") for m = 0 and ("N/A") for a negative e.
+BigWord powmod(const BigWord& a, const BigWord& e, const BigWord& m);
+
+// bit manipulation over the whole width, as in wordops.h: clz and ctz of
+// 0 are bits(), highestBit and lowestBit of 0 are -1
+int popcount(const BigWord& a);
+int parity(const BigWord& a);
+int clz(const BigWord& a);
+int ctz(const BigWord& a);
+int highestBit(const BigWord& a);
+int lowestBit(const BigWord& a);
+BigWord bswap(const BigWord& a);
+BigWord bitReverse(const BigWord& a);
+BigWord pdep(const BigWord& a, const BigWord& mask);
+BigWord pext(const BigWord& a, const BigWord& mask);
+BigWord blsr(const BigWord& a);
+BigWord blsi(const BigWord& a);
+
+// signed: -1, 0 or 1
+int compare(const BigWord& a, const BigWord& b);
+
+// the text display() shows: signed in DEC, the bit pattern otherwise
+std::string format(const BigWord& v, NumberBase b);
+
+// parseNumber() for wide words, at the width of `out`; `out` is only
+// written on success
+ParseError parse(std::string_view text, NumberBase b, BigWord& out);
+
+#if defined(__SIZEOF_INT128__)
+// DQWORD values as the compiler's 128-bit integers
+BigWord fromInt128(unsigned __int128 v);
+unsigned __int128 toInt128(const BigWord& v);   // the low 128 bits
+#endif
+
+} // namespace bigword
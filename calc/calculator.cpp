@@ -1,41 +1,86 @@
 #include "calculator.h"
+#include "bigword.h"
+#include "divmagic.h"
+#include "format.h"
+#include "numtheory.h"
+#include "wordops.h"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
-#include <cmath>
 
 // constructor
 Calculator::Calculator()
-    : raw(0), base(NumberBase::DEC), wordSize(WordSize::QWORD) {}
+    : raw(0), base(NumberBase::DEC), ops(&wordOpsFor(WordSize::QWORD)) {}
 
 
 // helpers
-uint64_t Calculator::mask() const {
-    int bits = (int)wordSize;
+const WordOps& wordOpsFor(WordSize w)
+{
+    switch (w) {
+        case WordSize::BYTE:  return wordOpsTable<WordSize::BYTE>;
+        case WordSize::WORD:  return wordOpsTable<WordSize::WORD>;
+        case WordSize::DWORD: return wordOpsTable<WordSize::DWORD>;
+        case WordSize::QWORD: return wordOpsTable<WordSize::QWORD>;
+        case WordSize::DQWORD: break;   // the int64_t ops work at 64 bits
+    }
+    return wordOpsTable<WordSize::QWORD>;
+}
 
-    if (bits == 8)  return 0xFF;
-    if (bits == 16) return 0xFFFF;
-    if (bits == 32) return 0xFFFFFFFF;
-    if (bits == 64) return 0xFFFFFFFFFFFFFFFF;
+namespace {
 
-    return 0;
+uint64_t magnitude(int64_t a)
+{
+    return a < 0 ? 0 - static_cast<uint64_t>(a) : static_cast<uint64_t>(a);
+}
+
+// a non-negative result at the word size, or its wrap with CF and OF
+wordops::Flagged positive(const WordOps& ops, uint64_t v, bool wrapped = false)
+{
+    int64_t s = ops.signExtend(v);
+    bool over = wrapped || s < 0 || static_cast<uint64_t>(s) != v;
+    return { s, wordops::carryFlags(over, over) };
+}
+
+} // namespace
+
+uint64_t Calculator::mask() const {
+    return ops->mask;
 }
 
 int64_t Calculator::signedValue() const {
-    int bits = static_cast<int>(wordSize);
-    uint64_t m = mask();
-    uint64_t v = raw & m;
+    return ops->signExtend(raw);
+}
 
-    uint64_t signBit = 1ULL << (bits - 1);
-    if (v & signBit) {
-        return static_cast<int64_t>(v | ~m);
-    }
-    return static_cast<int64_t>(v);
+// keep an already narrowed result as the current value, with the CF and
+// OF of the op that made it
+int64_t Calculator::store(int64_t v, uint32_t carry) {
+    raw = static_cast<uint64_t>(v) & ops->mask;
+    carryFlags = carry;
+    if (wideBits) [[unlikely]]
+        syncWide(v);
+    return v;
 }
+
+// a 64-bit result in wide mode, sign-extended over the limbs
+void Calculator::syncWide(int64_t v) {
+    std::fill(wide.begin(), wide.end(), v < 0 ? ~0ULL : 0);
+    wide[0] = static_cast<uint64_t>(v);
+}
+
 void Calculator::setRaw(uint64_t v) {
     raw = v & mask();
+    carryFlags = 0;
+    if (wideBits) {
+        std::fill(wide.begin(), wide.end(), 0);
+        wide[0] = raw;
+    }
 }
 
 void Calculator::setValue(int64_t v) {
     raw = static_cast<uint64_t>(v) & mask();
+    carryFlags = 0;
+    if (wideBits)
+        syncWide(v);
 }
 
 uint64_t Calculator::getRaw() const {
@@ -45,26 +90,87 @@ uint64_t Calculator::getRaw() const {
 
 // operations
 int64_t Calculator::add(int64_t a, int64_t b) {
-    raw = (static_cast<uint64_t>(a) + static_cast<uint64_t>(b)) & mask();
-    return signedValue();
+    if (modulus) [[unlikely]]
+        return storeResidue(modulus->add(modulus->residue(a), modulus->residue(b)));
+
+    wordops::Flagged r = ops->adc(a, b, false);
+    return store(r.value, r.flags);
 }
 
 int64_t Calculator::subtract(int64_t a, int64_t b) {
-    raw = (static_cast<uint64_t>(a) - static_cast<uint64_t>(b)) & mask();
-    return signedValue();
+    if (modulus) [[unlikely]]
+        return storeResidue(modulus->subtract(modulus->residue(a), modulus->residue(b)));
+
+    wordops::Flagged r = ops->sbb(a, b, false);
+    return store(r.value, r.flags);
 }
 
 int64_t Calculator::multiply(int64_t a, int64_t b) {
-    raw = (static_cast<uint64_t>(a) * static_cast<uint64_t>(b)) & mask();
-    return signedValue();
+    if (modulus) [[unlikely]]
+        return storeResidue(modulus->multiply(modulus->residue(a), modulus->residue(b)));
+
+    wordops::Flagged r = ops->imul(a, b);
+    return store(r.value, r.flags);
 }
 
 int64_t Calculator::divide(int64_t a, int64_t b) {
+    OpResult r = tryDivide(a, b);
+    if (!r)
+        throw std::invalid_argument(r.error == OpError::DivideByZero ? "Division by zero" : "N/A");
+
+    return r.value;
+}
+
+// the most negative value / -1 wraps to itself, which is a signed overflow
+OpResult Calculator::tryDivide(int64_t a, int64_t b) noexcept {
+    if (modulus) [[unlikely]] {
+        OpResult r = modDivide(modulus->residue(a), modulus->residue(b));
+        return r ? OpResult{ storeResidue(static_cast<uint64_t>(r.value)) } : r;
+    }
     if (b == 0)
-        throw std::invalid_argument("Division by zero");
+        return { 0, OpError::DivideByZero };
 
-    raw = static_cast<uint64_t>(a / b) & mask();
-    return signedValue();
+    int64_t min = ops->signExtend(1ULL << (ops->bits - 1));
+    bool wrapped = b == -1 && ops->signExtend(static_cast<uint64_t>(a)) == min;
+    return { store(ops->divide(a, b), wrapped ? flags::OF : 0) };
+}
+
+int64_t Calculator::adc(int64_t a, int64_t b) {
+    wordops::Flagged r = ops->adc(a, b, carryFlags & flags::CF);
+    return store(r.value, r.flags);
+}
+
+int64_t Calculator::sbb(int64_t a, int64_t b) {
+    wordops::Flagged r = ops->sbb(a, b, carryFlags & flags::CF);
+    return store(r.value, r.flags);
+}
+
+HiLo Calculator::mulHiLo(int64_t a, int64_t b) {
+    HiLo p = ops->mulHiLo(a, b);
+    store(p.lo, p.hi != 0 ? flags::CF | flags::OF : 0);
+    return p;
+}
+
+HiLo Calculator::imulHiLo(int64_t a, int64_t b) {
+    HiLo p = ops->imulHiLo(a, b);
+    store(p.lo, p.hi != (p.lo < 0 ? -1 : 0) ? flags::CF | flags::OF : 0);
+    return p;
+}
+
+uint32_t Calculator::getFlags() const
+{
+    bool zero = wideBits ? std::all_of(wide.begin(), wide.end(), [](uint64_t l) { return l == 0; })
+                         : raw == 0;
+    bool negative = wideBits ? (wide.back() >> 63) != 0 : signedValue() < 0;
+
+    return carryFlags |
+           (zero ? flags::ZF : 0) |
+           (negative ? flags::SF : 0) |
+           (wordops::parity<WordSize::BYTE>(static_cast<int64_t>(raw)) ? 0 : flags::PF);
+}
+
+void Calculator::setFlags(uint32_t f) {
+    carryFlags = f & (flags::CF | flags::OF);
 }
 
 void Calculator::setBase(NumberBase b) {
@@ -73,189 +179,1124 @@ void Calculator::setBase(NumberBase b) {
 
 void Calculator::setWordSize(WordSize w)
 {
+    if (w == WordSize::DQWORD) {
+        setWordBits(128);
+        return;
+    }
+
     int64_t val = signedValue();
-    wordSize = w;
+    wideBits = 0;
+    wide.clear();
+    ops = &wordOpsFor(w);
     setValue(val);
 }
 
+NumberBase Calculator::getBase() const {
+    return base;
+}
+
+WordSize Calculator::getWordSize() const {
+    return wideBits == 128 ? WordSize::DQWORD : ops->size;
+}
+
 int64_t Calculator::getValue() const {
     return signedValue();
 }
 
 int64_t Calculator::bitAnd(int64_t a, int64_t b)
 {
-    raw = (a & b) & mask();
-    return signedValue();
+    return store(ops->bitAnd(a, b));
 }
 
+// CF is the last bit shifted out
 int64_t Calculator::shl(int64_t a, int n)
 {
-    int bits = (int)wordSize;
-
-    if (n >= bits) {
-        raw = 0;
-        return 0;
-    }
-
-    uint64_t v = (uint64_t)a & mask();
-    raw = (v << n) & mask();
-
-    return signedValue();
+    int bits = ops->bits;
+    bool cf = n > 0 && n <= bits && ((static_cast<uint64_t>(a) >> (bits - n)) & 1);
+    return store(ops->shl(a, n), cf ? flags::CF : 0);
 }
 
 
 int64_t Calculator::bitNot(int64_t a)
 {
-    raw = (~a) & mask();
-    return signedValue();
+    return store(ops->bitNot(a));
 }
 
 // ================= BIT OPERATIONS =================
 
 int64_t Calculator::bitOr(int64_t a, int64_t b)
 {
-    raw = (a | b) & mask();
-    return signedValue();
+    return store(ops->bitOr(a, b));
 }
 
 int64_t Calculator::bitXor(int64_t a, int64_t b)
 {
-    raw = (a ^ b) & mask();
-    return signedValue();
+    return store(ops->bitXor(a, b));
 }
 
 // ================= SHIFT =================
 
 int64_t Calculator::shr(int64_t a, int n)
 {
-    int bits = (int)wordSize;
-
-    if (n >= bits) {
-        raw = 0;
-        return 0;
-    }
-
-    uint64_t v = (uint64_t)a & mask();
-    raw = (v >> n) & mask();
-
-    return signedValue();
+    bool cf = n > 0 && n <= ops->bits && ((static_cast<uint64_t>(a) >> (n - 1)) & 1);
+    return store(ops->shr(a, n), cf ? flags::CF : 0);
 }
 
 
 // ================= ROTATE =================
 
+// CF is the bit that went around: the new low bit for rol, the new top
+// bit for ror
 int64_t Calculator::rol(int64_t a, int n)
 {
-    int bits = (int)wordSize;
-    n %= bits;
+    int64_t r = ops->rol(a, n);
+    return store(r, n != 0 && (r & 1) ? flags::CF : 0);
+}
+
+int64_t Calculator::ror(int64_t a, int n)
+{
+    int64_t r = ops->ror(a, n);
+    return store(r, n != 0 && r < 0 ? flags::CF : 0);
+}
 
-    uint64_t v = (uint64_t)a & mask();
+// ================= MATH =================
 
-    if (bits == 64)
-        raw = (v << n) | (v >> (64 - n));
-    else
-        raw = ((v << n) | (v >> (bits - n))) & mask();
+// the throwing ops are the try* ones plus the message for each error
+namespace {
 
-    return signedValue();
+const char* errorText(OpError e)
+{
+    return e == OpError::DivideByZero ? "DIV/0" : "N/A";
 }
 
-int64_t Calculator::ror(int64_t a, int n)
+} // namespace
+
+int64_t Calculator::mod(int64_t a, int64_t b)
 {
-    int bits = (int)wordSize;
-    n %= bits;
+    OpResult r = tryMod(a, b);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
 
-    uint64_t v = (uint64_t)a & mask();
+    return r.value;
+}
 
-    if (bits == 64)
-        raw = (v >> n) | (v << (64 - n));
-    else
-        raw = ((v >> n) | (v << (bits - n))) & mask();
+int64_t Calculator::isqrt(int64_t a)
+{
+    OpResult r = tryIsqrt(a);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
 
-    return signedValue();
+    return r.value;
 }
 
-// ================= MATH =================
+int64_t Calculator::reciprocal(int64_t a)
+{
+    OpResult r = tryReciprocal(a);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
 
-int64_t Calculator::mod(int64_t a, int64_t b)
+    return r.value;
+}
+
+OpResult Calculator::tryMod(int64_t a, int64_t b) noexcept
 {
     if (b == 0)
-        throw std::invalid_argument("DIV/0");
+        return { 0, OpError::DivideByZero };
 
-    raw = (a % b) & mask();
-    return signedValue();
+    return { store(ops->mod(a, b)) };
 }
 
-int64_t Calculator::isqrt(int64_t a)
+OpResult Calculator::tryIsqrt(int64_t a) noexcept
 {
     if (a < 0)
-        throw std::invalid_argument("N/A");
+        return { 0, OpError::Domain };
 
-    int64_t r = static_cast<int64_t>(std::sqrt((long double)a));
+    uint64_t r = wordops::isqrt64(static_cast<uint64_t>(a));
 
-    raw = r & mask();
-    return signedValue();
+    return { store(ops->signExtend(r)) };
 }
 
-int64_t Calculator::reciprocal(int64_t a)
+OpResult Calculator::tryReciprocal(int64_t a) noexcept
 {
     if (a == 0)
-        throw std::invalid_argument("DIV/0");
+        return { 0, OpError::DivideByZero };
 
     if (1 % a != 0)
+        return { 0, OpError::Domain };
+
+    return { store(ops->signExtend(static_cast<uint64_t>(1 / a))) };
+}
+
+// ================= ROOTS AND LOGARITHMS =================
+
+int64_t Calculator::icbrt(int64_t a)
+{
+    return tryIroot(a, 3).value;
+}
+
+int64_t Calculator::iroot(int64_t a, int n)
+{
+    OpResult r = tryIroot(a, n);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+int64_t Calculator::ilog2(int64_t a)
+{
+    OpResult r = tryIlog2(a);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+int64_t Calculator::ilog10(int64_t a)
+{
+    OpResult r = tryIlog10(a);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+// DEC shows the signed value, the other bases the bit pattern
+int64_t Calculator::digitCount(int64_t a)
+{
+    uint64_t v = static_cast<uint64_t>(a) & ops->mask;
+    if (base == NumberBase::DEC) {
+        int64_t s = ops->signExtend(v);
+        v = s < 0 ? 0 - static_cast<uint64_t>(s) : static_cast<uint64_t>(s);
+    }
+    return store(wordops::digits64(v, base));
+}
+
+// the root of |a|, negated back for odd n
+OpResult Calculator::tryIroot(int64_t a, int n) noexcept
+{
+    if (n < 1 || (a < 0 && n % 2 == 0))
+        return { 0, OpError::Domain };
+
+    uint64_t mag = a < 0 ? 0 - static_cast<uint64_t>(a) : static_cast<uint64_t>(a);
+    uint64_t r = wordops::iroot64(mag, n);
+
+    return { store(ops->signExtend(a < 0 ? 0 - r : r)) };
+}
+
+OpResult Calculator::tryIlog2(int64_t a) noexcept
+{
+    if (a < 1)
+        return { 0, OpError::Domain };
+
+    return { store(wordops::ilog2_64(static_cast<uint64_t>(a))) };
+}
+
+OpResult Calculator::tryIlog10(int64_t a) noexcept
+{
+    if (a < 1)
+        return { 0, OpError::Domain };
+
+    return { store(wordops::ilog10_64(static_cast<uint64_t>(a))) };
+}
+
+// ================= POWERS =================
+
+int64_t Calculator::pow(int64_t a, int64_t e)
+{
+    OpResult r = tryPow(a, e);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+int64_t Calculator::powmod(int64_t a, int64_t e, int64_t m)
+{
+    OpResult r = tryPowmod(a, e, m);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+// 1/a is only an integer for 1 and -1, and (1/a)^e = a^e for those
+OpResult Calculator::tryPow(int64_t a, int64_t e) noexcept
+{
+    if (modulus) [[unlikely]] {
+        uint64_t n = magnitude(e);
+        OpResult r = modPow(modulus->residue(a), { &n, 1 }, e < 0);
+        return r ? OpResult{ storeResidue(static_cast<uint64_t>(r.value)) } : r;
+    }
+    if (e < 0) {
+        int64_t s = ops->signExtend(static_cast<uint64_t>(a));
+        if (s == 0)
+            return { 0, OpError::DivideByZero };
+        if (s != 1 && s != -1)
+            return { 0, OpError::Domain };
+    }
+
+    uint64_t n = e < 0 ? 0 - static_cast<uint64_t>(e) : static_cast<uint64_t>(e);
+    wordops::Flagged r = ops->ipow(a, n);
+    return { store(r.value, r.flags) };
+}
+
+// a is reduced to [0, |m|) first, so a negative base needs no sign fixup
+OpResult Calculator::tryPowmod(int64_t a, int64_t e, int64_t m) noexcept
+{
+    if (m == 0)
+        return { 0, OpError::DivideByZero };
+    if (e < 0)
+        return { 0, OpError::Domain };
+
+    uint64_t um = m < 0 ? 0 - static_cast<uint64_t>(m) : static_cast<uint64_t>(m);
+    uint64_t ua = a < 0 ? 0 - static_cast<uint64_t>(a) : static_cast<uint64_t>(a);
+    uint64_t base = ua % um;
+    if (a < 0 && base)
+        base = um - base;
+
+    return { storeResidue(wordops::powMod64(base, static_cast<uint64_t>(e), um)) };
+}
+
+// ================= NUMBER THEORY =================
+
+int64_t Calculator::gcd(int64_t a, int64_t b)
+{
+    wordops::Flagged r = positive(*ops, numtheory::gcd(magnitude(a), magnitude(b)));
+    return store(r.value, r.flags);
+}
+
+// a / g * b, so the product only wraps when the lcm itself does
+int64_t Calculator::lcm(int64_t a, int64_t b)
+{
+    uint64_t ua = magnitude(a), ub = magnitude(b), v = 0;
+    bool wrapped = false;
+    if (ua && ub)
+        wrapped = __builtin_mul_overflow(ua / numtheory::gcd(ua, ub), ub, &v);
+
+    wordops::Flagged r = positive(*ops, v, wrapped);
+    return store(r.value, r.flags);
+}
+
+// the coefficients of the magnitudes, with their signs moved over
+Bezout Calculator::egcd(int64_t a, int64_t b)
+{
+    int64_t x, y;
+    uint64_t g = numtheory::egcd(magnitude(a), magnitude(b), x, y);
+    wordops::Flagged r = positive(*ops, g);
+    store(r.value, r.flags);
+    return { r.value, a < 0 ? 0 - x : x, b < 0 ? 0 - y : y };
+}
+
+int64_t Calculator::modInverse(int64_t a, int64_t m)
+{
+    OpResult r = tryModInverse(a, m);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+// a negative a is reduced to its residue first, as in tryPowmod()
+OpResult Calculator::tryModInverse(int64_t a, int64_t m) noexcept
+{
+    if (m == 0)
+        return { 0, OpError::DivideByZero };
+
+    uint64_t um = magnitude(m);
+    uint64_t base = magnitude(a) % um;
+    if (a < 0 && base)
+        base = um - base;
+
+    uint64_t inv;
+    if (!numtheory::modInverse(base, um, inv))
+        return { 0, OpError::Domain };
+
+    return { storeResidue(inv) };
+}
+
+int64_t Calculator::isPrime(int64_t a)
+{
+    return store(a > 0 && numtheory::isPrime(static_cast<uint64_t>(a)));
+}
+
+std::vector<int64_t> Calculator::factor(int64_t a) const
+{
+    std::vector<uint64_t> f = numtheory::factor(magnitude(a));
+    return { f.begin(), f.end() };
+}
+
+// ================= DIVISION MAGIC =================
+
+DivisionMagic Calculator::divisionMagic(int64_t d, bool isSigned, unsigned threads) const
+{
+    if (isWide())
         throw std::invalid_argument("N/A");
 
-    raw = (1 / a) & mask();
-    return signedValue();
+    DivisionMagic m = divmagic::compute(d, getWordSize(), isSigned);
+    divmagic::verify(m, threads);
+    return m;
+}
+
+// ================= MODULAR MODE =================
+
+void Calculator::setModulus(int64_t m)
+{
+    if (m < 0)
+        throw std::invalid_argument("Invalid modulus");
+
+    if (m == 0) modulus.reset();
+    else modulus = std::make_shared<const wordops::Modulus>(static_cast<uint64_t>(m));
+}
+
+int64_t Calculator::getModulus() const
+{
+    return modulus ? static_cast<int64_t>(modulus->value()) : 0;
+}
+
+// a residue as the value: below 2^63, so it only wraps in a narrow word
+int64_t Calculator::storeResidue(uint64_t r)
+{
+    wordops::Flagged v = positive(*ops, r);
+    return store(v.value, v.flags);
+}
+
+// a wide value mod m by Horner's rule over the limbs, top down; every step
+// is one 128-by-64 Barrett reduction
+uint64_t Calculator::residue(const BigWord& a) const
+{
+    BigWord n = a.isNegative() ? bigword::subtract(BigWord(0, a.bits()), a) : a;
+    std::span<const uint64_t> limbs = n.limbs();
+    uint64_t r = 0;
+    for (size_t i = limbs.size(); i-- > 0;)
+        r = modulus->barrett.reduce(r, limbs[i]);
+    return a.isNegative() && r ? modulus->value() - r : r;
+}
+
+// a * b^-1 as a residue, not yet stored; the inverse comes from the
+// extended Euclid, the one place modular mode still divides
+OpResult Calculator::modDivide(uint64_t a, uint64_t b) const
+{
+    uint64_t inv;
+    if (b == 0)
+        return { 0, OpError::DivideByZero };
+    if (!numtheory::modInverse(b, modulus->value(), inv))
+        return { 0, OpError::Domain };
+
+    return { static_cast<int64_t>(modulus->multiply(a, inv)) };
+}
+
+// a^e for the magnitude e in 64-bit limbs, low first, of the inverse of a
+// when the exponent is negative; not yet stored
+OpResult Calculator::modPow(uint64_t a, std::span<const uint64_t> e, bool negative) const
+{
+    if (negative) {
+        if (a == 0)
+            return { 0, OpError::DivideByZero };
+        if (!numtheory::modInverse(a, modulus->value(), a))
+            return { 0, OpError::Domain };
+    }
+
+    size_t n = e.size();
+    while (n > 1 && e[n - 1] == 0)
+        --n;
+
+    // a^(e0 + e1 2^64 + ...) = a^e0 (a^(2^64))^e1 ...
+    uint64_t r = modulus->pow(a, e[0]);
+    for (size_t i = 1; i < n; ++i) {
+        for (int k = 0; k < 64; ++k)
+            a = modulus->multiply(a, a);
+        r = modulus->multiply(r, modulus->pow(a, e[i]));
+    }
+    return { static_cast<int64_t>(r) };
+}
+
+// ================= BIT MANIPULATION =================
+
+int64_t Calculator::popcount(int64_t a)
+{
+    return store(ops->popcount(a));
+}
+
+int64_t Calculator::parity(int64_t a)
+{
+    return store(ops->parity(a));
+}
+
+int64_t Calculator::clz(int64_t a)
+{
+    return store(ops->clz(a));
+}
+
+int64_t Calculator::ctz(int64_t a)
+{
+    return store(ops->ctz(a));
+}
+
+int64_t Calculator::highestBit(int64_t a)
+{
+    return store(ops->highestBit(a));
+}
+
+int64_t Calculator::lowestBit(int64_t a)
+{
+    return store(ops->lowestBit(a));
+}
+
+int64_t Calculator::bswap(int64_t a)
+{
+    return store(ops->bswap(a));
+}
+
+int64_t Calculator::bitReverse(int64_t a)
+{
+    return store(ops->bitReverse(a));
+}
+
+int64_t Calculator::pdep(int64_t a, int64_t mask)
+{
+    return store(ops->pdep(a, mask));
+}
+
+int64_t Calculator::pext(int64_t a, int64_t mask)
+{
+    return store(ops->pext(a, mask));
+}
+
+int64_t Calculator::blsr(int64_t a)
+{
+    return store(ops->blsr(a));
+}
+
+int64_t Calculator::blsi(int64_t a)
+{
+    return store(ops->blsi(a));
 }
 
 // display
 std::string Calculator::display() const {
-    switch (base) {
-        case NumberBase::DEC: return toDec();
-        case NumberBase::BIN: return toBin();
-        case NumberBase::OCT: return toOct();
-        case NumberBase::HEX: return toHex();
+    if (wideBits)
+        return bigword::format(getWide(), base);
+
+    DisplayBuffer buf;
+    return std::string(display(buf));
+}
+
+std::string_view Calculator::display(DisplayBuffer& buf) const {
+    if (wideBits)
+        throw std::invalid_argument("Word too wide");
+
+    size_t n = formatValue(buf.data(), raw, ops->size, base);
+    buf[n] = '\0';
+    return std::string_view(buf.data(), n);
+}
+
+
+
+// ================= WIDE WORDS =================
+
+void Calculator::setWordBits(unsigned bits)
+{
+    switch (bits) {
+        case 8:  setWordSize(WordSize::BYTE);  return;
+        case 16: setWordSize(WordSize::WORD);  return;
+        case 32: setWordSize(WordSize::DWORD); return;
+        case 64: setWordSize(WordSize::QWORD); return;
     }
-    return "";
+    if (!BigWord::validBits(bits))
+        throw std::invalid_argument("Unsupported word size");
+
+    BigWord v = wideBits ? getWide().resized(bits) : BigWord(signedValue(), bits);
+    ops = &wordOpsFor(WordSize::QWORD);
+    wideBits = bits;
+    wide.assign(v.limbs().begin(), v.limbs().end());
+    raw = wide[0];
+    carryFlags = 0;
 }
 
-std::string Calculator::toDec() const {
-    return std::to_string(signedValue());
+unsigned Calculator::getWordBits() const {
+    return wideBits ? wideBits : static_cast<unsigned>(ops->bits);
 }
 
-std::string Calculator::toBin() const {
-    uint64_t v = raw & mask();
-    if (v == 0) return "0";
+BigWord Calculator::getWide() const
+{
+    if (!wideBits)
+        return BigWord(signedValue(), BigWord::minBits);
 
-    std::string r;
-    while (v) {
-        r = char('0' + (v & 1)) + r;
-        v >>= 1;
+    BigWord v(0, wideBits);
+    std::copy(wide.begin(), wide.end(), v.limbs().begin());
+    return v;
+}
+
+void Calculator::setWide(const BigWord& v)
+{
+    if (!wideBits) {
+        setValue(v.low());
+        return;
     }
-    return r;
+    BigWord r = v.resized(wideBits);
+    std::copy(r.limbs().begin(), r.limbs().end(), wide.begin());
+    raw = wide[0];
+    carryFlags = 0;
+}
+
+// keep a wide result as the current value; it has the operands' width,
+// which must be the current one
+BigWord Calculator::storeWide(BigWord v, uint32_t carry)
+{
+    if (v.bits() != wideBits)
+        throw std::invalid_argument("Size mismatch");
+
+    std::copy(v.limbs().begin(), v.limbs().end(), wide.begin());
+    raw = wide[0];
+    carryFlags = carry;
+    return v;
+}
+
+namespace {
+
+uint64_t topLimb(const BigWord& v) { return v.limbs().back(); }
+
+unsigned sameWidth(const BigWord& a, const BigWord& b)
+{
+    if (a.bits() != b.bits())
+        throw std::invalid_argument("Size mismatch");
+    return a.bits();
+}
+
+bool bitAt(const BigWord& v, int i) { return (v.limbs()[i / 64] >> (i % 64)) & 1; }
+
+// CF and OF of r = a + b and r = a - b at any width, from the top limbs
+// of the operands and the result: the carry out of the top bit and the
+// sign rules
+uint32_t addCarries(uint64_t a, uint64_t b, uint64_t r)
+{
+    uint64_t carry = (a & b) | ((a | b) & ~r);
+    uint64_t overflow = (a ^ r) & (b ^ r);
+    return wordops::carryFlags(carry >> 63, overflow >> 63);
 }
 
-std::string Calculator::toOct() const {
-    uint64_t v = raw & mask();
-    if (v == 0) return "0";
+uint32_t subCarries(uint64_t a, uint64_t b, uint64_t r)
+{
+    uint64_t borrow = (~a & b) | ((~a | b) & r);
+    uint64_t overflow = (a ^ b) & (a ^ r);
+    return wordops::carryFlags(borrow >> 63, overflow >> 63);
+}
 
-    std::string r;
-    while (v) {
-        r = char('0' + (v & 7)) + r;
-        v >>= 3;
+// the flags of two chained steps, as in wordops::adc()
+uint32_t chainCarries(uint32_t first, uint32_t second)
+{
+    return ((first | second) & flags::CF) | ((first ^ second) & flags::OF);
+}
+
+// IMUL's overflow for the wrapped product r = a * b
+bool productOverflows(const BigWord& a, const BigWord& b, const BigWord& r)
+{
+#if defined(__SIZEOF_INT128__)
+    if (a.bits() == 128) {
+        __int128 p;
+        return __builtin_mul_overflow(static_cast<__int128>(bigword::toInt128(a)),
+                                      static_cast<__int128>(bigword::toInt128(b)), &p);
     }
-    return r;
+#endif
+    if (a.isZero())
+        return false;
+
+    // dividing gives b back unless the product wrapped; -1 * MIN wraps to
+    // MIN, which the division would too
+    if (a == BigWord(-1, a.bits()))
+        return b.isNegative() && r == b;
+    return !(bigword::divide(r, a) == b);
+}
+
+} // namespace
+
+BigWord Calculator::add(const BigWord& a, const BigWord& b) {
+    if (modulus) [[unlikely]]
+        return storeWide(BigWord(static_cast<int64_t>(modulus->add(residue(a), residue(b))), sameWidth(a, b)));
+    BigWord r = bigword::add(a, b);
+    return storeWide(r, addCarries(topLimb(a), topLimb(b), topLimb(r)));
+}
+
+BigWord Calculator::subtract(const BigWord& a, const BigWord& b) {
+    if (modulus) [[unlikely]]
+        return storeWide(BigWord(static_cast<int64_t>(modulus->subtract(residue(a), residue(b))), sameWidth(a, b)));
+    BigWord r = bigword::subtract(a, b);
+    return storeWide(r, subCarries(topLimb(a), topLimb(b), topLimb(r)));
+}
+
+BigWord Calculator::multiply(const BigWord& a, const BigWord& b) {
+    if (modulus) [[unlikely]]
+        return storeWide(BigWord(static_cast<int64_t>(modulus->multiply(residue(a), residue(b))), sameWidth(a, b)));
+    BigWord r = bigword::multiply(a, b);
+    return storeWide(r, productOverflows(a, b, r) ? flags::CF | flags::OF : 0);
+}
+
+BigWord Calculator::divide(const BigWord& a, const BigWord& b) {
+    WideResult r = tryDivide(a, b);
+    if (!r)
+        throw std::invalid_argument(r.error == OpError::DivideByZero ? "Division by zero" : "N/A");
+
+    return r.value;
+}
+
+WideResult Calculator::tryDivide(const BigWord& a, const BigWord& b)
+{
+    if (modulus) [[unlikely]] {
+        const unsigned bits = sameWidth(a, b);
+        OpResult r = modDivide(residue(a), residue(b));
+        return r ? WideResult{ storeWide(BigWord(r.value, bits)) } : WideResult{ BigWord(0, bits), r.error };
+    }
+    if (b.isZero())
+        return { BigWord(0, a.bits()), OpError::DivideByZero };
+
+    BigWord r = bigword::divide(a, b);
+    bool wrapped = !a.isZero() && r == a && b == BigWord(-1, b.bits());
+    return { storeWide(r, wrapped ? flags::OF : 0) };
+}
+
+BigWord Calculator::adc(const BigWord& a, const BigWord& b)
+{
+    BigWord r = bigword::add(a, b);
+    uint32_t f = addCarries(topLimb(a), topLimb(b), topLimb(r));
+
+    if (carryFlags & flags::CF) {
+        BigWord s = bigword::add(r, BigWord(1, r.bits()));
+        f = chainCarries(f, addCarries(topLimb(r), 0, topLimb(s)));
+        r = s;
+    }
+    return storeWide(r, f);
+}
+
+BigWord Calculator::sbb(const BigWord& a, const BigWord& b)
+{
+    BigWord r = bigword::subtract(a, b);
+    uint32_t f = subCarries(topLimb(a), topLimb(b), topLimb(r));
+
+    if (carryFlags & flags::CF) {
+        BigWord s = bigword::subtract(r, BigWord(1, r.bits()));
+        f = chainCarries(f, subCarries(topLimb(r), 0, topLimb(s)));
+        r = s;
+    }
+    return storeWide(r, f);
+}
+
+BigWord Calculator::mod(const BigWord& a, const BigWord& b)
+{
+    WideResult r = tryMod(a, b);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+WideResult Calculator::tryMod(const BigWord& a, const BigWord& b)
+{
+    if (b.isZero())
+        return { BigWord(0, a.bits()), OpError::DivideByZero };
+
+    return { storeWide(bigword::mod(a, b)) };
+}
+
+BigWord Calculator::bitAnd(const BigWord& a, const BigWord& b) {
+    return storeWide(bigword::bitAnd(a, b));
+}
+
+BigWord Calculator::bitOr(const BigWord& a, const BigWord& b) {
+    return storeWide(bigword::bitOr(a, b));
+}
+
+BigWord Calculator::bitXor(const BigWord& a, const BigWord& b) {
+    return storeWide(bigword::bitXor(a, b));
+}
+
+BigWord Calculator::bitNot(const BigWord& a) {
+    return storeWide(bigword::bitNot(a));
+}
+
+BigWord Calculator::shl(const BigWord& a, int n) {
+    int bits = static_cast<int>(a.bits());
+    bool cf = n > 0 && n <= bits && bitAt(a, bits - n);
+    return storeWide(bigword::shl(a, n), cf ? flags::CF : 0);
+}
+
+BigWord Calculator::shr(const BigWord& a, int n) {
+    bool cf = n > 0 && n <= static_cast<int>(a.bits()) && bitAt(a, n - 1);
+    return storeWide(bigword::shr(a, n), cf ? flags::CF : 0);
+}
+
+BigWord Calculator::rol(const BigWord& a, int n) {
+    BigWord r = bigword::rol(a, n);
+    return storeWide(r, n != 0 && bitAt(r, 0) ? flags::CF : 0);
+}
+
+BigWord Calculator::ror(const BigWord& a, int n) {
+    BigWord r = bigword::ror(a, n);
+    return storeWide(r, n != 0 && r.isNegative() ? flags::CF : 0);
+}
+
+BigWord Calculator::isqrt(const BigWord& a)
+{
+    WideResult r = tryIsqrt(a);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+BigWord Calculator::reciprocal(const BigWord& a)
+{
+    WideResult r = tryReciprocal(a);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+WideResult Calculator::tryIsqrt(const BigWord& a)
+{
+    if (a.isNegative())
+        return { BigWord(0, a.bits()), OpError::Domain };
+
+    return { storeWide(bigword::isqrt(a)) };
+}
+
+// only 1 and -1 have an integer reciprocal
+WideResult Calculator::tryReciprocal(const BigWord& a)
+{
+    if (a.isZero())
+        return { BigWord(0, a.bits()), OpError::DivideByZero };
+
+    BigWord one(1, a.bits());
+    if (!bigword::mod(one, a).isZero())
+        return { BigWord(0, a.bits()), OpError::Domain };
+
+    return { storeWide(bigword::divide(one, a)) };
+}
+
+BigWord Calculator::pow(const BigWord& a, const BigWord& e)
+{
+    WideResult r = tryPow(a, e);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+BigWord Calculator::powmod(const BigWord& a, const BigWord& e, const BigWord& m)
+{
+    WideResult r = tryPowmod(a, e, m);
+    if (!r)
+        throw std::invalid_argument(errorText(r.error));
+
+    return r.value;
+}
+
+// square and multiply as in wordops::ipow(), with multiply()'s overflow
+// rule on every product
+WideResult Calculator::tryPow(const BigWord& a, const BigWord& e)
+{
+    const unsigned bits = a.bits();
+    if (e.bits() != bits)
+        throw std::invalid_argument("Size mismatch");
+
+    if (modulus) [[unlikely]] {
+        BigWord n = e.isNegative() ? bigword::subtract(BigWord(0, bits), e) : e;
+        OpResult r = modPow(residue(a), n.limbs(), e.isNegative());
+        return r ? WideResult{ storeWide(BigWord(r.value, bits)) } : WideResult{ BigWord(0, bits), r.error };
+    }
+
+    BigWord one(1, bits);
+    if (e.isNegative()) {
+        if (a.isZero())
+            return { BigWord(0, bits), OpError::DivideByZero };
+        if (!(a == one) && !(a == BigWord(-1, bits)))
+            return { BigWord(0, bits), OpError::Domain };
+    }
+
+    // the magnitude of the most negative e is still right read unsigned
+    BigWord n = e.isNegative() ? bigword::subtract(BigWord(0, bits), e) : e;
+    int top = bigword::highestBit(n);
+    BigWord r = one, b = a;
+    bool over = false;
+    for (int i = 0; i <= top; ++i) {
+        if (bitAt(n, i)) {
+            BigWord p = bigword::multiply(r, b);
+            over |= productOverflows(r, b, p);
+            r = p;
+        }
+        if (i < top) {
+            BigWord sq = bigword::multiply(b, b);
+            over |= productOverflows(b, b, sq);
+            b = sq;
+        }
+    }
+    return { storeWide(r, over ? flags::CF | flags::OF : 0) };
+}
+
+WideResult Calculator::tryPowmod(const BigWord& a, const BigWord& e, const BigWord& m)
+{
+    if (e.bits() != a.bits() || m.bits() != a.bits())
+        throw std::invalid_argument("Size mismatch");
+    if (m.isZero())
+        return { BigWord(0, a.bits()), OpError::DivideByZero };
+    if (e.isNegative())
+        return { BigWord(0, a.bits()), OpError::Domain };
+
+    return { storeWide(bigword::powmod(a, e, m)) };
+}
+
+// counts and indexes come back as numbers at the word width
+BigWord Calculator::popcount(const BigWord& a)
+{
+    return storeWide(BigWord(bigword::popcount(a), a.bits()));
+}
+
+BigWord Calculator::parity(const BigWord& a)
+{
+    return storeWide(BigWord(bigword::parity(a), a.bits()));
+}
+
+BigWord Calculator::clz(const BigWord& a)
+{
+    return storeWide(BigWord(bigword::clz(a), a.bits()));
+}
+
+BigWord Calculator::ctz(const BigWord& a)
+{
+    return storeWide(BigWord(bigword::ctz(a), a.bits()));
+}
+
+BigWord Calculator::highestBit(const BigWord& a)
+{
+    return storeWide(BigWord(bigword::highestBit(a), a.bits()));
+}
+
+BigWord Calculator::lowestBit(const BigWord& a)
+{
+    return storeWide(BigWord(bigword::lowestBit(a), a.bits()));
+}
+
+BigWord Calculator::bswap(const BigWord& a)
+{
+    return storeWide(bigword::bswap(a));
+}
+
+BigWord Calculator::bitReverse(const BigWord& a)
+{
+    return storeWide(bigword::bitReverse(a));
+}
+
+BigWord Calculator::pdep(const BigWord& a, const BigWord& mask)
+{
+    return storeWide(bigword::pdep(a, mask));
+}
+
+BigWord Calculator::pext(const BigWord& a, const BigWord& mask)
+{
+    return storeWide(bigword::pext(a, mask));
+}
+
+BigWord Calculator::blsr(const BigWord& a)
+{
+    return storeWide(bigword::blsr(a));
+}
+
+BigWord Calculator::blsi(const BigWord& a)
+{
+    return storeWide(bigword::blsi(a));
+}
+
+
+// ================= PARSING =================
+// Eight characters at a time: they are loaded as one 64-bit word, checked
+// with byte-wise range tests (SWAR) and folded into a number with a few
+// multiplies and shifts. Leftover characters go one by one.
+
+namespace {
+
+constexpr uint64_t bytes(uint8_t b) { return 0x0101010101010101ULL * b; }
+
+// 8 chars as bytes, first char lowest; false if any is not ASCII
+inline bool load8(const char* p, uint64_t& out)
+{
+    std::memcpy(&out, p, 8);
+    return (out & bytes(0x80)) == 0;
+}
+
+inline bool load8(const char16_t* p, uint64_t& out)
+{
+    uint64_t a, b;
+    std::memcpy(&a, p, 8);
+    std::memcpy(&b, p + 4, 8);
+    if ((a | b) & 0xFF80FF80FF80FF80ULL)
+        return false;
+
+    // keep the low byte of each 16-bit unit
+    a = (a | (a >> 8)) & 0x0000FFFF0000FFFFULL;
+    a = (a | (a >> 16)) & 0x00000000FFFFFFFFULL;
+    b = (b | (b >> 8)) & 0x0000FFFF0000FFFFULL;
+    b = (b | (b >> 16)) & 0x00000000FFFFFFFFULL;
+    out = a | (b << 32);
+    return true;
+}
+
+// bytes (all < 0x80) in [lo, hi] get their top bit set
+inline uint64_t inRange(uint64_t v, uint8_t lo, uint8_t hi)
+{
+    uint64_t ge = v + bytes(uint8_t(0x80 - lo));
+    uint64_t le = ~(v + bytes(uint8_t(0x7F - hi)));
+    return ge & le & bytes(0x80);
+}
+
+// value of 8 digits of a power-of-two base, `k` bits each, first char most significant
+inline uint64_t packDigits(uint64_t v, int k)
+{
+    v = ((v << k) | (v >> 8)) & 0x00FF00FF00FF00FFULL;
+    v = ((v << (2 * k)) | (v >> 16)) & 0x0000FFFF0000FFFFULL;
+    v = ((v << (4 * k)) | (v >> 32)) & 0x00000000FFFFFFFFULL;
+    return v;
+}
+
+// value of 8 validated decimal digits
+inline uint64_t packDecimal(uint64_t v)
+{
+    v -= bytes('0');
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return v;
+}
+
+// 8 chars to their value in `radix`; false if any is not a digit
+inline bool chunkValue(uint64_t v, int radix, uint64_t& out)
+{
+    switch (radix) {
+        case 2:
+            if ((v & bytes(0xFE)) != bytes('0')) return false;
+            out = packDigits(v - bytes('0'), 1);
+            return true;
+        case 8:
+            if ((v & bytes(0xF8)) != bytes('0')) return false;
+            out = packDigits(v - bytes('0'), 3);
+            return true;
+        case 10:
+            if (inRange(v, '0', '9') != bytes(0x80)) return false;
+            out = packDecimal(v);
+            return true;
+        case 16: {
+            uint64_t ok = inRange(v, '0', '9') | inRange(v, 'A', 'F') | inRange(v, 'a', 'f');
+            if (ok != bytes(0x80)) return false;
+            // '0'-'9' keep their low nibble, letters have bit 6 set: +9
+            uint64_t nib = (v & bytes(0x0F)) + ((v >> 6) & bytes(0x01)) * 9;
+            out = packDigits(nib, 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class Char>
+inline int digitOf(Char c)
+{
+    if (c >= '0' && c <= '9') return int(c - '0');
+    if (c >= 'a' && c <= 'f') return int(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F') return int(c - 'A' + 10);
+    return 99;
+}
+
+int radixOf(NumberBase b)
+{
+    switch (b) {
+        case NumberBase::BIN: return 2;
+        case NumberBase::OCT: return 8;
+        case NumberBase::HEX: return 16;
+        case NumberBase::DEC: return 10;
+    }
+    return 10;
 }
 
-std::string Calculator::toHex() const {
-    uint64_t v = raw & mask();
-    if (v == 0) return "0";
+template <class Char>
+ParseResult parseImpl(const Char* p, size_t n, NumberBase base, WordSize w)
+{
+    ParseResult r;
+    const WordOps& ops = wordOpsFor(w);
+
+    bool neg = false;
+    if (n && (p[0] == '-' || p[0] == '+')) {
+        neg = p[0] == '-';
+        ++p;
+        --n;
+    }
+
+    int radix = radixOf(base);
+    if (n > 1 && p[0] == '0') {
+        Char c = p[1];
+        int prefixed = (c == 'x' || c == 'X') ? 16
+                     : base == NumberBase::HEX ? 0
+                     : (c == 'o' || c == 'O') ? 8
+                     : (c == 'b' || c == 'B') ? 2 : 0;
+        if (prefixed) {
+            radix = prefixed;
+            p += 2;
+            n -= 2;
+        }
+    }
+
+    if (n == 0) {
+        r.error = ParseError::Empty;
+        return r;
+    }
+
+    const int bitsPerDigit = radix == 16 ? 4 : radix == 8 ? 3 : 1;
+    uint64_t mag = 0;
+    bool overflow = false;
+
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t chunk, v;
+        if (!load8(p, chunk) || !chunkValue(chunk, radix, v)) {
+            r.error = ParseError::InvalidDigit;
+            return r;
+        }
+        if (radix == 10) {
+            overflow |= __builtin_mul_overflow(mag, 100000000ULL, &mag);
+            overflow |= __builtin_add_overflow(mag, v, &mag);
+        } else {
+            int shift = 8 * bitsPerDigit;
+            overflow |= (mag >> (64 - shift)) != 0;
+            mag = (mag << shift) | v;
+        }
+    }
 
-    std::string r;
-    const char* d = "0123456789ABCDEF";
-    while (v) {
-        r = d[v & 0xF] + r;
-        v >>= 4;
+    for (; n; ++p, --n) {
+        int d = digitOf(*p);
+        if (d >= radix) {
+            r.error = ParseError::InvalidDigit;
+            return r;
+        }
+        overflow |= __builtin_mul_overflow(mag, static_cast<uint64_t>(radix), &mag);
+        overflow |= __builtin_add_overflow(mag, static_cast<uint64_t>(d), &mag);
     }
+
+    // any bit pattern of the word, or down to the most negative value
+    uint64_t limit = neg ? (ops.mask >> 1) + 1 : ops.mask;
+    if (overflow || mag > limit) {
+        r.error = ParseError::Overflow;
+        return r;
+    }
+
+    r.value = ops.signExtend(neg ? 0 - mag : mag);
     return r;
 }
+
+} // namespace
+
+ParseResult parseNumber(std::string_view text, NumberBase base, WordSize w) noexcept
+{
+    return parseImpl(text.data(), text.size(), base, w);
+}
+
+ParseResult parseNumber(std::u16string_view text, NumberBase base, WordSize w) noexcept
+{
+    return parseImpl(text.data(), text.size(), base, w);
+}
@@ -1,6 +1,11 @@
 #pragma once
+#include <array>
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 enum class NumberBase {
     DEC,
@@ -13,9 +18,105 @@ enum class WordSize {
     BYTE  = 8,
     WORD  = 16,
     DWORD = 32,
-    QWORD = 64
+    QWORD = 64,
+    DQWORD = 128    // kept as two limbs, see setWordBits()
 };
 
+// ================= PARSING =================
+
+enum class ParseError {
+    None,
+    Empty,          // no digits
+    InvalidDigit,   // a character that is not a digit of the base
+    Overflow        // does not fit the word size
+};
+
+struct ParseResult {
+    int64_t value = 0;   // sign-extended at the word size
+    ParseError error = ParseError::None;
+
+    explicit operator bool() const { return error == ParseError::None; }
+};
+
+// Parses an optionally signed number in `base`; 0x, and outside HEX also 0o
+// and 0b, prefixes select another base. Any bit pattern of the word size
+// is accepted (FF is -1 in a BYTE, so is 255); negative decimals must fit
+// the signed range. Never throws.
+ParseResult parseNumber(std::string_view text, NumberBase base, WordSize w) noexcept;
+ParseResult parseNumber(std::u16string_view text, NumberBase base, WordSize w) noexcept;
+
+// ================= ERRORS =================
+
+// Why a checked op has no result. The try* ops below return it instead of
+// throwing, so they are cheap in loops and usable from noexcept code; the
+// plain ops throw std::invalid_argument for the same cases.
+enum class OpError {
+    None,
+    DivideByZero,   // divide, mod or reciprocal of 0
+    Domain          // isqrt of a negative, reciprocal with no integer result
+};
+
+struct OpResult {
+    int64_t value = 0;   // 0 on error
+    OpError error = OpError::None;
+
+    explicit operator bool() const { return error == OpError::None; }
+};
+
+// the wide counterpart, defined in bigword.h
+struct WideResult;
+
+// longest text display() can produce: 64 binary digits
+inline constexpr size_t maxDisplayLength = 64;
+
+// room for the longest display() text plus a terminator
+using DisplayBuffer = std::array<char, maxDisplayLength + 1>;
+
+// ================= FLAGS =================
+
+// x86 condition flags, at their EFLAGS bit positions. CF and OF come from
+// the op that produced the value, ZF, SF and PF describe the value itself.
+namespace flags {
+inline constexpr uint32_t CF = 1u << 0;    // carry out of the word, or borrow
+inline constexpr uint32_t PF = 1u << 2;    // even number of set bits in the low byte
+inline constexpr uint32_t ZF = 1u << 6;    // the value is 0
+inline constexpr uint32_t SF = 1u << 7;    // top bit of the word
+inline constexpr uint32_t OF = 1u << 11;   // signed overflow
+}
+
+// the whole product of two words, as x86 MUL / IMUL leave it in rDX:rAX;
+// both halves are sign-extended at the word size like every other value
+struct HiLo {
+    int64_t hi;
+    int64_t lo;
+};
+
+// g = gcd(a, b) = a * x + b * y, from Calculator::egcd()
+struct Bezout {
+    int64_t g;
+    int64_t x;
+    int64_t y;
+};
+
+// the multiply-shift sequence replacing a division by a constant at one
+// word size, and how it did against real division (divmagic.h)
+struct DivisionMagic {
+    int64_t divisor;            // narrowed to the word, as the sequence sees it
+    int bits;
+    bool isSigned;
+    uint64_t multiplier;        // word bits; 0 when d is a power of two
+    int shift;
+    bool add;                   // the multiplier needs one bit more than the word
+    uint64_t tested = 0;
+    uint64_t failures = 0;
+    uint64_t firstFailure = 0;  // word bits of the first failing dividend
+    bool exhaustive = false;    // every dividend was tried
+};
+
+struct WordOps;
+class BigWord;
+namespace wordops { struct Modulus; }
+
 class Calculator {
 public:
     Calculator();
@@ -25,11 +126,46 @@ public:
     int64_t multiply(int64_t a, int64_t b);
     int64_t divide(int64_t a, int64_t b);
 
+    // ADC / SBB: a + b + CF and a - b - CF, carrying the CF of the last op
+    // so multi-word sums can be chained
+    int64_t adc(int64_t a, int64_t b);
+    int64_t sbb(int64_t a, int64_t b);
+
+    // MUL (unsigned) and IMUL (signed): the 2W-bit product, 128 bits for a
+    // QWORD. The low half becomes the value; CF and OF are set when the high
+    // half is more than the extension of the low one.
+    HiLo mulHiLo(int64_t a, int64_t b);
+    HiLo imulHiLo(int64_t a, int64_t b);
+
+    // Every op sets the flags like its x86 counterpart: add / subtract /
+    // adc / sbb set CF and OF, multiply is IMUL, a divide of the most
+    // negative value by -1 (which wraps) sets OF, shifts and rotates leave
+    // the last bit moved out in CF, everything else clears CF and OF.
+    // setValue() and friends clear them too. ZF, SF and PF always describe
+    // the current value.
+    uint32_t getFlags() const;
+    void setFlags(uint32_t f);          // only CF and OF are kept
+
+    // Modular mode: with m > 0, add, subtract, multiply, divide and pow
+    // (scalar, batch and wide) work in Z/m. Operands are read as their least
+    // non-negative residues, results are residues too and are then stored
+    // at the word size as usual, with CF and OF when one does not fit.
+    // divide multiplies by the inverse of b (DIV/0 for b = 0 mod m, N/A when
+    // there is none) and a negative exponent raises the inverse. The
+    // reduction constants are worked out here, so the ops never divide.
+    // m = 0 leaves the mode, a negative m throws. adc / sbb, the MUL / IMUL
+    // halves, the flagged batch forms and the bit ops stay plain.
+    void setModulus(int64_t m);
+    int64_t getModulus() const;         // 0 outside modular mode
+
     void setBase(NumberBase b);
+    NumberBase getBase() const;
     void setWordSize(WordSize w);
+    WordSize getWordSize() const;
 
     int64_t getValue() const;
     std::string display() const;
+    std::string_view display(DisplayBuffer& buf) const;   // no allocation, see format.h; narrow words only
 
     void setRaw(uint64_t v);
     void setValue(int64_t v);
@@ -49,17 +185,256 @@ public:
     int64_t mod(int64_t a, int64_t b);
     int64_t isqrt(int64_t a);
     int64_t reciprocal(int64_t a);
+
+    // exact integer roots and logarithms (wordops.h). Odd roots keep the
+    // sign, even roots of a negative and logarithms of a < 1 are N/A, so is
+    // a root of degree n < 1. digitCount() is the number of digits
+    // display() shows for a, without the sign.
+    int64_t icbrt(int64_t a);
+    int64_t iroot(int64_t a, int n);
+    int64_t ilog2(int64_t a);
+    int64_t ilog10(int64_t a);
+    int64_t digitCount(int64_t a);
+
+    // a^e wrapping at the word size; CF and OF are set when the exact power
+    // does not fit. A negative e is a power of 1/a, which only 1 and -1
+    // have (N/A otherwise, DIV/0 for 0).
+    int64_t pow(int64_t a, int64_t e);
+
+    // a^e mod |m|, in [0, |m|): the products are reduced before they can wrap
+    // (Montgomery form for an odd m, 128-bit intermediates otherwise). A
+    // residue the word cannot hold as a positive value wraps at the word size
+    // and sets CF and OF, like gcd. m = 0 is DIV/0, a negative e N/A.
+    int64_t powmod(int64_t a, int64_t e, int64_t m);
+
+    // number theory on the magnitudes (numtheory.h). gcd and lcm are never
+    // negative; a result the word cannot hold as a positive value (the gcd
+    // of MIN and 0, a big lcm) wraps and sets CF and OF. egcd stores g.
+    // modInverse is in [0, |m|) and wraps the same way: DIV/0 for m = 0,
+    // N/A without an inverse.
+    // isPrime stores 1 or 0 and is exact for every 64-bit value, negatives
+    // are not prime. factor() gives the prime factors of |a| in ascending
+    // order (none for 0 and 1) and leaves the stored value alone.
+    int64_t gcd(int64_t a, int64_t b);
+    int64_t lcm(int64_t a, int64_t b);
+    Bezout egcd(int64_t a, int64_t b);
+    int64_t modInverse(int64_t a, int64_t m);
+    int64_t isPrime(int64_t a);
+    std::vector<int64_t> factor(int64_t a) const;
+
+    // The magic multiplier, shift and add indicator that replace division
+    // by d at the current word size, signed (IDIV) or unsigned (DIV), then
+    // checked: every dividend up to a DWORD, spread over `threads` threads
+    // (0 = one per core), edge cases and random samples for a QWORD.
+    // divmagic::toC() prints the result. DIV/0 for d = 0 in the word, N/A
+    // for a wide word; the stored value is not touched.
+    DivisionMagic divisionMagic(int64_t d, bool isSigned, unsigned threads = 0) const;
+
+    // the same without exceptions; on error the stored value and flags are
+    // left alone
+    OpResult tryDivide(int64_t a, int64_t b) noexcept;
+    OpResult tryMod(int64_t a, int64_t b) noexcept;
+    OpResult tryIsqrt(int64_t a) noexcept;
+    OpResult tryReciprocal(int64_t a) noexcept;
+    OpResult tryIroot(int64_t a, int n) noexcept;
+    OpResult tryIlog2(int64_t a) noexcept;
+    OpResult tryIlog10(int64_t a) noexcept;
+    OpResult tryPow(int64_t a, int64_t e) noexcept;
+    OpResult tryPowmod(int64_t a, int64_t e, int64_t m) noexcept;
+    OpResult tryModInverse(int64_t a, int64_t m) noexcept;
+
+    // bit manipulation at the current word size (clz of a BYTE counts
+    // from bit 7); see wordops.h
+    int64_t popcount(int64_t a);
+    int64_t parity(int64_t a);
+    int64_t clz(int64_t a);
+    int64_t ctz(int64_t a);
+    int64_t highestBit(int64_t a);      // -1 for 0
+    int64_t lowestBit(int64_t a);       // -1 for 0
+    int64_t bswap(int64_t a);
+    int64_t bitReverse(int64_t a);
+    int64_t pdep(int64_t a, int64_t mask);
+    int64_t pext(int64_t a, int64_t mask);
+    int64_t blsr(int64_t a);            // clear the lowest set bit
+    int64_t blsi(int64_t a);            // isolate the lowest set bit
+
+    // batch variants: out[i] = op(a[i], b[i]) at the current word size,
+    // same results as the scalar ops but the stored value is not touched
+    void add(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void subtract(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void multiply(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+
+    // the same with per-element CF and OF as bitmasks: element i sets bit
+    // i % 64 of carry[i / 64] and overflow[i / 64]; both need (n + 63) / 64
+    // words, bits past the last element are cleared
+    void add(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+             std::span<uint64_t> carry, std::span<uint64_t> overflow) const;
+    void subtract(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                  std::span<uint64_t> carry, std::span<uint64_t> overflow) const;
+    void multiply(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                  std::span<uint64_t> carry, std::span<uint64_t> overflow) const;
+
+    void divide(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+
+    void bitAnd(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void bitOr(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void bitXor(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void bitNot(std::span<const int64_t> a, std::span<int64_t> out) const;
+
+    void shl(std::span<const int64_t> a, int n, std::span<int64_t> out) const;
+    void shr(std::span<const int64_t> a, int n, std::span<int64_t> out) const;
+
+    void rol(std::span<const int64_t> a, int n, std::span<int64_t> out) const;
+    void ror(std::span<const int64_t> a, int n, std::span<int64_t> out) const;
+
+    void mod(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void isqrt(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void reciprocal(std::span<const int64_t> a, std::span<int64_t> out) const;
+
+    // One divisor for the whole batch: its reciprocal is worked out once and
+    // the lanes multiply instead of dividing. divide and mod give the same
+    // results as the span forms; the Unsigned pair divides the word's bit
+    // pattern, as DIV does. d == 0 throws.
+    void divide(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const;
+    void mod(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const;
+    void divideUnsigned(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const;
+    void modUnsigned(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const;
+
+    // Non-throwing batch forms: every lane is computed, a failing one gets 0
+    // and sets bit i % 64 of failed[i / 64] ((n + 63) / 64 words, bits past
+    // the last lane cleared); an empty `failed` only counts. They return the
+    // number of failed lanes and only throw for mismatched sizes.
+    size_t tryDivide(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                     std::span<uint64_t> failed) const;
+    size_t tryMod(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                  std::span<uint64_t> failed) const;
+    size_t tryIsqrt(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const;
+    size_t tryReciprocal(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const;
+
+    void icbrt(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void iroot(std::span<const int64_t> a, int n, std::span<int64_t> out) const;
+    void ilog2(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void ilog10(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void digitCount(std::span<const int64_t> a, std::span<int64_t> out) const;
+
+    size_t tryIroot(std::span<const int64_t> a, int n, std::span<int64_t> out, std::span<uint64_t> failed) const;
+    size_t tryIlog2(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const;
+    size_t tryIlog10(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const;
+
+    // out[i] = a[i]^e[i], and mod m for powmod: the modulus is shared, so
+    // its Montgomery constants are worked out once for the whole batch
+    void pow(std::span<const int64_t> a, std::span<const int64_t> e, std::span<int64_t> out) const;
+    void powmod(std::span<const int64_t> a, std::span<const int64_t> e, int64_t m, std::span<int64_t> out) const;
+
+    size_t tryPow(std::span<const int64_t> a, std::span<const int64_t> e, std::span<int64_t> out,
+                  std::span<uint64_t> failed) const;
+    size_t tryPowmod(std::span<const int64_t> a, std::span<const int64_t> e, int64_t m, std::span<int64_t> out,
+                     std::span<uint64_t> failed) const;
+
+    void gcd(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void lcm(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const;
+    void modInverse(std::span<const int64_t> a, int64_t m, std::span<int64_t> out) const;
+    size_t tryModInverse(std::span<const int64_t> a, int64_t m, std::span<int64_t> out,
+                         std::span<uint64_t> failed) const;
+
+    // split over `threads` threads (0 = one per core), batches too small
+    // to be worth a thread stay on the calling one
+    void isPrime(std::span<const int64_t> a, std::span<int64_t> out, unsigned threads = 0) const;
+
+    void popcount(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void parity(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void clz(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void ctz(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void highestBit(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void lowestBit(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void bswap(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void bitReverse(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void pdep(std::span<const int64_t> a, std::span<const int64_t> mask, std::span<int64_t> out) const;
+    void pext(std::span<const int64_t> a, std::span<const int64_t> mask, std::span<int64_t> out) const;
+    void blsr(std::span<const int64_t> a, std::span<int64_t> out) const;
+    void blsi(std::span<const int64_t> a, std::span<int64_t> out) const;
+
+    // wide words, 128 to 4096 bits (see bigword.h). 8, 16, 32 and 64 select
+    // the WordSize; wider multiples of 64 switch to a limb array while the
+    // narrow sizes keep their fast path. 128 bits is DQWORD, wider words
+    // report QWORD from getWordSize(). In wide mode the int64_t ops work at
+    // 64 bits and sign-extend their result, getValue() is the low 64 bits
+    // and display() shows the whole word.
+    void setWordBits(unsigned bits);
+    unsigned getWordBits() const;
+    bool isWide() const { return wideBits != 0; }
+
+    BigWord getWide() const;           // the value at the current width, at least 128 bits
+    void setWide(const BigWord& v);    // truncated or sign-extended to it
+
+    // operands must have the current width: throws "Size mismatch"
+    BigWord add(const BigWord& a, const BigWord& b);
+    BigWord subtract(const BigWord& a, const BigWord& b);
+    BigWord multiply(const BigWord& a, const BigWord& b);
+    BigWord divide(const BigWord& a, const BigWord& b);
+    BigWord mod(const BigWord& a, const BigWord& b);
+    BigWord adc(const BigWord& a, const BigWord& b);
+    BigWord sbb(const BigWord& a, const BigWord& b);
+
+    BigWord bitAnd(const BigWord& a, const BigWord& b);
+    BigWord bitOr(const BigWord& a, const BigWord& b);
+    BigWord bitXor(const BigWord& a, const BigWord& b);
+    BigWord bitNot(const BigWord& a);
+
+    BigWord shl(const BigWord& a, int n);
+    BigWord shr(const BigWord& a, int n);
+    BigWord rol(const BigWord& a, int n);
+    BigWord ror(const BigWord& a, int n);
+
+    BigWord isqrt(const BigWord& a);
+    BigWord reciprocal(const BigWord& a);
+    BigWord pow(const BigWord& a, const BigWord& e);
+    BigWord powmod(const BigWord& a, const BigWord& e, const BigWord& m);
+
+    // non-throwing, apart from "Size mismatch"
+    WideResult tryDivide(const BigWord& a, const BigWord& b);
+    WideResult tryMod(const BigWord& a, const BigWord& b);
+    WideResult tryIsqrt(const BigWord& a);
+    WideResult tryReciprocal(const BigWord& a);
+    WideResult tryPow(const BigWord& a, const BigWord& e);
+    WideResult tryPowmod(const BigWord& a, const BigWord& e, const BigWord& m);
+
+    BigWord popcount(const BigWord& a);
+    BigWord parity(const BigWord& a);
+    BigWord clz(const BigWord& a);
+    BigWord ctz(const BigWord& a);
+    BigWord highestBit(const BigWord& a);
+    BigWord lowestBit(const BigWord& a);
+    BigWord bswap(const BigWord& a);
+    BigWord bitReverse(const BigWord& a);
+    BigWord pdep(const BigWord& a, const BigWord& mask);
+    BigWord pext(const BigWord& a, const BigWord& mask);
+    BigWord blsr(const BigWord& a);
+    BigWord blsi(const BigWord& a);
+
 private:
     uint64_t raw;
     NumberBase base;
-    WordSize wordSize;
+    const WordOps* ops;   // word-size specific core, see wordops.h
+
+    unsigned wideBits = 0;          // 0 on the narrow fast path
+    std::vector<uint64_t> wide;     // limbs in wide mode, wide[0] == raw
+
+    uint32_t carryFlags = 0;        // CF and OF of the last op
+
+    // set in modular mode; immutable, so copies share it
+    std::shared_ptr<const wordops::Modulus> modulus;
 
     uint64_t mask() const;
     int64_t  signedValue() const;
+    int64_t  store(int64_t v, uint32_t carry = 0);
+    void     syncWide(int64_t v);
+    BigWord  storeWide(BigWord v, uint32_t carry = 0);
 
-    std::string toDec() const;
-    std::string toBin() const;
-    std::string toOct() const;
-    std::string toHex() const;
+    // modular mode, on residues
+    int64_t  storeResidue(uint64_t r);
+    uint64_t residue(const BigWord& a) const;
+    OpResult modDivide(uint64_t a, uint64_t b) const;
+    OpResult modPow(uint64_t a, std::span<const uint64_t> e, bool negative) const;
 
 };
@@ -0,0 +1,678 @@
+#include "calculator.h"
+#include "batch_kernels.h"
+#include "numtheory.h"
+#include "wordops.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <thread>
+
+// Batch operations. The lanes run in the kernels of batch_kernels.inc,
+// built per instruction set and picked at run time (see isa.h); every lane
+// does the plain 64-bit operation and then the same mask + sign extension
+// the scalar path does in signedValue(), written branch-free as
+// ((v & mask) ^ sign) - sign so it vectorizes.
+
+namespace {
+
+void checkSizes(size_t a, size_t b, size_t out)
+{
+    if (a != b || out < a)
+        throw std::invalid_argument("Size mismatch");
+}
+
+Lanes lanesFor(int bits, uint64_t mask)
+{
+    return { mask, 1ULL << (bits - 1), bits };
+}
+
+// one bit per element
+void checkMasks(size_t n, size_t carry, size_t overflow)
+{
+    size_t words = (n + 63) / 64;
+    if (carry < words || overflow < words)
+        throw std::invalid_argument("Size mismatch");
+}
+
+// Runs a checked op over every lane, 64 at a time: a failed lane gets 0
+// and its bit in `failed` (when given). Returns the number of failures, so
+// the throwing ops can decide once, after the loop.
+template <class Lane>
+size_t checkedLanes(size_t n, int64_t* out, uint64_t* failed, Lane lane)
+{
+    size_t count = 0;
+    for (size_t first = 0; first < n; first += 64) {
+        const size_t end = n - first < 64 ? n : first + 64;
+        uint64_t bad = 0;
+        for (size_t i = first; i < end; ++i) {
+            OpResult r = lane(i);
+            out[i] = r.value;
+            bad |= static_cast<uint64_t>(!r) << (i - first);
+        }
+        if (failed)
+            failed[first / 64] = bad;
+        count += static_cast<size_t>(wordops::popcount<WordSize::QWORD>(static_cast<int64_t>(bad)));
+    }
+    return count;
+}
+
+// Calls fn(first, last) on contiguous slices of [0, n), one per thread
+// (0 = one per core, as in stream.cpp), the first on the calling thread.
+// Below minPerThread lanes a slice is not worth a thread start.
+template <class Fn>
+void parallelRanges(size_t n, unsigned threads, Fn fn)
+{
+    constexpr size_t minPerThread = 4096;
+    threads = std::max(1u, threads ? threads : std::thread::hardware_concurrency());
+    size_t slices = std::min<size_t>(threads, std::max<size_t>(1, n / minPerThread));
+    size_t step = (n + slices - 1) / slices;
+
+    std::vector<std::thread> workers;
+    for (size_t first = step; first < n; first += step)
+        workers.emplace_back(fn, first, std::min(n, first + step));
+    fn(0, std::min(n, step));
+    for (auto& t : workers)
+        t.join();
+}
+
+uint64_t magnitude(int64_t a)
+{
+    return a < 0 ? 0 - static_cast<uint64_t>(a) : static_cast<uint64_t>(a);
+}
+
+// modular mode: out[i] = fn(a[i] mod m, b[i] mod m), narrowed to the word
+template <class Fn>
+void residueLanes(const wordops::Modulus& m, const WordOps& ops, std::span<const int64_t> a,
+                  std::span<const int64_t> b, std::span<int64_t> out, Fn fn)
+{
+    for (size_t i = 0; i < a.size(); ++i)
+        out[i] = ops.signExtend(fn(m.residue(a[i]), m.residue(b[i])));
+}
+
+} // namespace
+
+
+// Granlund-Montgomery with libdivide's choice of magic: the smallest
+// 2^(64 + l) / d rounded up, which needs a 65th bit (`add`) for about
+// half the divisors, and a plain shift for powers of two.
+Divider makeDivider(int64_t d, bool isSigned, uint64_t mask)
+{
+    Divider r{};
+    r.isSigned = isSigned;
+    r.negative = isSigned && d < 0;
+    r.divisor = isSigned ? static_cast<uint64_t>(d) : static_cast<uint64_t>(d) & mask;
+
+    const uint64_t abs = isSigned ? magnitude(d) : r.divisor;
+    const int l = 63 - std::countl_zero(abs);
+    if ((abs & (abs - 1)) == 0) {
+        r.shift = l;
+        return r;
+    }
+
+    // signed magics keep a bit for the sign: one power of two lower
+    const int p = isSigned ? l - 1 : l;
+    uint64_t rem;
+    uint64_t m = wordops::divide128(1ULL << p, 0, abs, rem);
+    if (abs - rem < (1ULL << l)) {
+        r.shift = p;
+    }
+    else {
+        m += m;
+        const uint64_t twice = rem + rem;
+        if (twice >= abs || twice < rem)
+            ++m;
+        r.shift = l;
+        r.add = true;
+    }
+    ++m;
+    r.magic = r.negative ? 0 - m : m;
+    return r;
+}
+
+
+// ================= BATCH OPERATIONS =================
+
+void Calculator::add(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    if (modulus) [[unlikely]]
+        return residueLanes(*modulus, *ops, a, b, out,
+                            [&m = *modulus](uint64_t x, uint64_t y) { return m.add(x, y); });
+    batchKernels().add(a.data(), b.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::subtract(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    if (modulus) [[unlikely]]
+        return residueLanes(*modulus, *ops, a, b, out,
+                            [&m = *modulus](uint64_t x, uint64_t y) { return m.subtract(x, y); });
+    batchKernels().subtract(a.data(), b.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::multiply(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    if (modulus) [[unlikely]]
+        return residueLanes(*modulus, *ops, a, b, out,
+                            [&m = *modulus](uint64_t x, uint64_t y) { return m.multiply(x, y); });
+    batchKernels().multiply(a.data(), b.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::add(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                     std::span<uint64_t> carry, std::span<uint64_t> overflow) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    checkMasks(a.size(), carry.size(), overflow.size());
+    batchKernels().flagged(FlagKind::Add, a.data(), b.data(), out.data(), a.size(),
+                           carry.data(), overflow.data(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::subtract(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                          std::span<uint64_t> carry, std::span<uint64_t> overflow) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    checkMasks(a.size(), carry.size(), overflow.size());
+    batchKernels().flagged(FlagKind::Subtract, a.data(), b.data(), out.data(), a.size(),
+                           carry.data(), overflow.data(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::multiply(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                          std::span<uint64_t> carry, std::span<uint64_t> overflow) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    checkMasks(a.size(), carry.size(), overflow.size());
+    batchKernels().flagged(FlagKind::Multiply, a.data(), b.data(), out.data(), a.size(),
+                           carry.data(), overflow.data(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::bitAnd(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    batchKernels().bitAnd(a.data(), b.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::bitOr(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    batchKernels().bitOr(a.data(), b.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::bitXor(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    batchKernels().bitXor(a.data(), b.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::bitNot(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bitNot(a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::shl(std::span<const int64_t> a, int n, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    int bits = ops->bits;
+
+    if (n < 0 || n >= bits) {
+        for (size_t i = 0; i < a.size(); ++i) out[i] = 0;
+        return;
+    }
+    batchKernels().shift(ShiftKind::Left, a.data(), n, out.data(), a.size(), lanesFor(bits, mask()));
+}
+
+void Calculator::shr(std::span<const int64_t> a, int n, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    int bits = ops->bits;
+
+    if (n < 0 || n >= bits) {
+        for (size_t i = 0; i < a.size(); ++i) out[i] = 0;
+        return;
+    }
+    batchKernels().shift(ShiftKind::Right, a.data(), n, out.data(), a.size(), lanesFor(bits, mask()));
+}
+
+void Calculator::rol(std::span<const int64_t> a, int n, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    int bits = ops->bits;
+    n = ((n % bits) + bits) % bits;
+    batchKernels().shift(ShiftKind::RotLeft, a.data(), n, out.data(), a.size(), lanesFor(bits, mask()));
+}
+
+void Calculator::ror(std::span<const int64_t> a, int n, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    int bits = ops->bits;
+    n = ((n % bits) + bits) % bits;
+    batchKernels().shift(ShiftKind::RotRight, a.data(), n, out.data(), a.size(), lanesFor(bits, mask()));
+}
+
+// ================= NON-VECTOR OPS =================
+// No SIMD integer divide / sqrt, these run the word-size core per element.
+// A failing lane does not stop the loop: the throwing forms still fill
+// `out` and throw at the end.
+
+void Calculator::divide(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    if (!modulus) {
+        if (tryDivide(a, b, out, {}))
+            throw std::invalid_argument("Division by zero");
+        return;
+    }
+
+    // a modular quotient fails two ways: the message is the first lane's,
+    // as the scalar divide() would give for it
+    OpError first = OpError::None;
+    checkedLanes(a.size(), out.data(), nullptr, [&](size_t i) {
+        OpResult r = modDivide(modulus->residue(a[i]), modulus->residue(b[i]));
+        if (!r && first == OpError::None)
+            first = r.error;
+        return r ? OpResult{ ops->signExtend(static_cast<uint64_t>(r.value)) } : r;
+    });
+    if (first != OpError::None)
+        throw std::invalid_argument(first == OpError::DivideByZero ? "Division by zero" : "N/A");
+}
+
+void Calculator::mod(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    if (tryMod(a, b, out, {}))
+        throw std::invalid_argument("DIV/0");
+}
+
+void Calculator::isqrt(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (tryIsqrt(a, out, {}))
+        throw std::invalid_argument("N/A");
+}
+
+void Calculator::reciprocal(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+
+    // two ways to fail: the message is the first lane's
+    Calculator c(*this);
+    OpError first = OpError::None;
+    checkedLanes(a.size(), out.data(), nullptr, [&](size_t i) {
+        OpResult r = c.tryReciprocal(a[i]);
+        if (!r && first == OpError::None)
+            first = r.error;
+        return r;
+    });
+    if (first != OpError::None)
+        throw std::invalid_argument(first == OpError::DivideByZero ? "DIV/0" : "N/A");
+}
+
+// ================= INVARIANT DIVISOR =================
+
+void Calculator::divide(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (d == 0)
+        throw std::invalid_argument("Division by zero");
+    if (modulus) [[unlikely]] {
+        // a modular quotient is a product with d's inverse, not a reciprocal
+        std::vector<int64_t> b(a.size(), d);
+        return divide(a, b, out);
+    }
+    batchKernels().divideBy(a.data(), out.data(), a.size(), makeDivider(d, true, mask()), false,
+                            lanesFor(ops->bits, mask()));
+}
+
+void Calculator::mod(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (d == 0)
+        throw std::invalid_argument("DIV/0");
+    batchKernels().divideBy(a.data(), out.data(), a.size(), makeDivider(d, true, mask()), true,
+                            lanesFor(ops->bits, mask()));
+}
+
+void Calculator::divideUnsigned(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if ((static_cast<uint64_t>(d) & mask()) == 0)
+        throw std::invalid_argument("Division by zero");
+    batchKernels().divideBy(a.data(), out.data(), a.size(), makeDivider(d, false, mask()), false,
+                            lanesFor(ops->bits, mask()));
+}
+
+void Calculator::modUnsigned(std::span<const int64_t> a, int64_t d, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if ((static_cast<uint64_t>(d) & mask()) == 0)
+        throw std::invalid_argument("DIV/0");
+    batchKernels().divideBy(a.data(), out.data(), a.size(), makeDivider(d, false, mask()), true,
+                            lanesFor(ops->bits, mask()));
+}
+
+// A zero divisor is swapped for 1 so the divide never traps.
+size_t Calculator::tryDivide(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                             std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    if (modulus) [[unlikely]]
+        return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(), [&](size_t i) {
+            OpResult r = modDivide(modulus->residue(a[i]), modulus->residue(b[i]));
+            return r ? OpResult{ ops->signExtend(static_cast<uint64_t>(r.value)) } : r;
+        });
+
+    auto div = ops->divide;
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(), [&](size_t i) {
+        bool zero = b[i] == 0;
+        int64_t q = div(a[i], zero ? 1 : b[i]);
+        return zero ? OpResult{ 0, OpError::DivideByZero } : OpResult{ q };
+    });
+}
+
+size_t Calculator::tryMod(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out,
+                          std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    auto md = ops->mod;
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(), [&](size_t i) {
+        bool zero = b[i] == 0;
+        int64_t r = md(a[i], zero ? 1 : b[i]);
+        return zero ? OpResult{ 0, OpError::DivideByZero } : OpResult{ r };
+    });
+}
+
+size_t Calculator::tryIsqrt(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    Calculator c(*this);
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(),
+                        [&](size_t i) { return c.tryIsqrt(a[i]); });
+}
+
+size_t Calculator::tryReciprocal(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    Calculator c(*this);
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(),
+                        [&](size_t i) { return c.tryReciprocal(a[i]); });
+}
+
+// ================= ROOTS AND LOGARITHMS =================
+// Newton steps and table lookups, no SIMD either.
+
+void Calculator::icbrt(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+
+    Calculator c(*this);
+    for (size_t i = 0; i < a.size(); ++i)
+        out[i] = c.icbrt(a[i]);
+}
+
+void Calculator::iroot(std::span<const int64_t> a, int n, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (tryIroot(a, n, out, {}))
+        throw std::invalid_argument("N/A");
+}
+
+void Calculator::ilog2(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (tryIlog2(a, out, {}))
+        throw std::invalid_argument("N/A");
+}
+
+void Calculator::ilog10(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (tryIlog10(a, out, {}))
+        throw std::invalid_argument("N/A");
+}
+
+void Calculator::digitCount(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+
+    Calculator c(*this);
+    for (size_t i = 0; i < a.size(); ++i)
+        out[i] = c.digitCount(a[i]);
+}
+
+size_t Calculator::tryIroot(std::span<const int64_t> a, int n, std::span<int64_t> out,
+                            std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    Calculator c(*this);
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(),
+                        [&](size_t i) { return c.tryIroot(a[i], n); });
+}
+
+size_t Calculator::tryIlog2(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    Calculator c(*this);
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(),
+                        [&](size_t i) { return c.tryIlog2(a[i]); });
+}
+
+size_t Calculator::tryIlog10(std::span<const int64_t> a, std::span<int64_t> out, std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    Calculator c(*this);
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(),
+                        [&](size_t i) { return c.tryIlog10(a[i]); });
+}
+
+// ================= POWERS =================
+
+void Calculator::pow(std::span<const int64_t> a, std::span<const int64_t> e, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), e.size(), out.size());
+
+    // the message is the first failing lane's
+    Calculator c(*this);
+    OpError first = OpError::None;
+    checkedLanes(a.size(), out.data(), nullptr, [&](size_t i) {
+        OpResult r = c.tryPow(a[i], e[i]);
+        if (!r && first == OpError::None)
+            first = r.error;
+        return r;
+    });
+    if (first != OpError::None)
+        throw std::invalid_argument(first == OpError::DivideByZero ? "DIV/0" : "N/A");
+}
+
+void Calculator::powmod(std::span<const int64_t> a, std::span<const int64_t> e, int64_t m,
+                        std::span<int64_t> out) const
+{
+    checkSizes(a.size(), e.size(), out.size());
+    if (tryPowmod(a, e, m, out, {}))
+        throw std::invalid_argument(m == 0 ? "DIV/0" : "N/A");
+}
+
+size_t Calculator::tryPow(std::span<const int64_t> a, std::span<const int64_t> e, std::span<int64_t> out,
+                          std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), e.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    Calculator c(*this);
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(),
+                        [&](size_t i) { return c.tryPow(a[i], e[i]); });
+}
+
+// same reduction as the scalar tryPowmod(), with the Montgomery constants
+// of an odd modulus set up once
+size_t Calculator::tryPowmod(std::span<const int64_t> a, std::span<const int64_t> e, int64_t m,
+                             std::span<int64_t> out, std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), e.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    uint64_t um = m < 0 ? 0 - static_cast<uint64_t>(m) : static_cast<uint64_t>(m);
+    const bool odd = (um & 1) && um > 1;
+    const wordops::Montgomery mont(odd ? um : 1);
+
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(), [&](size_t i) {
+        if (um == 0)
+            return OpResult{ 0, OpError::DivideByZero };
+        if (e[i] < 0)
+            return OpResult{ 0, OpError::Domain };
+
+        uint64_t ua = a[i] < 0 ? 0 - static_cast<uint64_t>(a[i]) : static_cast<uint64_t>(a[i]);
+        uint64_t base = ua % um;
+        if (a[i] < 0 && base)
+            base = um - base;
+
+        uint64_t exp = static_cast<uint64_t>(e[i]);
+        uint64_t r = odd ? mont.pow(base, exp) : wordops::powMod64(base, exp, um);
+        return OpResult{ ops->signExtend(r) };
+    });
+}
+
+// ================= NUMBER THEORY =================
+
+// gcd and lcm wrap like the scalar ops, without their flags
+void Calculator::gcd(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    for (size_t i = 0; i < a.size(); ++i)
+        out[i] = ops->signExtend(numtheory::gcd(magnitude(a[i]), magnitude(b[i])));
+}
+
+void Calculator::lcm(std::span<const int64_t> a, std::span<const int64_t> b, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), b.size(), out.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        uint64_t ua = magnitude(a[i]), ub = magnitude(b[i]);
+        uint64_t g = numtheory::gcd(ua, ub);
+        out[i] = ops->signExtend(g ? ua / g * ub : 0);
+    }
+}
+
+void Calculator::modInverse(std::span<const int64_t> a, int64_t m, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (tryModInverse(a, m, out, {}))
+        throw std::invalid_argument(m == 0 ? "DIV/0" : "N/A");
+}
+
+size_t Calculator::tryModInverse(std::span<const int64_t> a, int64_t m, std::span<int64_t> out,
+                                 std::span<uint64_t> failed) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    if (!failed.empty())
+        checkMasks(a.size(), failed.size(), failed.size());
+
+    Calculator c(*this);
+    return checkedLanes(a.size(), out.data(), failed.empty() ? nullptr : failed.data(),
+                        [&](size_t i) { return c.tryModInverse(a[i], m); });
+}
+
+void Calculator::isPrime(std::span<const int64_t> a, std::span<int64_t> out, unsigned threads) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    parallelRanges(a.size(), threads, [a, out](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+            out[i] = a[i] > 0 && numtheory::isPrime(static_cast<uint64_t>(a[i]));
+    });
+}
+
+// ================= BIT MANIPULATION =================
+
+void Calculator::popcount(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::Popcount, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::parity(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::Parity, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::clz(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::Clz, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::ctz(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::Ctz, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::highestBit(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::HighestBit, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::lowestBit(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::LowestBit, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::bswap(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::Bswap, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::bitReverse(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::BitReverse, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::pdep(std::span<const int64_t> a, std::span<const int64_t> mask, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), mask.size(), out.size());
+    batchKernels().pdep(a.data(), mask.data(), out.data(), a.size(), lanesFor(ops->bits, this->mask()));
+}
+
+void Calculator::pext(std::span<const int64_t> a, std::span<const int64_t> mask, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), mask.size(), out.size());
+    batchKernels().pext(a.data(), mask.data(), out.data(), a.size(), lanesFor(ops->bits, this->mask()));
+}
+
+void Calculator::blsr(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::Blsr, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
+
+void Calculator::blsi(std::span<const int64_t> a, std::span<int64_t> out) const
+{
+    checkSizes(a.size(), a.size(), out.size());
+    batchKernels().bits(BitKind::Blsi, a.data(), out.data(), a.size(), lanesFor(ops->bits, mask()));
+}
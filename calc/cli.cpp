@@ -0,0 +1,302 @@
+// calc_cli: headless front end over the calculator core, no Qt.
+//
+//   calc_cli [--base dec|hex|oct|bin] [--word byte|word|dword|qword] [EXPR...]
+//   calc_cli [--base ...] [--word ...] --stream FILE [--output FILE]
+//            [--in-base dec|hex|oct|bin] [--threads N] [EXPR]
+//
+// With expressions it evaluates each one, prints the result and exits.
+// Without, it reads expressions line by line (a REPL on a terminal). In
+// both modes `x` is the previous result and ":base" / ":word" switch the
+// mode; ":magic N" prints C that divides by N with a multiply instead.
+//
+// --stream converts a file of one number per line: each is run through
+// EXPR as x (default: x itself) and printed in --base, see stream.h.
+
+#include "calculator.h"
+#include "divmagic.h"
+#include "expression.h"
+#include "stream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool parseBase(std::string_view s, NumberBase& out)
+{
+    if (s == "dec") { out = NumberBase::DEC; return true; }
+    if (s == "hex") { out = NumberBase::HEX; return true; }
+    if (s == "oct") { out = NumberBase::OCT; return true; }
+    if (s == "bin") { out = NumberBase::BIN; return true; }
+    return false;
+}
+
+bool parseWord(std::string_view s, WordSize& out)
+{
+    if (s == "byte")  { out = WordSize::BYTE;  return true; }
+    if (s == "word")  { out = WordSize::WORD;  return true; }
+    if (s == "dword") { out = WordSize::DWORD; return true; }
+    if (s == "qword") { out = WordSize::QWORD; return true; }
+    return false;
+}
+
+void usage(FILE* f)
+{
+    std::fputs("usage: calc_cli [--base dec|hex|oct|bin] [--word byte|word|dword|qword] [EXPR...]\n"
+               "       calc_cli [--base ...] [--word ...] --stream FILE [--output FILE]\n"
+               "                [--in-base dec|hex|oct|bin] [--threads N] [EXPR]\n"
+               "\n"
+               "Evaluates each EXPR and prints the result, or reads expressions from\n"
+               "standard input when none are given. `x` is the previous result.\n"
+               "Commands: :base NAME, :word NAME, :magic N, :umagic N, :help, :quit\n"
+               "(:magic prints C dividing by N at the word size, signed or unsigned)\n"
+               "\n"
+               "--stream runs every number in FILE (one per line) through EXPR as x.\n", f);
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\n' || s.back() == '\r'))
+        s.remove_suffix(1);
+    return s;
+}
+
+class Session {
+public:
+    NumberBase base = NumberBase::DEC;
+    Calculator calc;
+
+    void setBase(NumberBase b)
+    {
+        base = b;
+        calc.setBase(b);
+    }
+
+    // returns false on error
+    bool evaluate(std::string_view text)
+    {
+        try {
+            Expression e = Expression::compile(text, base);
+            e.evaluate(calc, calc.getValue());
+        }
+        catch (const std::invalid_argument& ex) {
+            std::fprintf(stderr, "Error: %s\n", ex.what());
+            return false;
+        }
+
+        std::string s = calc.display();
+        s += '\n';
+        std::fputs(s.c_str(), stdout);
+        return true;
+    }
+
+    // ":base hex" and friends; returns false on error
+    bool command(std::string_view line, bool& quit)
+    {
+        std::string_view cmd = line.substr(1);
+        std::string_view arg;
+        size_t sp = cmd.find(' ');
+        if (sp != std::string_view::npos) {
+            arg = trim(cmd.substr(sp + 1));
+            cmd = cmd.substr(0, sp);
+        }
+
+        if (cmd == "q" || cmd == "quit") {
+            quit = true;
+            return true;
+        }
+        if (cmd == "help") {
+            usage(stdout);
+            return true;
+        }
+        if (cmd == "base") {
+            NumberBase b;
+            if (!parseBase(arg, b)) {
+                std::fputs("Error: unknown base\n", stderr);
+                return false;
+            }
+            setBase(b);
+            return true;
+        }
+        if (cmd == "word") {
+            WordSize w;
+            if (!parseWord(arg, w)) {
+                std::fputs("Error: unknown word size\n", stderr);
+                return false;
+            }
+            calc.setWordSize(w);
+            return true;
+        }
+
+        if (cmd == "magic" || cmd == "umagic") {
+            ParseResult d = parseNumber(arg, base, calc.getWordSize());
+            if (!d) {
+                std::fputs("Error: invalid divisor\n", stderr);
+                return false;
+            }
+            try {
+                std::string c = divmagic::toC(calc.divisionMagic(d.value, cmd == "magic"));
+                std::fputs(c.c_str(), stdout);
+            }
+            catch (const std::invalid_argument& ex) {
+                std::fprintf(stderr, "Error: %s\n", ex.what());
+                return false;
+            }
+            return true;
+        }
+
+        std::fputs("Error: unknown command\n", stderr);
+        return false;
+    }
+
+    int repl()
+    {
+        bool interactive = isatty(fileno(stdin));
+        bool ok = true;
+        bool quit = false;
+        std::string buf;
+
+        while (!quit) {
+            if (interactive) {
+                std::fputs("> ", stdout);
+                std::fflush(stdout);
+            }
+            if (!std::getline(std::cin, buf))
+                break;
+
+            std::string_view line = trim(buf);
+            if (line.empty())
+                continue;
+
+            bool r = line[0] == ':' ? command(line, quit) : evaluate(line);
+            ok = ok && r;
+            if (interactive)
+                std::fflush(stdout);
+        }
+
+        // in scripts a failed line is reported through the exit code
+        return (ok || interactive) ? 0 : 1;
+    }
+};
+
+int runStream(const Session& s, const StreamOptions& base, const char* input,
+              const char* output, const char* expr)
+{
+    StreamOptions o = base;
+    o.outputBase = s.base;
+    o.wordSize = s.calc.getWordSize();
+
+    std::FILE* out = stdout;
+    try {
+        Expression pipeline = Expression::compile(expr ? expr : "x", o.inputBase);
+
+        if (output) {
+            out = std::fopen(output, "wb");
+            if (!out) throw std::runtime_error(std::string("Cannot open ") + output);
+        }
+
+        StreamStats st = streamFile(input, out, pipeline, o);
+
+        if (output && std::fclose(out) != 0)
+            throw std::runtime_error("Write failed");
+        out = stdout;
+
+        if (st.errors) {
+            std::fprintf(stderr, "%llu of %llu lines failed\n",
+                         (unsigned long long)st.errors, (unsigned long long)st.lines);
+            return 1;
+        }
+        return 0;
+    }
+    catch (const std::exception& ex) {
+        if (out != stdout) std::fclose(out);
+        std::fprintf(stderr, "Error: %s\n", ex.what());
+        return 1;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Session s;
+    int first = argc;
+
+    StreamOptions streamOptions;
+    const char* streamInput = nullptr;
+    const char* streamOutput = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+
+        if (a == "-h" || a == "--help") {
+            usage(stdout);
+            return 0;
+        }
+        if ((a == "--base" || a == "--word") && i + 1 < argc) {
+            std::string_view v = argv[++i];
+            NumberBase b;
+            WordSize w;
+            if (a == "--base" && parseBase(v, b)) { s.setBase(b); continue; }
+            if (a == "--word" && parseWord(v, w)) { s.calc.setWordSize(w); continue; }
+            std::fprintf(stderr, "Error: bad value for %s\n", argv[i - 1]);
+            return 2;
+        }
+        if (a == "--stream" && i + 1 < argc) { streamInput = argv[++i]; continue; }
+        if (a == "--output" && i + 1 < argc) { streamOutput = argv[++i]; continue; }
+        if (a == "--in-base" && i + 1 < argc) {
+            if (parseBase(argv[++i], streamOptions.inputBase)) continue;
+            std::fprintf(stderr, "Error: bad value for %s\n", argv[i - 1]);
+            return 2;
+        }
+        if (a == "--threads" && i + 1 < argc) {
+            streamOptions.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            continue;
+        }
+        if (a == "--") {
+            first = i + 1;
+            break;
+        }
+        if (a.size() > 1 && a[0] == '-' && a[1] == '-') {
+            usage(stderr);
+            return 2;
+        }
+        first = i;
+        break;
+    }
+
+    if (streamInput) {
+        if (argc - first > 1) {
+            usage(stderr);
+            return 2;
+        }
+        return runStream(s, streamOptions, streamInput, streamOutput,
+                         first < argc ? argv[first] : nullptr);
+    }
+
+    if (first >= argc)
+        return s.repl();
+
+    bool quit = false;
+    for (int i = first; i < argc && !quit; ++i) {
+        std::string_view a = trim(argv[i]);
+        bool ok = !a.empty() && a[0] == ':' ? s.command(a, quit) : s.evaluate(a);
+        if (!ok)
+            return 1;
+    }
+    return 0;
+}
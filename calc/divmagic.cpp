@@ -0,0 +1,417 @@
+#include "divmagic.h"
+#include "wordops.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+uint64_t magnitude(int64_t a)
+{
+    return a < 0 ? 0 - static_cast<uint64_t>(a) : static_cast<uint64_t>(a);
+}
+
+uint64_t maskFor(int bits)
+{
+    return bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+}
+
+// The sequence with its shape (signedness, multiply or shift only, add)
+// fixed at compile time: the exhaustive loops then have no branches left.
+template <WordSize W, bool Signed, bool Multiply, bool Add>
+uint64_t runAs(const DivisionMagic& m, uint64_t n)
+{
+    const uint64_t un = n & wordops::mask<W>();
+    if constexpr (!Signed) {
+        if constexpr (!Multiply)
+            return un >> m.shift;
+        uint64_t t = static_cast<uint64_t>(wordops::mulHiLo<W>(static_cast<int64_t>(n),
+                                                              static_cast<int64_t>(m.multiplier)).hi);
+        t &= wordops::mask<W>();
+        if constexpr (Add)
+            t = ((un - t) >> 1) + t;    // t <= n, and the sum is below 2^W
+        return t >> m.shift;
+    }
+    else if constexpr (!Multiply) {
+        // round toward zero: a negative n is biased by |d| - 1 first
+        const int64_t sn = wordops::signExtend<W>(n);
+        const int64_t bias = sn < 0 ? static_cast<int64_t>((1ULL << m.shift) - 1) : 0;
+        uint64_t q = static_cast<uint64_t>((sn + bias) >> m.shift);
+        return (m.divisor < 0 ? 0 - q : q) & wordops::mask<W>();
+    }
+    else {
+        int64_t hi = wordops::imulHiLo<W>(static_cast<int64_t>(n), static_cast<int64_t>(m.multiplier)).hi;
+        if constexpr (Add)
+            hi = wordops::signExtend<W>(m.divisor < 0 ? static_cast<uint64_t>(hi) - un
+                                                      : static_cast<uint64_t>(hi) + un);
+        hi >>= m.shift;
+        return (static_cast<uint64_t>(hi) + (static_cast<uint64_t>(hi) >> 63)) & wordops::mask<W>();
+    }
+}
+
+// calls fn.template operator()<Signed, Multiply, Add>() for m's shape
+template <class Fn>
+auto withShape(const DivisionMagic& m, Fn fn)
+{
+    if (!m.isSigned) {
+        if (!m.multiplier) return fn.template operator()<false, false, false>();
+        if (!m.add) return fn.template operator()<false, true, false>();
+        return fn.template operator()<false, true, true>();
+    }
+    if (!m.multiplier) return fn.template operator()<true, false, false>();
+    if (!m.add) return fn.template operator()<true, true, false>();
+    return fn.template operator()<true, true, true>();
+}
+
+template <WordSize W>
+uint64_t run(const DivisionMagic& m, uint64_t n)
+{
+    return withShape(m, [&]<bool S, bool M, bool A>() { return runAs<W, S, M, A>(m, n); });
+}
+
+// Is q the quotient of n? A QWORD asks real division. Narrower words only
+// multiply: q is right when the remainder n - q * d is below |d| and, for
+// signed, has the sign of n (or is 0); the 64-bit products cannot wrap.
+template <WordSize W>
+bool matches(const DivisionMagic& m, uint64_t n, uint64_t q)
+{
+    const uint64_t d = static_cast<uint64_t>(m.divisor);
+    if constexpr (W == WordSize::QWORD) {
+        if (!m.isSigned)
+            return q == n / d;
+        return q == static_cast<uint64_t>(wordops::divide<W>(static_cast<int64_t>(n), m.divisor));
+    }
+    else {
+        if (!m.isSigned)
+            return (n & wordops::mask<W>()) - q * d < d;
+
+        const int64_t sn = wordops::signExtend<W>(n);
+        const int64_t sq = wordops::signExtend<W>(q);
+        if (m.divisor == -1)    // MIN / -1 wraps to MIN
+            return sq == wordops::signExtend<W>(0 - n);
+        // the remainder with n's sign taken off must be in [0, |d|)
+        const int64_t sign = sn >> 63;
+        const int64_t r = sn - sq * m.divisor;
+        return static_cast<uint64_t>((r ^ sign) - sign) < magnitude(m.divisor);
+    }
+}
+
+struct Tally {
+    uint64_t tested = 0;
+    uint64_t failures = 0;
+    uint64_t first = 0;
+
+    void check(bool ok, uint64_t n)
+    {
+        ++tested;
+        if (!ok && !failures++)
+            first = n;
+    }
+
+    void merge(const Tally& t)
+    {
+        if (t.failures && !failures)
+            first = t.first;
+        tested += t.tested;
+        failures += t.failures;
+    }
+};
+
+// fn(i) for i in [0, count), each on its own thread, the first on the
+// calling one
+template <class Fn>
+void onThreads(unsigned count, Fn fn)
+{
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < count; ++i)
+        workers.emplace_back(fn, i);
+    fn(0u);
+    for (auto& t : workers)
+        t.join();
+}
+
+// slices of at least 2^16 dividends, one per thread
+unsigned slicesFor(uint64_t n, unsigned threads)
+{
+    threads = std::max(1u, threads ? threads : std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::min<uint64_t>(threads, std::max<uint64_t>(1, n >> 16)));
+}
+
+template <WordSize W>
+Tally checkAll(const DivisionMagic& m, unsigned threads)
+{
+    constexpr uint64_t n = 1ULL << wordops::bits<W>;
+    const unsigned slices = slicesFor(n, threads);
+    const uint64_t step = (n + slices - 1) / slices;
+
+    std::vector<Tally> part(slices);
+    onThreads(slices, [&](unsigned i) {
+        const uint64_t first = i * step, last = std::min(n, first + step);
+        // a plain count keeps the loop free of branches; only a slice
+        // that failed is run again, to find where
+        uint64_t bad = withShape(m, [&]<bool S, bool M, bool A>() {
+            uint64_t count = 0;
+            for (uint64_t v = first; v < last; ++v)
+                count += !matches<W>(m, v, runAs<W, S, M, A>(m, v));
+            return count;
+        });
+
+        Tally t;
+        t.tested = last - first;
+        t.failures = bad;
+        for (uint64_t v = first; bad && v < last; ++v)
+            if (!matches<W>(m, v, run<W>(m, v))) {
+                t.first = v;
+                break;
+            }
+        part[i] = t;
+    });
+
+    Tally all;
+    for (const Tally& t : part)
+        all.merge(t);
+    return all;
+}
+
+// where a QWORD sequence goes wrong if it does: the ends of the range, the
+// multiples of d and their neighbours, powers of two, and all negated
+std::vector<uint64_t> edgeCases(const DivisionMagic& m)
+{
+    const uint64_t ad = m.isSigned ? magnitude(m.divisor) : static_cast<uint64_t>(m.divisor);
+    std::vector<uint64_t> v = { 0, 1, 2, 3, 1ULL << 63, ~0ULL >> 1, ~0ULL };
+
+    const uint64_t top = m.isSigned ? ~0ULL >> 1 : ~0ULL;
+    for (uint64_t k : { uint64_t(1), uint64_t(2), uint64_t(3), top / ad - 1, top / ad })
+        for (uint64_t off : { ~0ULL, 0ULL, 1ULL })
+            v.push_back(k * ad + off);
+    for (uint64_t off : { ~uint64_t(0), uint64_t(0), uint64_t(1), ad - 1 })
+        v.push_back(top / ad * ad + off);
+    for (int k = 0; k < 64; ++k)
+        for (uint64_t off : { ~0ULL, 0ULL, 1ULL })
+            v.push_back((1ULL << k) + off);
+
+    const size_t n = v.size();
+    for (size_t i = 0; i < n; ++i)
+        v.push_back(0 - v[i]);
+    return v;
+}
+
+Tally checkSampled(const DivisionMagic& m, unsigned threads, uint64_t samples)
+{
+    constexpr WordSize Q = WordSize::QWORD;
+    Tally all;
+    for (uint64_t v : edgeCases(m))
+        all.check(matches<Q>(m, v, run<Q>(m, v)), v);
+
+    const unsigned slices = slicesFor(samples, threads);
+    const uint64_t ad = m.isSigned ? magnitude(m.divisor) : static_cast<uint64_t>(m.divisor);
+    std::vector<Tally> part(slices);
+    onThreads(slices, [&](unsigned i) {
+        // seeded from d, so a failure can be reproduced
+        std::mt19937_64 rng(static_cast<uint64_t>(m.divisor) ^ (0x9E3779B97F4A7C15ULL * (i + 1)));
+        Tally t;
+        const uint64_t count = samples / slices + (i < samples % slices);
+        for (uint64_t k = 0; k < count; ++k) {
+            uint64_t v = rng();
+            // every other sample is a multiple of d, give or take one
+            if (k & 1) {
+                const uint64_t mag = m.isSigned ? magnitude(static_cast<int64_t>(v)) : v;
+                const uint64_t rounded = mag - mag % ad + (rng() % 3) - 1;
+                v = m.isSigned && static_cast<int64_t>(v) < 0 ? 0 - rounded : rounded;
+            }
+            t.check(matches<Q>(m, v, run<Q>(m, v)), v);
+        }
+        part[i] = t;
+    });
+    for (const Tally& t : part)
+        all.merge(t);
+    return all;
+}
+
+// the literal of the word bits v, as the C type of the word takes them
+std::string literal(uint64_t v, int bits, bool isSigned)
+{
+    char buf[32];
+    if (!isSigned) {
+        std::snprintf(buf, sizeof buf, "0x%llX%s", static_cast<unsigned long long>(v), bits == 64 ? "ull" : "u");
+        return buf;
+    }
+    const uint64_t sign = 1ULL << (bits - 1);
+    const int64_t s = static_cast<int64_t>((v ^ sign) - sign);
+    const char* suffix = bits == 64 ? "ll" : "";
+    if (s >= 0)
+        std::snprintf(buf, sizeof buf, "0x%llX%s", static_cast<unsigned long long>(s), suffix);
+    else if (v == sign)     // MIN has no positive literal
+        std::snprintf(buf, sizeof buf, "(-0x%llX%s - 1)", static_cast<unsigned long long>(sign - 1), suffix);
+    else
+        std::snprintf(buf, sizeof buf, "-0x%llX%s", static_cast<unsigned long long>(magnitude(s)), suffix);
+    return buf;
+}
+
+} // namespace
+
+
+namespace divmagic {
+
+// libdivide's generation: the magic is 2^(W + p) / |d| rounded up, with
+// p = floor(log2 |d|) (one less when signed, for the sign bit). When
+// rounding up errs by too much the next power is taken, which needs a
+// (W + 1)-bit magic: its top bit is implied and the numerator added back.
+DivisionMagic compute(int64_t d, WordSize w, bool isSigned)
+{
+    const int bits = static_cast<int>(w);
+    const uint64_t mask = maskFor(bits);
+    const uint64_t sign = 1ULL << (bits - 1);
+
+    DivisionMagic m{};
+    m.bits = bits;
+    m.isSigned = isSigned;
+    m.divisor = isSigned ? static_cast<int64_t>(((static_cast<uint64_t>(d) & mask) ^ sign) - sign)
+                         : static_cast<int64_t>(static_cast<uint64_t>(d) & mask);
+    if (m.divisor == 0)
+        throw std::invalid_argument("DIV/0");
+
+    const uint64_t abs = isSigned ? magnitude(m.divisor) : static_cast<uint64_t>(m.divisor);
+    const int l = 63 - std::countl_zero(abs);
+    if ((abs & (abs - 1)) == 0) {
+        m.shift = l;
+        return m;
+    }
+
+    const int p = isSigned ? l - 1 : l;
+    const int e = bits + p;
+    uint64_t rem;
+    uint64_t q = wordops::divide128(e >= 64 ? 1ULL << (e - 64) : 0, e < 64 ? 1ULL << e : 0, abs, rem);
+    if (abs - rem < (1ULL << l)) {
+        m.shift = p;
+    }
+    else {
+        q += q;
+        const uint64_t twice = rem + rem;
+        if (twice >= abs || twice < rem)
+            ++q;
+        m.shift = l;
+        m.add = true;
+    }
+    q = (q + 1) & mask;
+    m.multiplier = isSigned && m.divisor < 0 ? (0 - q) & mask : q;
+    return m;
+}
+
+uint64_t apply(const DivisionMagic& m, uint64_t n)
+{
+    switch (m.bits) {
+    case 8:  return run<WordSize::BYTE>(m, n);
+    case 16: return run<WordSize::WORD>(m, n);
+    case 32: return run<WordSize::DWORD>(m, n);
+    default: return run<WordSize::QWORD>(m, n);
+    }
+}
+
+void verify(DivisionMagic& m, unsigned threads, uint64_t samples)
+{
+    Tally t;
+    switch (m.bits) {
+    case 8:  t = checkAll<WordSize::BYTE>(m, threads); break;
+    case 16: t = checkAll<WordSize::WORD>(m, threads); break;
+    case 32: t = checkAll<WordSize::DWORD>(m, threads); break;
+    default: t = checkSampled(m, threads, samples); break;
+    }
+    m.tested = t.tested;
+    m.failures = t.failures;
+    m.firstFailure = t.first;
+    m.exhaustive = m.bits < 64;
+}
+
+std::string toC(const DivisionMagic& m)
+{
+    const int w = m.bits;
+    // the word's type and the one its products are taken in
+    const std::string u = "uint" + std::to_string(w) + "_t";
+    const std::string s = "int" + std::to_string(w) + "_t";
+    const std::string type = m.isSigned ? s : u;
+    const std::string wideU = w == 64 ? "unsigned __int128" : w == 32 ? "uint64_t" : "uint32_t";
+    const std::string wideS = w == 64 ? "__int128" : w == 32 ? "int64_t" : "int32_t";
+    const std::string W = std::to_string(w);
+
+    char buf[160];
+    std::string divisor = m.isSigned ? std::to_string(m.divisor)
+                                     : std::to_string(static_cast<uint64_t>(m.divisor));
+    std::string name = "div_" + std::string(m.isSigned ? "s" : "u") + W + "_" +
+                       (m.divisor < 0 && m.isSigned ? "m" + divisor.substr(1) : divisor);
+
+    std::string out = "/* x / " + divisor + " for " + type + " x: ";
+    if (m.multiplier) {
+        std::snprintf(buf, sizeof buf, "multiplier 0x%llX, shift %d, add %d",
+                      static_cast<unsigned long long>(m.multiplier), m.shift, m.add ? 1 : 0);
+        out += buf;
+    }
+    else {
+        out += "shift " + std::to_string(m.shift) + ", no multiply";
+    }
+    out += ".\n   ";
+    if (m.failures) {
+        std::snprintf(buf, sizeof buf, "WRONG for %llu of %llu dividends, first 0x%llX.",
+                      static_cast<unsigned long long>(m.failures), static_cast<unsigned long long>(m.tested),
+                      static_cast<unsigned long long>(m.firstFailure));
+        out += buf;
+    }
+    else if (m.tested) {
+        std::snprintf(buf, sizeof buf, "Matches division for %s %llu dividends.",
+                      m.exhaustive ? "all" : "a sample of", static_cast<unsigned long long>(m.tested));
+        out += buf;
+    }
+    else {
+        out += "Not verified.";
+    }
+    if (m.isSigned)
+        out += "\n   Assumes >> of a negative value shifts in sign bits, as mainstream compilers do.";
+    out += " */\n";
+
+    out += "static inline " + type + " " + name + "(" + type + " x)\n{\n";
+    const std::string mult = literal(m.multiplier, w, m.isSigned);
+    if (!m.isSigned) {
+        if (!m.multiplier) {
+            out += "    return x >> " + std::to_string(m.shift) + ";\n";
+        }
+        else {
+            std::string hi = "(" + u + ")(((" + wideU + ")x * " + mult + ") >> " + W + ")";
+            if (m.add) {
+                out += "    " + u + " t = " + hi + ";\n";
+                out += "    return (" + u + ")((((" + u + ")(x - t) >> 1) + t) >> " + std::to_string(m.shift) + ");\n";
+            }
+            else {
+                out += "    return (" + u + ")(" + hi + " >> " + std::to_string(m.shift) + ");\n";
+            }
+        }
+        return out + "}\n";
+    }
+
+    // signed: wrapping steps go through the unsigned type
+    if (!m.multiplier) {
+        if (m.shift) {
+            std::snprintf(buf, sizeof buf, "0x%llXu", static_cast<unsigned long long>((1ULL << m.shift) - 1));
+            out += "    " + s + " q = (" + s + ")((" + u + ")x + (x < 0 ? " + buf + " : 0)) >> " +
+                   std::to_string(m.shift) + ";\n";
+        }
+        else {
+            out += "    " + s + " q = x;\n";
+        }
+        out += m.divisor < 0 ? "    return (" + s + ")(0 - (" + u + ")q);\n" : "    return q;\n";
+        return out + "}\n";
+    }
+
+    out += "    " + s + " q = (" + s + ")(((" + wideS + ")x * " + mult + ") >> " + W + ");\n";
+    if (m.add)
+        out += "    q = (" + s + ")((" + u + ")q " + (m.divisor < 0 ? "-" : "+") + " (" + u + ")x);\n";
+    if (m.shift)
+        out += "    q >>= " + std::to_string(m.shift) + ";\n";
+    out += "    return (" + s + ")(q + (q < 0));\n";
+    return out + "}\n";
+}
+
+} // namespace divmagic
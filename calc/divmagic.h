@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "calculator.h"
+
+// Division by a constant as compilers emit it: a high multiply by a magic
+// reciprocal and shifts (Granlund and Montgomery, "Division by Invariant
+// Integers using Multiplication", with libdivide's choice of magic). This
+// is the generator behind Calculator::divisionMagic(): it works at the
+// word's own width, so a DWORD magic is the 32-bit one a C compiler would
+// use, checks it against real division and writes it out as C.
+
+namespace divmagic {
+
+// the sequence for d at word size w; d is narrowed to the word first and
+// must not be 0 after that. Fills everything but the verification fields.
+DivisionMagic compute(int64_t d, WordSize w, bool isSigned);
+
+// runs the sequence on the word bits of n: the quotient's word bits
+uint64_t apply(const DivisionMagic& m, uint64_t n);
+
+// Checks the sequence against division and fills tested / failures /
+// firstFailure / exhaustive. Up to DWORD every dividend is tried, split
+// over `threads` threads (0 = one per core); a QWORD gets its edge cases
+// (0, 1, the extremes, multiples of d and their neighbours, powers of two)
+// plus `samples` random dividends.
+void verify(DivisionMagic& m, unsigned threads = 0, uint64_t samples = 1ULL << 22);
+
+// a static inline C function for the division with the numbers and the
+// verification in its comment, ready to paste into a C or C++ source
+std::string toC(const DivisionMagic& m);
+
+} // namespace divmagic
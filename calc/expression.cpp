@@ -0,0 +1,412 @@
+#include "expression.h"
+#include "wordops.h"
+#include <stdexcept>
+
+using OpCode = Expression::OpCode;
+
+// ================= COMPILER =================
+
+class ExpressionCompiler {
+public:
+    ExpressionCompiler(std::string_view text, NumberBase base)
+        : src(text), base(base) {}
+
+    Expression run()
+    {
+        next();
+        parseBinary(1);
+        if (tok.kind != Kind::End)
+            throw std::invalid_argument("Syntax error");
+        return std::move(out);
+    }
+
+private:
+    enum class Kind { End, Number, X, Op, LParen, RParen };
+
+    struct Token {
+        Kind kind = Kind::End;
+        OpCode op = OpCode::Add;
+        int64_t value = 0;
+    };
+
+    static constexpr int maxNesting = 256;
+
+    std::string_view src;
+    NumberBase base;
+    size_t pos = 0;
+    Token tok;
+
+    Expression out;
+    int depth = 0;
+    int nesting = 0;
+
+    // ---- emit ----
+
+    void emitPush(uint8_t op)
+    {
+        out.code.push_back(op);
+        if (++depth > Expression::maxStack)
+            throw std::invalid_argument("Expression too deep");
+    }
+
+    void emitConst(int64_t v)
+    {
+        if (out.consts.size() > 0xFFFF)
+            throw std::invalid_argument("Expression too long");
+
+        emitPush(static_cast<uint8_t>(OpCode::PushConst));
+        uint16_t idx = static_cast<uint16_t>(out.consts.size());
+        out.code.push_back(static_cast<uint8_t>(idx & 0xFF));
+        out.code.push_back(static_cast<uint8_t>(idx >> 8));
+        out.consts.push_back(v);
+    }
+
+    void emitUnary(OpCode op)
+    {
+        out.code.push_back(static_cast<uint8_t>(op));
+    }
+
+    void emitBinary(OpCode op)
+    {
+        out.code.push_back(static_cast<uint8_t>(op));
+        --depth;
+    }
+
+    // ---- lexer ----
+
+    static bool isWordChar(char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+               (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    static bool sameWord(std::string_view w, const char* kw)
+    {
+        size_t i = 0;
+        for (; kw[i]; ++i) {
+            if (i >= w.size()) return false;
+            char c = w[i];
+            if (c >= 'A' && c <= 'Z') c = char(c - 'A' + 'a');
+            if (c != kw[i]) return false;
+        }
+        return i == w.size();
+    }
+
+    // literals are kept as 64-bit patterns, narrowing happens per operation
+    static int64_t literal(std::string_view w, NumberBase b)
+    {
+        ParseResult r = ::parseNumber(w, b, WordSize::QWORD);
+        if (r.error == ParseError::Overflow)
+            throw std::invalid_argument("Number too large");
+        if (!r)
+            throw std::invalid_argument("Invalid number");
+        return r.value;
+    }
+
+    void setOp(OpCode op)
+    {
+        tok.kind = Kind::Op;
+        tok.op = op;
+    }
+
+    void next()
+    {
+        while (pos < src.size() && (src[pos] == ' ' || src[pos] == '\t'))
+            ++pos;
+
+        if (pos >= src.size()) {
+            tok.kind = Kind::End;
+            return;
+        }
+
+        char c = src[pos];
+
+        if (isWordChar(c)) {
+            size_t start = pos;
+            while (pos < src.size() && isWordChar(src[pos]))
+                ++pos;
+            std::string_view w = src.substr(start, pos - start);
+
+            if (c >= '0' && c <= '9') {
+                tok.kind = Kind::Number;
+                tok.value = literal(w, base);
+                return;
+            }
+
+            if (sameWord(w, "and"))  return setOp(OpCode::And);
+            if (sameWord(w, "or"))   return setOp(OpCode::Or);
+            if (sameWord(w, "xor"))  return setOp(OpCode::Xor);
+            if (sameWord(w, "not"))  return setOp(OpCode::Not);
+            if (sameWord(w, "lsh"))  return setOp(OpCode::Shl);
+            if (sameWord(w, "rsh"))  return setOp(OpCode::Shr);
+            if (sameWord(w, "rol"))  return setOp(OpCode::Rol);
+            if (sameWord(w, "ror"))  return setOp(OpCode::Ror);
+            if (sameWord(w, "mod"))  return setOp(OpCode::Mod);
+            if (sameWord(w, "sqrt")) return setOp(OpCode::Sqrt);
+
+            if (sameWord(w, "x")) {
+                tok.kind = Kind::X;
+                return;
+            }
+
+            if (base == NumberBase::HEX) {
+                tok.kind = Kind::Number;
+                tok.value = literal(w, NumberBase::HEX);
+                return;
+            }
+
+            throw std::invalid_argument("Unknown name");
+        }
+
+        ++pos;
+        switch (c) {
+            case '(': tok.kind = Kind::LParen; return;
+            case ')': tok.kind = Kind::RParen; return;
+            case '+': return setOp(OpCode::Add);
+            case '-': return setOp(OpCode::Sub);
+            case '*': return setOp(OpCode::Mul);
+            case '/': return setOp(OpCode::Div);
+            case '%': return setOp(OpCode::Mod);
+            case '&': return setOp(OpCode::And);
+            case '|': return setOp(OpCode::Or);
+            case '^': return setOp(OpCode::Xor);
+            case '~': return setOp(OpCode::Not);
+            case '<':
+            case '>':
+                if (pos < src.size() && src[pos] == c) {
+                    ++pos;
+                    return setOp(c == '<' ? OpCode::Shl : OpCode::Shr);
+                }
+                break;
+            case '\xE2':
+                // √ is U+221A, E2 88 9A in UTF-8
+                if (src.substr(pos, 2) == "\x88\x9A") {
+                    pos += 2;
+                    return setOp(OpCode::Sqrt);
+                }
+                break;
+            default:
+                break;
+        }
+        throw std::invalid_argument("Syntax error");
+    }
+
+    // ---- parser ----
+
+    static int precedence(OpCode op)
+    {
+        switch (op) {
+            case OpCode::Or:  return 1;
+            case OpCode::Xor: return 2;
+            case OpCode::And: return 3;
+            case OpCode::Shl:
+            case OpCode::Shr:
+            case OpCode::Rol:
+            case OpCode::Ror: return 4;
+            case OpCode::Add:
+            case OpCode::Sub: return 5;
+            case OpCode::Mul:
+            case OpCode::Div:
+            case OpCode::Mod: return 6;
+            default:          return 0;  // not a binary operator
+        }
+    }
+
+    void parseBinary(int minPrec)
+    {
+        parseUnary();
+
+        while (tok.kind == Kind::Op) {
+            OpCode op = tok.op;
+            int prec = precedence(op);
+            if (prec < minPrec) break;
+
+            next();
+            parseBinary(prec + 1);
+            emitBinary(op);
+        }
+    }
+
+    void parseUnary()
+    {
+        if (tok.kind == Kind::Op) {
+            OpCode op = tok.op;
+            OpCode unary;
+
+            switch (op) {
+                case OpCode::Add:  unary = OpCode::Add;  break;
+                case OpCode::Sub:  unary = OpCode::Neg;  break;
+                case OpCode::Not:  unary = OpCode::Not;  break;
+                case OpCode::Sqrt: unary = OpCode::Sqrt; break;
+                default: throw std::invalid_argument("Syntax error");
+            }
+
+            enter();
+            next();
+            parseUnary();
+            leave();
+
+            if (unary != OpCode::Add)
+                emitUnary(unary);
+            return;
+        }
+
+        parsePrimary();
+    }
+
+    void parsePrimary()
+    {
+        switch (tok.kind) {
+            case Kind::Number:
+                emitConst(tok.value);
+                next();
+                return;
+
+            case Kind::X:
+                emitPush(static_cast<uint8_t>(OpCode::PushX));
+                next();
+                return;
+
+            case Kind::LParen:
+                enter();
+                next();
+                parseBinary(1);
+                if (tok.kind != Kind::RParen)
+                    throw std::invalid_argument("Missing )");
+                leave();
+                next();
+                return;
+
+            default:
+                throw std::invalid_argument("Syntax error");
+        }
+    }
+
+    void enter()
+    {
+        if (++nesting > maxNesting)
+            throw std::invalid_argument("Expression too deep");
+    }
+
+    void leave()
+    {
+        --nesting;
+    }
+};
+
+Expression Expression::compile(std::string_view text, NumberBase base)
+{
+    return ExpressionCompiler(text, base).run();
+}
+
+bool Expression::usesX() const
+{
+    for (size_t i = 0; i < code.size(); ++i) {
+        auto op = static_cast<OpCode>(code[i]);
+        if (op == OpCode::PushX) return true;
+        if (op == OpCode::PushConst) i += 2;
+    }
+    return false;
+}
+
+
+// ================= INTERPRETER =================
+
+namespace {
+
+template <WordSize W>
+int64_t run(const uint8_t* pc, const uint8_t* end, const int64_t* consts, int64_t x)
+{
+    using namespace wordops;
+
+    int64_t stack[Expression::maxStack];
+    int64_t* sp = stack;   // points past the top
+
+    while (pc != end) {
+        switch (static_cast<OpCode>(*pc++)) {
+            case OpCode::PushConst:
+                *sp++ = consts[pc[0] | (pc[1] << 8)];
+                pc += 2;
+                break;
+
+            case OpCode::PushX:
+                *sp++ = x;
+                break;
+
+            case OpCode::Add: --sp; sp[-1] = add<W>(sp[-1], sp[0]);      break;
+            case OpCode::Sub: --sp; sp[-1] = subtract<W>(sp[-1], sp[0]); break;
+            case OpCode::Mul: --sp; sp[-1] = multiply<W>(sp[-1], sp[0]); break;
+
+            case OpCode::Div:
+                --sp;
+                if (sp[0] == 0)
+                    throw std::invalid_argument("Division by zero");
+                sp[-1] = divide<W>(sp[-1], sp[0]);
+                break;
+
+            case OpCode::Mod:
+                --sp;
+                if (sp[0] == 0)
+                    throw std::invalid_argument("DIV/0");
+                sp[-1] = mod<W>(sp[-1], sp[0]);
+                break;
+
+            case OpCode::And: --sp; sp[-1] = bitAnd<W>(sp[-1], sp[0]); break;
+            case OpCode::Or:  --sp; sp[-1] = bitOr<W>(sp[-1], sp[0]);  break;
+            case OpCode::Xor: --sp; sp[-1] = bitXor<W>(sp[-1], sp[0]); break;
+
+            // counts outside int range still mean "shift everything out"
+            case OpCode::Shl:
+                --sp;
+                sp[-1] = (static_cast<uint64_t>(sp[0]) >= 64) ? 0 : shl<W>(sp[-1], static_cast<int>(sp[0]));
+                break;
+            case OpCode::Shr:
+                --sp;
+                sp[-1] = (static_cast<uint64_t>(sp[0]) >= 64) ? 0 : shr<W>(sp[-1], static_cast<int>(sp[0]));
+                break;
+            case OpCode::Rol:
+                --sp;
+                sp[-1] = rol<W>(sp[-1], static_cast<int>(sp[0] % bits<W>));
+                break;
+            case OpCode::Ror:
+                --sp;
+                sp[-1] = ror<W>(sp[-1], static_cast<int>(sp[0] % bits<W>));
+                break;
+
+            case OpCode::Neg: sp[-1] = subtract<W>(0, sp[-1]); break;
+            case OpCode::Not: sp[-1] = bitNot<W>(sp[-1]);      break;
+
+            case OpCode::Sqrt:
+                if (sp[-1] < 0)
+                    throw std::invalid_argument("N/A");
+                sp[-1] = signExtend<W>(isqrt64(static_cast<uint64_t>(sp[-1])));
+                break;
+        }
+    }
+
+    return signExtend<W>(static_cast<uint64_t>(sp[-1]));
+}
+
+} // namespace
+
+int64_t Expression::evaluate(WordSize w, int64_t x) const
+{
+    const uint8_t* pc = code.data();
+    const uint8_t* end = pc + code.size();
+
+    switch (w) {
+        case WordSize::BYTE:  return run<WordSize::BYTE>(pc, end, consts.data(), x);
+        case WordSize::WORD:  return run<WordSize::WORD>(pc, end, consts.data(), x);
+        case WordSize::DWORD: return run<WordSize::DWORD>(pc, end, consts.data(), x);
+        case WordSize::QWORD: return run<WordSize::QWORD>(pc, end, consts.data(), x);
+        case WordSize::DQWORD: break;   // 64-bit, like the int64_t ops in wide mode
+    }
+    return run<WordSize::QWORD>(pc, end, consts.data(), x);
+}
+
+int64_t Expression::evaluate(Calculator& calc, int64_t x) const
+{
+    int64_t r = evaluate(calc.getWordSize(), x);
+    calc.setValue(r);
+    return r;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "calculator.h"
+
+// Infix expression compiled once to a small stack bytecode.
+//
+// Grammar, lowest to highest precedence (C-like):
+//   |  Or
+//   ^  Xor
+//   &  And
+//   << >> Lsh Rsh RoL RoR
+//   +  -
+//   *  /  %  Mod
+//   unary  -  +  ~  Not  √  Sqrt
+//   number, x, ( expr )
+//
+// Numbers are read in the given base unless they carry a 0x / 0o / 0b
+// prefix. `x` is a variable supplied at evaluation time, so one formula
+// can be run against many inputs. Keywords are case-insensitive.
+//
+// Evaluation follows the Calculator ops exactly: each operation works on
+// full 64-bit operands and narrows its result to the word size, and the
+// final value is narrowed as well. It does not allocate.
+
+class Expression {
+public:
+    enum class OpCode : uint8_t {
+        PushConst,  // followed by a 16-bit constant index
+        PushX,
+        Add, Sub, Mul, Div, Mod,
+        And, Or, Xor,
+        Shl, Shr, Rol, Ror,
+        Neg, Not, Sqrt
+    };
+
+    static constexpr int maxStack = 64;
+
+    // throws std::invalid_argument on a syntax error
+    static Expression compile(std::string_view text, NumberBase base = NumberBase::DEC);
+
+    // throws std::invalid_argument on division by zero or √ of a negative
+    int64_t evaluate(WordSize w, int64_t x = 0) const;
+
+    // evaluates at the calculator's word size and stores the result in it
+    int64_t evaluate(Calculator& calc, int64_t x = 0) const;
+
+    bool usesX() const;
+
+    const std::vector<uint8_t>& bytecode() const { return code; }
+    const std::vector<int64_t>& constants() const { return consts; }
+
+private:
+    Expression() = default;
+
+    std::vector<uint8_t> code;
+    std::vector<int64_t> consts;
+
+    friend class ExpressionCompiler;
+};
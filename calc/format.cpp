@@ -0,0 +1,309 @@
+#include "format.h"
+#include "batch_kernels.h"
+#include "bigword.h"
+#include "wordops.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+// Digits are emitted from the least significant end, several at a time
+// from small tables, into a field whose length is known up front, so
+// nothing is shifted or reallocated.
+
+namespace {
+
+constexpr auto decPairs = [] {
+    std::array<char, 200> t{};
+    for (int i = 0; i < 100; ++i) {
+        t[2 * i]     = char('0' + i / 10);
+        t[2 * i + 1] = char('0' + i % 10);
+    }
+    return t;
+}();
+
+constexpr auto hexPairs = [] {
+    const char* d = "0123456789ABCDEF";
+    std::array<char, 512> t{};
+    for (int i = 0; i < 256; ++i) {
+        t[2 * i]     = d[i >> 4];
+        t[2 * i + 1] = d[i & 0xF];
+    }
+    return t;
+}();
+
+constexpr auto octPairs = [] {
+    std::array<char, 128> t{};
+    for (int i = 0; i < 64; ++i) {
+        t[2 * i]     = char('0' + (i >> 3));
+        t[2 * i + 1] = char('0' + (i & 7));
+    }
+    return t;
+}();
+
+// 8 binary digits per byte value
+constexpr auto binOctets = [] {
+    std::array<char, 256 * 8> t{};
+    for (int i = 0; i < 256; ++i)
+        for (int b = 0; b < 8; ++b)
+            t[8 * i + b] = char('0' + ((i >> (7 - b)) & 1));
+    return t;
+}();
+
+int decimalDigits(uint64_t v)
+{
+    int n = 1;
+    for (;;) {
+        if (v < 10)     return n;
+        if (v < 100)    return n + 1;
+        if (v < 1000)   return n + 2;
+        if (v < 10000)  return n + 3;
+        v /= 10000;
+        n += 4;
+    }
+}
+
+size_t formatDec(char* out, uint64_t v)
+{
+    size_t n = static_cast<size_t>(decimalDigits(v));
+    char* p = out + n;
+
+    while (v >= 100) {
+        p -= 2;
+        std::memcpy(p, &decPairs[2 * (v % 100)], 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        p -= 2;
+        std::memcpy(p, &decPairs[2 * v], 2);
+    } else {
+        *--p = char('0' + v);
+    }
+    return n;
+}
+
+size_t formatHex(char* out, uint64_t v)
+{
+    size_t n = v ? (std::bit_width(v) + 3) / 4 : 1;
+    char* p = out + n;
+
+    while (v >= 256) {
+        p -= 2;
+        std::memcpy(p, &hexPairs[2 * (v & 0xFF)], 2);
+        v >>= 8;
+    }
+    if (v >= 16) {
+        p -= 2;
+        std::memcpy(p, &hexPairs[2 * v], 2);
+    } else {
+        *--p = hexPairs[2 * v + 1];
+    }
+    return n;
+}
+
+size_t formatOct(char* out, uint64_t v)
+{
+    size_t n = v ? (std::bit_width(v) + 2) / 3 : 1;
+    char* p = out + n;
+
+    while (v >= 64) {
+        p -= 2;
+        std::memcpy(p, &octPairs[2 * (v & 63)], 2);
+        v >>= 6;
+    }
+    if (v >= 8) {
+        p -= 2;
+        std::memcpy(p, &octPairs[2 * v], 2);
+    } else {
+        *--p = char('0' + v);
+    }
+    return n;
+}
+
+size_t formatBin(char* out, uint64_t v)
+{
+    size_t n = v ? std::bit_width(v) : 1;
+    char* p = out + n;
+
+    while (v >= 256) {
+        p -= 8;
+        std::memcpy(p, &binOctets[8 * (v & 0xFF)], 8);
+        v >>= 8;
+    }
+    // the top byte, without its leading zeros
+    size_t top = static_cast<size_t>(p - out);
+    std::memcpy(out, &binOctets[8 * v + (8 - top)], top);
+    return n;
+}
+
+} // namespace
+
+
+size_t formatValue(char* out, uint64_t raw, WordSize w, NumberBase b)
+{
+    const WordOps& ops = wordOpsFor(w);
+    uint64_t v = raw & ops.mask;
+
+    switch (b) {
+        case NumberBase::DEC: {
+            int64_t s = ops.signExtend(v);
+            if (s < 0) {
+                *out = '-';
+                return 1 + formatDec(out + 1, 0 - static_cast<uint64_t>(s));
+            }
+            return formatDec(out, v);
+        }
+        case NumberBase::BIN: return formatBin(out, v);
+        case NumberBase::OCT: return formatOct(out, v);
+        case NumberBase::HEX: return formatHex(out, v);
+    }
+    return 0;
+}
+
+
+// ================= BULK =================
+
+namespace {
+
+// SIMD stores write whole 16-byte blocks past the last digit, the caller's
+// buffer has this much slack at the end
+constexpr size_t bulkSlack = 16;
+
+// digits a padded value takes in a power-of-two base
+int paddedDigits(NumberBase b, int bits)
+{
+    switch (b) {
+        case NumberBase::BIN: return bits;
+        case NumberBase::OCT: return (bits + 2) / 3;
+        case NumberBase::HEX: return bits / 4;
+        case NumberBase::DEC: return 0;
+    }
+    return 0;
+}
+
+} // namespace
+
+
+size_t bulkFormatCapacity(size_t count)
+{
+    return count * (maxDisplayLength + 1) + bulkSlack;
+}
+
+size_t formatBulk(std::span<const int64_t> values, const BulkFormat& f, char* out)
+{
+    const WordOps& ops = wordOpsFor(f.wordSize);
+    char* p = out;
+
+    if (f.base == NumberBase::DEC) {
+        for (int64_t v : values) {
+            p += formatValue(p, static_cast<uint64_t>(v), f.wordSize, NumberBase::DEC);
+            *p++ = f.separator;
+        }
+        return static_cast<size_t>(p - out);
+    }
+
+    // BIN, OCT and HEX digits come from the kernels of batch_kernels.inc
+    const int fixed = f.pad ? paddedDigits(f.base, ops.bits) : 0;
+    p = batchKernels().formatDigits(values.data(), values.size(), p, f.base, fixed, ops.mask, f.separator);
+
+    return static_cast<size_t>(p - out);
+}
+
+std::string formatBulk(std::span<const int64_t> values, const BulkFormat& f)
+{
+    std::string s(bulkFormatCapacity(values.size()), '\0');
+    s.resize(formatBulk(values, f, s.data()));
+    return s;
+}
+
+
+// ================= ALL BASES =================
+
+namespace {
+
+constexpr size_t groupedSlot = 4;
+
+} // namespace
+
+
+void BaseTexts::changed()
+{
+    hasKey = true;
+    valid.fill(false);
+    ++changeCount;
+}
+
+bool BaseTexts::set(uint64_t raw, WordSize w)
+{
+    const WordOps& ops = wordOpsFor(w);
+    const uint64_t v = raw & ops.mask;
+    const unsigned bits = static_cast<unsigned>(ops.bits);
+    if (hasKey && keyBits == bits && key.size() == 1 && key[0] == v)
+        return false;
+
+    key.assign(1, v);
+    keyBits = bits;
+    narrow = w;
+    changed();
+    return true;
+}
+
+bool BaseTexts::set(const BigWord& v)
+{
+    std::span<const uint64_t> limbs = v.limbs();
+    if (hasKey && keyBits == v.bits() && std::equal(limbs.begin(), limbs.end(), key.begin(), key.end()))
+        return false;
+
+    key.assign(limbs.begin(), limbs.end());
+    keyBits = v.bits();
+    changed();
+    return true;
+}
+
+bool BaseTexts::set(const Calculator& c)
+{
+    if (c.isWide())
+        return set(c.getWide());
+    return set(static_cast<uint64_t>(c.getValue()), c.getWordSize());
+}
+
+const std::string& BaseTexts::text(NumberBase b)
+{
+    const size_t slot = static_cast<size_t>(b);
+    std::string& s = texts[slot];
+    if (valid[slot])
+        return s;
+
+    if (keyBits > 64) {
+        BigWord v(0, keyBits);
+        std::copy(key.begin(), key.end(), v.limbs().begin());
+        s = bigword::format(v, b);
+    }
+    else {
+        char buf[maxDisplayLength];
+        s.assign(buf, formatValue(buf, hasKey ? key[0] : 0, narrow, b));
+    }
+    valid[slot] = true;
+    ++formatCount;
+    return s;
+}
+
+const std::string& BaseTexts::groupedBinary()
+{
+    std::string& s = texts[groupedSlot];
+    if (valid[groupedSlot])
+        return s;
+
+    const std::string& bin = text(NumberBase::BIN);
+    const size_t lead = (4 - bin.size() % 4) % 4;
+    const size_t digits = bin.size() + lead;
+    s.assign(digits + digits / 4 - 1, ' ');
+
+    size_t out = 0;
+    for (size_t i = 0; i < digits; ++i) {
+        if (i && i % 4 == 0)
+            ++out;
+        s[out++] = i < lead ? '0' : bin[i - lead];
+    }
+    valid[groupedSlot] = true;
+    return s;
+}
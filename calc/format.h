@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "calculator.h"
+
+// Allocation-free number formatting, the engine behind Calculator::display().
+
+// Writes `raw` the way display() does: DEC is the signed value at word
+// size `w`, the other bases the unsigned bit pattern without leading
+// zeros. `out` must have room for maxDisplayLength chars; nothing is
+// terminated. Returns the number of chars written.
+size_t formatValue(char* out, uint64_t raw, WordSize w, NumberBase b);
+
+
+// ================= BULK =================
+// Whole arrays at once: hex and binary digits are expanded with SIMD
+// (nibble / bit to ASCII) at the instruction set isa.h picked, octal and
+// decimal use the scalar tables.
+
+struct BulkFormat {
+    NumberBase base = NumberBase::HEX;
+    WordSize wordSize = WordSize::QWORD;
+    bool pad = false;          // leading zeros up to the word size; DEC is never padded
+    char separator = '\n';     // written after every value
+};
+
+// bytes `out` must have for formatBulk over `count` values
+size_t bulkFormatCapacity(size_t count);
+
+// Writes every value followed by the separator. Without padding each value
+// is byte-for-byte what display() shows for it. Returns the length written.
+size_t formatBulk(std::span<const int64_t> values, const BulkFormat& f, char* out);
+std::string formatBulk(std::span<const int64_t> values, const BulkFormat& f);
+
+
+// ================= ALL BASES =================
+// One value in HEX, DEC, OCT and BIN at once, for a panel that shows them
+// side by side. Each text is formatted the first time it is asked for and
+// kept until the value or the width changes, so setting the value that is
+// already shown (every keystroke that leaves it alone, a refresh after an
+// op without effect) costs a compare, not four formats.
+
+class BaseTexts {
+public:
+    // the value to show; false, and the texts kept, when it is the value
+    // already shown
+    bool set(uint64_t raw, WordSize w);
+    bool set(const BigWord& v);
+    bool set(const Calculator& c);    // its value at its width
+
+    // what display() shows for the value in base b
+    const std::string& text(NumberBase b);
+
+    // BIN padded to whole nibbles, the nibbles separated by spaces
+    const std::string& groupedBinary();
+
+    // texts formatted so far, the cost the caching saves
+    size_t formats() const { return formatCount; }
+
+    // set() calls that changed the value; a view that remembers it knows
+    // whether what it shows is still current
+    size_t changes() const { return changeCount; }
+
+private:
+    // the value as limbs and the width; narrow words take one limb
+    std::vector<uint64_t> key;
+    unsigned keyBits = 0;
+    WordSize narrow = WordSize::QWORD;
+    bool hasKey = false;
+
+    // one per NumberBase, then the grouped BIN
+    std::array<std::string, 5> texts;
+    std::array<bool, 5> valid{};
+    size_t formatCount = 0;
+    size_t changeCount = 0;
+
+    void changed();
+};
@@ -0,0 +1,171 @@
+#include "isa.h"
+#include "batch_kernels.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CALC_X86_64 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+// ================= DETECTION =================
+
+#ifdef CALC_X86_64
+
+struct CpuId {
+    uint32_t eax, ebx, ecx, edx;
+};
+
+CpuId cpuid(uint32_t leaf, uint32_t sub = 0)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(sub));
+    return { uint32_t(r[0]), uint32_t(r[1]), uint32_t(r[2]), uint32_t(r[3]) };
+#else
+    CpuId r{};
+    __cpuid_count(leaf, sub, r.eax, r.ebx, r.ecx, r.edx);
+    return r;
+#endif
+}
+
+// register state the OS saves on context switches (XCR0)
+uint64_t osSavedState()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+}
+
+inline bool has(uint32_t reg, int bit) { return (reg >> bit) & 1; }
+
+IsaLevel detect()
+{
+    uint32_t maxLeaf = cpuid(0).eax;
+    CpuId l1 = cpuid(1);
+
+    if (!(has(l1.ecx, 9) && has(l1.ecx, 19) && has(l1.ecx, 20) && has(l1.ecx, 23)))
+        return IsaLevel::SSE2;   // SSSE3, SSE4.1, SSE4.2, POPCNT
+
+    // AVX state needs OS support (OSXSAVE, XMM and YMM in XCR0)
+    if (maxLeaf < 7 || !has(l1.ecx, 27) || !has(l1.ecx, 28) || (osSavedState() & 0x6) != 0x6)
+        return IsaLevel::SSE42;
+
+    CpuId l7 = cpuid(7);
+    bool lzcnt = cpuid(0x80000000).eax >= 0x80000001 && has(cpuid(0x80000001).ecx, 5);
+    if (!(has(l7.ebx, 5) && has(l7.ebx, 3) && has(l7.ebx, 8) && lzcnt))
+        return IsaLevel::SSE42;  // AVX2, BMI1, BMI2, LZCNT
+
+    // F, DQ, CD, BW, VL, plus opmask and ZMM state in XCR0
+    bool avx512 = has(l7.ebx, 16) && has(l7.ebx, 17) && has(l7.ebx, 28) &&
+                  has(l7.ebx, 30) && has(l7.ebx, 31);
+    if (!avx512 || (osSavedState() & 0xE6) != 0xE6)
+        return IsaLevel::AVX2;
+
+    return IsaLevel::AVX512;
+}
+
+#else
+
+IsaLevel detect()
+{
+    return IsaLevel::Generic;
+}
+
+#endif
+
+// ================= SELECTION =================
+
+const BatchKernels& kernelsFor(IsaLevel level)
+{
+    switch (level) {
+        case IsaLevel::Generic: break;
+#ifdef CALC_X86_64
+        case IsaLevel::SSE2:    return batch::sse2;
+        case IsaLevel::SSE42:   return batch::sse42;
+        case IsaLevel::AVX2:    return batch::avx2;
+        case IsaLevel::AVX512:  return batch::avx512;
+#else
+        default: break;
+#endif
+    }
+    return batch::generic;
+}
+
+// the best level, lowered by CALC_ISA
+IsaLevel startupIsa()
+{
+    IsaLevel level = detectedIsa();
+    IsaLevel wanted;
+    if (const char* env = std::getenv("CALC_ISA"); env && parseIsa(env, wanted) && wanted < level)
+        level = wanted;
+    return level;
+}
+
+std::atomic<const BatchKernels*>& activeKernels()
+{
+    static std::atomic<const BatchKernels*> active{ &kernelsFor(startupIsa()) };
+    return active;
+}
+
+} // namespace
+
+
+IsaLevel detectedIsa()
+{
+    static const IsaLevel level = detect();
+    return level;
+}
+
+IsaLevel activeIsa()
+{
+    return batchKernels().level;
+}
+
+void setIsa(IsaLevel level)
+{
+    if (level > detectedIsa())
+        throw std::invalid_argument("ISA not supported");
+
+    activeKernels().store(&kernelsFor(level), std::memory_order_relaxed);
+}
+
+const char* isaName(IsaLevel level)
+{
+    switch (level) {
+        case IsaLevel::Generic: return "generic";
+        case IsaLevel::SSE2:    return "sse2";
+        case IsaLevel::SSE42:   return "sse4.2";
+        case IsaLevel::AVX2:    return "avx2";
+        case IsaLevel::AVX512:  return "avx512";
+    }
+    return "?";
+}
+
+bool parseIsa(std::string_view name, IsaLevel& out)
+{
+    for (IsaLevel l : { IsaLevel::Generic, IsaLevel::SSE2, IsaLevel::SSE42, IsaLevel::AVX2, IsaLevel::AVX512 }) {
+        if (name == isaName(l)) {
+            out = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+const BatchKernels& batchKernels()
+{
+    return *activeKernels().load(std::memory_order_relaxed);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string_view>
+
+// Instruction set levels the batch kernels are built for (see
+// batch_kernels.h), lowest first. Each level includes the ones below it.
+enum class IsaLevel {
+    Generic,    // portable C++, no vector code; the only level off x86-64
+    SSE2,       // the x86-64 baseline
+    SSE42,      // + SSSE3, SSE4.1, SSE4.2, POPCNT
+    AVX2,       // + AVX2, BMI1, BMI2, LZCNT
+    AVX512      // + AVX-512 F, CD, BW, DQ, VL
+};
+
+// the best level this CPU and this build support, from CPUID
+IsaLevel detectedIsa();
+
+// The level the batch kernels run at. It is chosen once, on first use:
+// detectedIsa(), or the lower level named by the CALC_ISA environment
+// variable ("generic", "sse2", "sse4.2", "avx2", "avx512"). Levels the
+// CPU does not have are clamped to detectedIsa().
+IsaLevel activeIsa();
+
+// switches every batch kernel to `level`, e.g. to test or time each one;
+// throws std::invalid_argument("ISA not supported") above detectedIsa()
+void setIsa(IsaLevel level);
+
+// the names CALC_ISA takes; parseIsa() leaves `out` alone on failure
+const char* isaName(IsaLevel level);
+bool parseIsa(std::string_view name, IsaLevel& out);
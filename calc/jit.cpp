@@ -0,0 +1,351 @@
+#include "jit.h"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if !defined(CALC_NO_JIT) && (defined(__x86_64__) || defined(_M_X64))
+#define CALC_JIT_X64 1
+#endif
+
+#ifdef CALC_JIT_X64
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
+
+using OpCode = Expression::OpCode;
+
+#ifdef CALC_JIT_X64
+
+namespace {
+
+// ================= CODE BUFFER =================
+
+class Emitter {
+public:
+    std::vector<uint8_t> buf;
+
+    void bytes(std::initializer_list<uint8_t> b) { buf.insert(buf.end(), b); }
+
+    void imm32(uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i) buf.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void imm64(uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i) buf.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    size_t here() const { return buf.size(); }
+
+    void patch32(size_t at, int32_t v)
+    {
+        for (int i = 0; i < 4; ++i) buf[at + i] = static_cast<uint8_t>(static_cast<uint32_t>(v) >> (8 * i));
+    }
+};
+
+// Register use (all caller-saved in both the SysV and the Win64 ABI):
+//   rax  top of the expression stack, the rest lives on the machine stack
+//   rcx  right operand / shift count
+//   rdx  scratch
+//   r8   x for the current element
+//   r9   in pointer, r10 out pointer, r11 remaining count
+
+// sign-extend rax from the word size, the narrowing every op ends with
+void narrow(Emitter& e, WordSize w)
+{
+    switch (w) {
+        case WordSize::BYTE:  e.bytes({ 0x48, 0x0F, 0xBE, 0xC0 }); break;  // movsx rax, al
+        case WordSize::WORD:  e.bytes({ 0x48, 0x0F, 0xBF, 0xC0 }); break;  // movsx rax, ax
+        case WordSize::DWORD: e.bytes({ 0x48, 0x63, 0xC0 });       break;  // movsxd rax, eax
+        case WordSize::QWORD:
+        case WordSize::DQWORD: break;
+    }
+}
+
+// zero-extend rax from the word size, for logical right shifts
+void zeroExtend(Emitter& e, WordSize w)
+{
+    switch (w) {
+        case WordSize::BYTE:  e.bytes({ 0x0F, 0xB6, 0xC0 }); break;  // movzx eax, al
+        case WordSize::WORD:  e.bytes({ 0x0F, 0xB7, 0xC0 }); break;  // movzx eax, ax
+        case WordSize::DWORD: e.bytes({ 0x89, 0xC0 });       break;  // mov eax, eax
+        case WordSize::QWORD:
+        case WordSize::DQWORD: break;
+    }
+}
+
+// counts >= word size (unsigned) clear the result: rax = rcx >= bits ? 0 : rax
+void clearIfCountTooBig(Emitter& e, WordSize w)
+{
+    e.bytes({ 0x31, 0xD2 });                                // xor edx, edx
+    e.bytes({ 0x48, 0x83, 0xF9, static_cast<uint8_t>(w) }); // cmp rcx, bits
+    e.bytes({ 0x48, 0x0F, 0x43, 0xC2 });                    // cmovae rax, rdx
+}
+
+void rotate(Emitter& e, WordSize w, bool left)
+{
+    uint8_t modrm = left ? 0xC0 : 0xC8;
+    switch (w) {
+        case WordSize::BYTE:  e.bytes({ 0xD2, modrm });       break;  // rol/ror al, cl
+        case WordSize::WORD:  e.bytes({ 0x66, 0xD3, modrm }); break;  // rol/ror ax, cl
+        case WordSize::DWORD: e.bytes({ 0xD3, modrm });       break;  // rol/ror eax, cl
+        case WordSize::QWORD:
+        case WordSize::DQWORD: e.bytes({ 0x48, 0xD3, modrm }); break;  // rol/ror rax, cl
+    }
+}
+
+// returns false for bytecode the backend does not translate
+bool emitBody(Emitter& e, const Expression& expr, WordSize w)
+{
+    const auto& code = expr.bytecode();
+    const auto& consts = expr.constants();
+    int depth = 0;
+
+    auto push = [&] {
+        if (depth++ > 0)
+            e.bytes({ 0x50 });                  // push rax
+    };
+
+    auto popRight = [&] {
+        e.bytes({ 0x48, 0x89, 0xC1 });          // mov rcx, rax
+        e.bytes({ 0x58 });                      // pop rax
+        --depth;
+    };
+
+    for (size_t i = 0; i < code.size(); ++i) {
+        switch (static_cast<OpCode>(code[i])) {
+            case OpCode::PushConst: {
+                int64_t v = consts[code[i + 1] | (code[i + 2] << 8)];
+                i += 2;
+                push();
+                if (v >= INT32_MIN && v <= INT32_MAX) {
+                    e.bytes({ 0x48, 0xC7, 0xC0 });  // mov rax, simm32
+                    e.imm32(static_cast<uint32_t>(v));
+                } else {
+                    e.bytes({ 0x48, 0xB8 });        // mov rax, imm64
+                    e.imm64(static_cast<uint64_t>(v));
+                }
+                break;
+            }
+
+            case OpCode::PushX:
+                push();
+                e.bytes({ 0x4C, 0x89, 0xC0 });      // mov rax, r8
+                break;
+
+            case OpCode::Add: popRight(); e.bytes({ 0x48, 0x01, 0xC8 });       narrow(e, w); break;
+            case OpCode::Sub: popRight(); e.bytes({ 0x48, 0x29, 0xC8 });       narrow(e, w); break;
+            case OpCode::Mul: popRight(); e.bytes({ 0x48, 0x0F, 0xAF, 0xC1 }); narrow(e, w); break;
+            case OpCode::And: popRight(); e.bytes({ 0x48, 0x21, 0xC8 });       narrow(e, w); break;
+            case OpCode::Or:  popRight(); e.bytes({ 0x48, 0x09, 0xC8 });       narrow(e, w); break;
+            case OpCode::Xor: popRight(); e.bytes({ 0x48, 0x31, 0xC8 });       narrow(e, w); break;
+
+            case OpCode::Shl:
+                popRight();
+                e.bytes({ 0x48, 0xD3, 0xE0 });      // shl rax, cl
+                clearIfCountTooBig(e, w);
+                narrow(e, w);
+                break;
+
+            case OpCode::Shr:
+                popRight();
+                zeroExtend(e, w);
+                e.bytes({ 0x48, 0xD3, 0xE8 });      // shr rax, cl
+                clearIfCountTooBig(e, w);
+                narrow(e, w);
+                break;
+
+            // the hardware masks the count to the operand size, which is the
+            // same as the interpreter's count % bits for power-of-two sizes
+            case OpCode::Rol: popRight(); rotate(e, w, true);  narrow(e, w); break;
+            case OpCode::Ror: popRight(); rotate(e, w, false); narrow(e, w); break;
+
+            case OpCode::Neg: e.bytes({ 0x48, 0xF7, 0xD8 }); narrow(e, w); break;  // neg rax
+            case OpCode::Not: e.bytes({ 0x48, 0xF7, 0xD0 }); narrow(e, w); break;  // not rax
+
+            case OpCode::Div:
+            case OpCode::Mod:
+            case OpCode::Sqrt:
+                return false;
+        }
+    }
+
+    narrow(e, w);
+    return depth == 1;
+}
+
+std::vector<uint8_t> generate(const Expression& expr, WordSize w, bool& ok)
+{
+    Emitter e;
+
+#if defined(_WIN32)
+    e.bytes({ 0x49, 0x89, 0xC9 });  // mov r9, rcx
+    e.bytes({ 0x49, 0x89, 0xD2 });  // mov r10, rdx
+    e.bytes({ 0x4D, 0x89, 0xC3 });  // mov r11, r8
+#else
+    e.bytes({ 0x49, 0x89, 0xF9 });  // mov r9, rdi
+    e.bytes({ 0x49, 0x89, 0xF2 });  // mov r10, rsi
+    e.bytes({ 0x49, 0x89, 0xD3 });  // mov r11, rdx
+#endif
+
+    e.bytes({ 0x4D, 0x85, 0xDB });  // test r11, r11
+    e.bytes({ 0x0F, 0x84 });        // jz done
+    size_t jzDone = e.here();
+    e.imm32(0);
+
+    size_t loop = e.here();
+    e.bytes({ 0x4D, 0x8B, 0x01 });  // mov r8, [r9]
+
+    ok = emitBody(e, expr, w);
+
+    e.bytes({ 0x49, 0x89, 0x02 });        // mov [r10], rax
+    e.bytes({ 0x49, 0x83, 0xC1, 0x08 });  // add r9, 8
+    e.bytes({ 0x49, 0x83, 0xC2, 0x08 });  // add r10, 8
+    e.bytes({ 0x49, 0xFF, 0xCB });        // dec r11
+    e.bytes({ 0x0F, 0x85 });              // jnz loop
+    e.imm32(static_cast<uint32_t>(static_cast<int32_t>(loop - (e.here() + 4))));
+
+    e.patch32(jzDone, static_cast<int32_t>(e.here() - (jzDone + 4)));
+    e.bytes({ 0xC3 });                    // ret
+
+    return e.buf;
+}
+
+// ================= EXECUTABLE MEMORY =================
+
+size_t pageRound(size_t n)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    size_t page = si.dwPageSize;
+#else
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return (n + page - 1) / page * page;
+}
+
+void* mapExecutable(const std::vector<uint8_t>& code, size_t size)
+{
+#if defined(_WIN32)
+    void* p = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!p) return nullptr;
+    std::memcpy(p, code.data(), code.size());
+    DWORD old;
+    if (!VirtualProtect(p, size, PAGE_EXECUTE_READ, &old)) {
+        VirtualFree(p, 0, MEM_RELEASE);
+        return nullptr;
+    }
+    FlushInstructionCache(GetCurrentProcess(), p, size);
+    return p;
+#else
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+    std::memcpy(p, code.data(), code.size());
+    if (mprotect(p, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(p, size);
+        return nullptr;
+    }
+    return p;
+#endif
+}
+
+void unmapExecutable(void* p, size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, size);
+#endif
+}
+
+} // namespace
+
+#endif // CALC_JIT_X64
+
+
+// ================= NATIVE EXPRESSION =================
+
+NativeExpression::NativeExpression(const Expression& e, WordSize w)
+    : expr(e), wordSize(w == WordSize::DQWORD ? WordSize::QWORD : w)   // 64-bit, as evaluate() does
+{
+#ifdef CALC_JIT_X64
+    w = wordSize;
+    bool ok = false;
+    std::vector<uint8_t> code = generate(expr, w, ok);
+    if (!ok) return;
+
+    size_t size = pageRound(code.size());
+    page = mapExecutable(code, size);
+    if (!page) return;
+
+    pageSize = size;
+    fn = reinterpret_cast<Fn>(page);
+#endif
+}
+
+NativeExpression::~NativeExpression()
+{
+    release();
+}
+
+NativeExpression::NativeExpression(NativeExpression&& other) noexcept
+    : expr(std::move(other.expr)), wordSize(other.wordSize),
+      page(std::exchange(other.page, nullptr)),
+      pageSize(std::exchange(other.pageSize, 0)),
+      fn(std::exchange(other.fn, nullptr)) {}
+
+NativeExpression& NativeExpression::operator=(NativeExpression&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        expr = std::move(other.expr);
+        wordSize = other.wordSize;
+        page = std::exchange(other.page, nullptr);
+        pageSize = std::exchange(other.pageSize, 0);
+        fn = std::exchange(other.fn, nullptr);
+    }
+    return *this;
+}
+
+void NativeExpression::release()
+{
+#ifdef CALC_JIT_X64
+    if (page)
+        unmapExecutable(page, pageSize);
+#endif
+    page = nullptr;
+    pageSize = 0;
+    fn = nullptr;
+}
+
+int64_t NativeExpression::evaluate(int64_t x) const
+{
+    if (!fn)
+        return expr.evaluate(wordSize, x);
+
+    int64_t r;
+    fn(&x, &r, 1);
+    return r;
+}
+
+void NativeExpression::evaluate(std::span<const int64_t> in, std::span<int64_t> out) const
+{
+    if (out.size() < in.size())
+        throw std::invalid_argument("Size mismatch");
+
+    if (fn) {
+        fn(in.data(), out.data(), in.size());
+        return;
+    }
+
+    for (size_t i = 0; i < in.size(); ++i)
+        out[i] = expr.evaluate(wordSize, in[i]);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "expression.h"
+
+// Native backend for hot expressions.
+//
+// On x86-64 the bytecode is translated to machine code in its own
+// executable page: a loop over an input array that keeps the top of the
+// expression stack in a register and narrows to the word size after each
+// op, with the same results as Expression::evaluate.
+//
+// Division, modulo and √ are not translated; expressions using them, other
+// architectures and builds with CALC_NO_JIT run on the interpreter instead.
+
+class NativeExpression {
+public:
+    NativeExpression(const Expression& e, WordSize w);
+    ~NativeExpression();
+
+    NativeExpression(NativeExpression&& other) noexcept;
+    NativeExpression& operator=(NativeExpression&& other) noexcept;
+    NativeExpression(const NativeExpression&) = delete;
+    NativeExpression& operator=(const NativeExpression&) = delete;
+
+    bool isNative() const { return fn != nullptr; }
+
+    int64_t evaluate(int64_t x) const;
+
+    // out[i] = expression evaluated with x = in[i]
+    void evaluate(std::span<const int64_t> in, std::span<int64_t> out) const;
+
+private:
+    using Fn = void (*)(const int64_t* in, int64_t* out, size_t n);
+
+    Expression expr;
+    WordSize wordSize;
+
+    void* page = nullptr;
+    size_t pageSize = 0;
+    Fn fn = nullptr;
+
+    void release();
+};
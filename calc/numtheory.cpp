@@ -0,0 +1,175 @@
+#include "numtheory.h"
+#include "wordops.h"
+#include <algorithm>
+
+namespace {
+
+using wordops::Montgomery;
+
+constexpr uint64_t smallPrimes[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+
+// a + b mod m for a, b < m, without the sum wrapping
+inline uint64_t addMod(uint64_t a, uint64_t b, uint64_t m)
+{
+    return a >= m - b ? a - (m - b) : a + b;
+}
+
+// false when a proves the odd n = d * 2^s + 1 composite
+bool strongProbablePrime(const Montgomery& mont, uint64_t a, uint64_t d, int s)
+{
+    const uint64_t n = mont.m;
+    a %= n;
+    if (a == 0)
+        return true;
+
+    const uint64_t one = mont.toForm(1);
+    const uint64_t minusOne = n - one;      // the form of n - 1 is -R mod n
+    uint64_t x = mont.powInForm(mont.toForm(a), d);
+    if (x == one || x == minusOne)
+        return true;
+    for (int i = 1; i < s; ++i) {
+        x = mont.multiply(x, x);
+        if (x == minusOne)
+            return true;
+    }
+    return false;
+}
+
+// Brent's variant of Pollard's rho with f(x) = x^2 + c, for an odd
+// composite n. The |x - y| are multiplied up 128 at a time so gcd runs
+// once per batch; when a batch overshoots to n it is replayed one step at a
+// time. Returns n when this c fails, the caller then tries the next one.
+uint64_t rho(const Montgomery& mont, uint64_t c)
+{
+    constexpr uint64_t batch = 128;
+    const uint64_t n = mont.m;
+    const uint64_t cf = mont.toForm(c);
+    auto f = [&](uint64_t v) { return addMod(mont.multiply(v, v), cf, n); };
+    auto diff = [](uint64_t a, uint64_t b) { return a > b ? a - b : b - a; };
+
+    uint64_t x = 0, y = mont.toForm(2), ys = y, q = mont.toForm(1), g = 1;
+    for (uint64_t r = 1; g == 1; r *= 2) {
+        x = y;
+        for (uint64_t i = 0; i < r; ++i)
+            y = f(y);
+        for (uint64_t k = 0; k < r && g == 1; k += batch) {
+            ys = y;
+            for (uint64_t i = 0; i < std::min(batch, r - k); ++i) {
+                y = f(y);
+                q = mont.multiply(q, diff(x, y));
+            }
+            // q carries a factor R, which is coprime to n
+            g = numtheory::gcd(q, n);
+        }
+    }
+    if (g == n) {
+        do {
+            ys = f(ys);
+            g = numtheory::gcd(diff(x, ys), n);
+        } while (g == 1);
+    }
+    return g;
+}
+
+void split(uint64_t n, std::vector<uint64_t>& out)
+{
+    if (n == 1)
+        return;
+    if (numtheory::isPrime(n)) {
+        out.push_back(n);
+        return;
+    }
+
+    Montgomery mont(n);
+    uint64_t d = n;
+    for (uint64_t c = 1; d == n; ++c)
+        d = rho(mont, c);
+    split(d, out);
+    split(n / d, out);
+}
+
+} // namespace
+
+
+namespace numtheory {
+
+// iterative, on the magnitudes; the coefficients wrap in uint64_t, which
+// only the unused last pair (b / g, a / g) could need
+uint64_t egcd(uint64_t a, uint64_t b, int64_t& x, int64_t& y)
+{
+    uint64_t r0 = a, r1 = b;
+    uint64_t s0 = 1, s1 = 0, t0 = 0, t1 = 1;
+    while (r1) {
+        uint64_t q = r0 / r1;
+        uint64_t r = r0 - q * r1;
+        uint64_t s = s0 - q * s1;
+        uint64_t t = t0 - q * t1;
+        r0 = r1; r1 = r;
+        s0 = s1; s1 = s;
+        t0 = t1; t1 = t;
+    }
+    x = static_cast<int64_t>(s0);
+    y = static_cast<int64_t>(t0);
+    return r0;
+}
+
+bool modInverse(uint64_t a, uint64_t m, uint64_t& out)
+{
+    int64_t x, y;
+    if (egcd(a % m, m, x, y) != 1)
+        return false;
+
+    // |x| <= m / 2, so one correction brings it into [0, m)
+    out = x < 0 ? m - (0 - static_cast<uint64_t>(x)) : static_cast<uint64_t>(x);
+    return true;
+}
+
+bool isPrime(uint64_t n)
+{
+    if (n < 2)
+        return false;
+    for (uint64_t p : smallPrimes)
+        if (n % p == 0)
+            return n == p;
+    if (n < 41 * 41)
+        return true;
+
+    const Montgomery mont(n);
+    const int s = std::countr_zero(n - 1);
+    const uint64_t d = (n - 1) >> s;
+
+    if (n < (1ULL << 32)) {
+        for (uint64_t a : { 2, 7, 61 })
+            if (!strongProbablePrime(mont, a, d, s))
+                return false;
+        return true;
+    }
+    for (uint64_t a : { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 })
+        if (!strongProbablePrime(mont, a, d, s))
+            return false;
+    return true;
+}
+
+std::vector<uint64_t> factor(uint64_t n)
+{
+    std::vector<uint64_t> out;
+    if (n < 2)
+        return out;
+
+    // small factors are cheaper to divide out than to find with rho
+    int twos = std::countr_zero(n);
+    out.assign(static_cast<size_t>(twos), 2);
+    n >>= twos;
+    for (uint64_t p : smallPrimes) {
+        while (p != 2 && n % p == 0) {
+            out.push_back(p);
+            n /= p;
+        }
+    }
+
+    split(n, out);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+} // namespace numtheory
@@ -0,0 +1,45 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// Number theory on 64-bit magnitudes: binary gcd, the extended Euclidean
+// algorithm, deterministic Miller-Rabin and Pollard-Brent rho. The modular
+// products of the last two stay in Montgomery form (wordops::Montgomery),
+// so their loops never divide.
+
+namespace numtheory {
+
+// Stein's binary gcd: shifts and subtracts only; gcd(0, 0) = 0
+constexpr uint64_t gcd(uint64_t a, uint64_t b)
+{
+    if (a == 0) return b;
+    if (b == 0) return a;
+    int shift = std::countr_zero(a | b);
+    a >>= std::countr_zero(a);
+    do {
+        // min and |difference| rather than a swap, so it becomes CMOVs
+        b >>= std::countr_zero(b);
+        uint64_t d = a > b ? a - b : b - a;
+        a = a < b ? a : b;
+        b = d;
+    } while (b);
+    return a << shift;
+}
+
+// gcd(a, b) = a * x + b * y, with |x| <= b / 2g and |y| <= a / 2g apart
+// from the trivial cases, so both fit even for magnitudes of 2^63
+uint64_t egcd(uint64_t a, uint64_t b, int64_t& x, int64_t& y);
+
+// a^-1 mod m for m > 0, in [0, m); false when gcd(a, m) != 1
+bool modInverse(uint64_t a, uint64_t m, uint64_t& out);
+
+// exact for every 64-bit n: trial division by the primes below 40, then
+// strong-probable-prime tests to bases known to leave no 64-bit
+// pseudoprime (2, 7, 61 below 2^32; Sinclair's seven above)
+bool isPrime(uint64_t n);
+
+// the prime factors of n, ascending and with multiplicity; empty for 0 and 1
+std::vector<uint64_t> factor(uint64_t n);
+
+} // namespace numtheory
@@ -0,0 +1,293 @@
+#include "stream.h"
+#include "format.h"
+#include "jit.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// ================= INPUT MAPPING =================
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Cannot open " + path);
+
+        LARGE_INTEGER sz;
+        GetFileSizeEx(file, &sz);
+        len = static_cast<size_t>(sz.QuadPart);
+        if (len == 0) return;
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        ptr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!ptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Cannot map " + path);
+        }
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open " + path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot open " + path);
+        }
+        len = static_cast<size_t>(st.st_size);
+        if (len == 0) return;
+
+        void* p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        ptr = static_cast<const char*>(p);
+        madvise(p, len, MADV_SEQUENTIAL);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#if defined(_WIN32)
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        if (ptr) munmap(const_cast<char*>(ptr), len);
+        close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+
+    // pages before `end` are not needed again, let the OS drop them
+    void release(size_t end)
+    {
+#if !defined(_WIN32)
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t upto = end / page * page;
+        if (ptr && upto > released) {
+            madvise(const_cast<char*>(ptr) + released, upto - released, MADV_DONTNEED);
+            released = upto;
+        }
+#else
+        (void)end;
+#endif
+    }
+
+private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+    size_t released = 0;
+#endif
+};
+
+// ================= PARSING =================
+
+// one number per line, same literal rules as Expression
+bool parseLine(std::string_view s, NumberBase base, int64_t& out)
+{
+    ParseResult r = parseNumber(s, base, WordSize::QWORD);
+    out = r.value;
+    return static_cast<bool>(r);
+}
+
+std::string_view trimLine(std::string_view s)
+{
+    while (!s.empty() && (s.back() == '\r' || s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    return s;
+}
+
+// ================= CHUNKS =================
+
+// A valid line is a sign, a prefix and at most maxDisplayLength digits; the
+// cap leaves plenty of room for padding. A longer line is written as Error
+// without being parsed, and never stretches a chunk past chunkSize + cap.
+constexpr size_t maxLineLength = 1024;
+
+// the end of the chunk starting at pos: after the first newline past
+// pos + chunkSize. A line running over the cap there is left to the next
+// chunk, and a chunk that starts with one is just that line, so it is read
+// once by memchr and never buffered.
+size_t chunkEnd(const char* data, size_t size, size_t pos, size_t chunkSize)
+{
+    size_t end = std::min(size, pos + chunkSize);
+    if (end == size)
+        return end;
+
+    size_t reach = std::min(size - end, maxLineLength);
+    if (const void* nl = memchr(data + end, '\n', reach))
+        return static_cast<size_t>(static_cast<const char*>(nl) - data) + 1;
+
+    size_t last = std::string_view(data + pos, end - pos).rfind('\n');
+    if (last != std::string_view::npos)
+        return pos + last + 1;
+
+    const void* nl = memchr(data + end, '\n', size - end);
+    return nl ? static_cast<size_t>(static_cast<const char*>(nl) - data) + 1 : size;
+}
+
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    std::string out;
+    uint64_t lines = 0;
+    uint64_t errors = 0;
+};
+
+void processChunk(Chunk& c, const NativeExpression& pipeline, const StreamOptions& o)
+{
+    std::vector<std::string_view> lines;
+    for (const char* p = c.begin; p < c.end; ) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(c.end - p)));
+        const char* stop = nl ? nl : c.end;
+        lines.push_back(trimLine(std::string_view(p, static_cast<size_t>(stop - p))));
+        p = stop + 1;
+    }
+
+    std::vector<int64_t> values(lines.size());
+    std::vector<uint8_t> ok(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i)
+        ok[i] = lines[i].size() <= maxLineLength && parseLine(lines[i], o.inputBase, values[i]);
+
+    // native code cannot fail, so it can run over the whole chunk at once
+    std::vector<int64_t> results(lines.size());
+    if (pipeline.isNative()) {
+        pipeline.evaluate(values, results);
+    } else {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (!ok[i]) continue;
+            try {
+                results[i] = pipeline.evaluate(values[i]);
+            }
+            catch (const std::invalid_argument&) {
+                ok[i] = false;
+            }
+        }
+    }
+
+    // a blank line stays blank in the output, it is not an error
+    size_t failed = 0;
+    size_t blank = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        blank += lines[i].empty();
+        failed += !ok[i] && !lines[i].empty();
+    }
+
+    c.out.clear();
+    c.lines = lines.size();
+    c.errors = failed;
+
+    if (failed == 0 && blank == 0) {
+        BulkFormat f;
+        f.base = o.outputBase;
+        f.wordSize = o.wordSize;
+        c.out.resize(bulkFormatCapacity(results.size()));
+        c.out.resize(formatBulk(results, f, c.out.data()));
+        return;
+    }
+
+    DisplayBuffer digits;
+    c.out.reserve(lines.size() * (maxDisplayLength + 1));
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (ok[i]) {
+            size_t n = formatValue(digits.data(), static_cast<uint64_t>(results[i]),
+                                   o.wordSize, o.outputBase);
+            c.out.append(digits.data(), n);
+        } else if (!lines[i].empty()) {
+            c.out += "Error";
+        }
+        c.out += '\n';
+    }
+}
+
+} // namespace
+
+
+StreamStats streamFile(const std::string& inputPath, std::FILE* out,
+                       const Expression& pipeline, const StreamOptions& options)
+{
+    MappedFile in(inputPath);
+    NativeExpression compiled(pipeline, options.wordSize);
+
+    unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    threads = std::max(1u, threads);
+    size_t chunkSize = std::max<size_t>(options.chunkSize, 64);
+
+    StreamStats stats;
+    stats.bytesIn = in.size();
+
+    std::vector<Chunk> window(threads);
+    const char* data = in.data();
+    size_t pos = 0;
+
+    while (pos < in.size()) {
+        // cut the next window of chunks, each ending after a newline
+        size_t used = 0;
+        for (; used < threads && pos < in.size(); ++used) {
+            size_t end = chunkEnd(data, in.size(), pos, chunkSize);
+            window[used].begin = data + pos;
+            window[used].end = data + end;
+            pos = end;
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < used; ++i)
+            workers.emplace_back(processChunk, std::ref(window[i]), std::cref(compiled), std::cref(options));
+        processChunk(window[0], compiled, options);
+        for (auto& t : workers)
+            t.join();
+
+        for (size_t i = 0; i < used; ++i) {
+            const Chunk& c = window[i];
+            if (std::fwrite(c.out.data(), 1, c.out.size(), out) != c.out.size())
+                throw std::runtime_error("Write failed");
+            stats.lines += c.lines;
+            stats.errors += c.errors;
+            stats.bytesOut += c.out.size();
+        }
+
+        in.release(pos);
+    }
+
+    return stats;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "calculator.h"
+#include "expression.h"
+
+// Streaming conversion of large number dumps.
+//
+// The input file is memory-mapped and cut into chunks on line boundaries.
+// Each line holds one number: in `inputBase`, or with a 0x / 0o / 0b
+// prefix, optionally negative. The number is run through `pipeline` as x
+// and written as one line, formatted like Calculator::display() for
+// `outputBase` and `wordSize`. A line that fails to parse or evaluate is
+// written as "Error" and a blank line as a blank line, so output lines
+// stay aligned with the input.
+//
+// Chunks are processed in parallel, but output is written in input order.
+// At most `threads` chunks are in flight at a time, so memory stays bounded
+// whatever the file size. A line too long to be a number is an Error line
+// and is never buffered, however long it is.
+
+struct StreamOptions {
+    NumberBase inputBase = NumberBase::DEC;
+    NumberBase outputBase = NumberBase::DEC;
+    WordSize wordSize = WordSize::QWORD;
+    size_t chunkSize = size_t(1) << 20;   // bytes of input per chunk
+    unsigned threads = 0;                 // 0 = one per core
+};
+
+struct StreamStats {
+    uint64_t lines = 0;
+    uint64_t errors = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+};
+
+// throws std::runtime_error when the input cannot be read or the output
+// cannot be written
+StreamStats streamFile(const std::string& inputPath, std::FILE* out,
+                       const Expression& pipeline, const StreamOptions& options = {});
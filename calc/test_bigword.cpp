@@ -0,0 +1,569 @@
+#include "catch_amalgamated.hpp"
+#include "bigword.h"
+#include "wordops.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+using i128 = __int128;
+using u128 = unsigned __int128;
+
+static BigWord from128(u128 v) { return bigword::fromInt128(v); }
+static u128 to128(const BigWord& v) { return bigword::toInt128(v); }
+
+static BigWord randomWord(std::mt19937_64& rng, unsigned bits)
+{
+    BigWord r(0, bits);
+    for (uint64_t& x : r.limbs()) x = rng();
+
+    // mostly full width, sometimes short so divisions go both ways
+    size_t keep = 1 + rng() % r.size();
+    if (rng() % 3 == 0)
+        for (size_t i = keep; i < r.size(); ++i) r.limbs()[i] = 0;
+    return r;
+}
+
+static std::vector<u128> samples128()
+{
+    std::vector<u128> v = { 0, 1, 2, 3, ~u128(0), u128(1) << 127, (u128(1) << 127) - 1,
+                            u128(1) << 64, (u128(1) << 64) - 1, u128(10000000000000000000ULL) };
+    std::mt19937_64 rng(21);
+    for (int i = 0; i < 200; ++i) {
+        u128 x = (static_cast<u128>(rng()) << 64) | rng();
+        v.push_back(x >> (rng() % 128));
+    }
+    return v;
+}
+
+
+TEST_CASE("BigWord widths") {
+
+    REQUIRE(BigWord::validBits(128));
+    REQUIRE(BigWord::validBits(192));
+    REQUIRE(BigWord::validBits(4096));
+    REQUIRE_FALSE(BigWord::validBits(64));
+    REQUIRE_FALSE(BigWord::validBits(100));
+    REQUIRE_FALSE(BigWord::validBits(4160));
+    REQUIRE_THROWS_AS(BigWord(0, 64), std::invalid_argument);
+
+    BigWord m(-2, 256);
+    REQUIRE(m.size() == 4);
+    REQUIRE(m.isNegative());
+    REQUIRE(m.limbs()[3] == ~0ULL);
+    REQUIRE(m.resized(128) == BigWord(-2, 128));
+    REQUIRE(m.resized(512) == BigWord(-2, 512));
+
+    REQUIRE_THROWS_AS(bigword::add(BigWord(1, 128), BigWord(1, 256)), std::invalid_argument);
+}
+
+TEST_CASE("128-bit words match __int128") {
+
+    auto v = samples128();
+
+    for (u128 x : v) {
+        BigWord a = from128(x);
+        REQUIRE(to128(bigword::bitNot(a)) == ~x);
+
+        for (int n : { 0, 1, 63, 64, 65, 127, 128, 200, -1 }) {
+            u128 shl = (n >= 0 && n < 128) ? x << n : 0;
+            u128 shr = (n >= 0 && n < 128) ? x >> n : 0;
+            int r = ((n % 128) + 128) % 128;
+            u128 rol = r ? (x << r) | (x >> (128 - r)) : x;
+            u128 ror = r ? (x >> r) | (x << (128 - r)) : x;
+
+            REQUIRE(to128(bigword::shl(a, n)) == shl);
+            REQUIRE(to128(bigword::shr(a, n)) == shr);
+            REQUIRE(to128(bigword::rol(a, n)) == rol);
+            REQUIRE(to128(bigword::ror(a, n)) == ror);
+        }
+
+        for (size_t j = 0; j < v.size(); j += 7) {
+            u128 y = v[j];
+            BigWord b = from128(y);
+
+            REQUIRE(to128(bigword::add(a, b)) == x + y);
+            REQUIRE(to128(bigword::subtract(a, b)) == x - y);
+            REQUIRE(to128(bigword::multiply(a, b)) == x * y);
+            REQUIRE(to128(bigword::bitAnd(a, b)) == (x & y));
+            REQUIRE(to128(bigword::bitOr(a, b)) == (x | y));
+            REQUIRE(to128(bigword::bitXor(a, b)) == (x ^ y));
+
+            i128 sx = static_cast<i128>(x), sy = static_cast<i128>(y);
+            REQUIRE(bigword::compare(a, b) == (sx < sy ? -1 : sx > sy ? 1 : 0));
+
+            if (y == 0) {
+                REQUIRE_THROWS_AS(bigword::divide(a, b), std::invalid_argument);
+                continue;
+            }
+            bool wraps = x == (u128(1) << 127) && y == ~u128(0);
+            u128 q = wraps ? x : static_cast<u128>(sx / sy);
+            u128 r = wraps ? 0 : static_cast<u128>(sx % sy);
+            REQUIRE(to128(bigword::divide(a, b)) == q);
+            REQUIRE(to128(bigword::mod(a, b)) == r);
+        }
+    }
+}
+
+TEST_CASE("128-bit bit manipulation matches __int128") {
+
+    auto v = samples128();
+
+    auto rev = [](u128 x, int unit) {
+        u128 r = 0;
+        for (int i = 0; i < 128; ++i) {
+            int j = (128 / unit - 1 - i / unit) * unit + (unit == 1 ? 0 : i % unit);
+            r |= ((x >> i) & 1) << j;
+        }
+        return r;
+    };
+
+    for (u128 x : v) {
+        BigWord a = from128(x);
+        int pop = 0, hi = -1, lo = -1;
+        for (int i = 0; i < 128; ++i)
+            if ((x >> i) & 1) { ++pop; hi = i; if (lo < 0) lo = i; }
+
+        REQUIRE(bigword::popcount(a) == pop);
+        REQUIRE(bigword::parity(a) == (pop & 1));
+        REQUIRE(bigword::highestBit(a) == hi);
+        REQUIRE(bigword::lowestBit(a) == lo);
+        REQUIRE(bigword::clz(a) == 127 - hi);
+        REQUIRE(bigword::ctz(a) == (lo < 0 ? 128 : lo));
+        REQUIRE(to128(bigword::bswap(a)) == rev(x, 8));
+        REQUIRE(to128(bigword::bitReverse(a)) == rev(x, 1));
+        REQUIRE(to128(bigword::blsr(a)) == (x & (x - 1)));
+        REQUIRE(to128(bigword::blsi(a)) == (x & (0 - x)));
+
+        for (size_t j = 0; j < v.size(); j += 5) {
+            u128 m = v[j], dep = 0, ext = 0;
+            for (int i = 0, k = 0; i < 128; ++i) {
+                if (!((m >> i) & 1)) continue;
+                dep |= ((x >> k) & 1) << i;
+                ext |= ((x >> i) & 1) << k;
+                ++k;
+            }
+            REQUIRE(to128(bigword::pdep(a, from128(m))) == dep);
+            REQUIRE(to128(bigword::pext(a, from128(m))) == ext);
+        }
+    }
+}
+
+TEST_CASE("Wide pdep and pext invert each other") {
+
+    std::mt19937_64 rng(19);
+
+    for (unsigned bits : { 256u, 1024u }) {
+        for (int i = 0; i < 50; ++i) {
+            BigWord a = randomWord(rng, bits);
+            BigWord m = randomWord(rng, bits);
+
+            // pext(pdep(a, m), m) is the low popcount(m) bits of a
+            BigWord low = bigword::subtract(bigword::shl(BigWord(1, bits), bigword::popcount(m)), BigWord(1, bits));
+            if (bigword::popcount(m) == static_cast<int>(bits)) low = BigWord(-1, bits);
+            REQUIRE(bigword::pext(bigword::pdep(a, m), m) == bigword::bitAnd(a, low));
+            REQUIRE(bigword::pdep(bigword::pext(a, m), m) == bigword::bitAnd(a, m));
+        }
+    }
+}
+
+TEST_CASE("Karatsuba agrees with schoolbook") {
+
+    std::mt19937_64 rng(8);
+
+    // even and odd limb counts around and well above the switch
+    for (unsigned bits : { 2048u, 2112u, 3008u, 3200u, 4032u, 4096u }) {
+        for (int i = 0; i < 20; ++i) {
+            BigWord a = randomWord(rng, bits);
+            BigWord b = randomWord(rng, bits);
+            REQUIRE(bigword::multiply(a, b) == bigword::multiplySchoolbook(a, b));
+        }
+
+        BigWord ones(-1, bits);
+        REQUIRE(bigword::multiply(ones, ones) == BigWord(1, bits));
+        REQUIRE(bigword::multiply(ones, ones) == bigword::multiplySchoolbook(ones, ones));
+    }
+}
+
+TEST_CASE("Wide division: q * b + r == a") {
+
+    std::mt19937_64 rng(13);
+
+    for (unsigned bits : { 128u, 256u, 1024u, 4096u }) {
+        for (int i = 0; i < 200; ++i) {
+            BigWord a = randomWord(rng, bits);
+            BigWord b = randomWord(rng, bits);
+            if (i % 5 == 0) b = bigword::shr(b, static_cast<int>(bits / 2));   // short divisors
+            if (i % 7 == 0) b.limbs()[b.size() - 1] = 0x8000000000000000ULL;  // top bit only
+            if (b.isZero()) continue;
+
+            BigWord q = bigword::divide(a, b);
+            BigWord r = bigword::mod(a, b);
+            REQUIRE(bigword::add(bigword::multiply(q, b), r) == a);
+
+            // |r| < |b| and r takes the sign of a
+            BigWord zero(0, bits);
+            auto abs = [&](const BigWord& x) { return x.isNegative() ? bigword::subtract(zero, x) : x; };
+            if (!r.isZero()) REQUIRE(r.isNegative() == a.isNegative());
+            BigWord ra = abs(r), ba = abs(b);
+            if (!ba.isNegative()) REQUIRE(bigword::compare(ra, ba) < 0);
+        }
+
+        // the most negative value over -1 wraps
+        BigWord min = bigword::shl(BigWord(1, bits), static_cast<int>(bits - 1));
+        REQUIRE(bigword::divide(min, BigWord(-1, bits)) == min);
+        REQUIRE(bigword::mod(min, BigWord(-1, bits)).isZero());
+    }
+}
+
+TEST_CASE("Wide text round trip") {
+
+    BigWord min = bigword::shl(BigWord(1, 128), 127);
+    REQUIRE(bigword::format(min, NumberBase::DEC) == "-170141183460469231731687303715884105728");
+    REQUIRE(bigword::format(BigWord(-1, 128), NumberBase::HEX) == std::string(32, 'F'));
+    REQUIRE(bigword::format(BigWord(-1, 192), NumberBase::OCT) == std::string(64, '7'));
+    REQUIRE(bigword::format(BigWord(0, 256), NumberBase::BIN) == "0");
+    REQUIRE(bigword::format(BigWord(-1428571428571428571LL, 256), NumberBase::DEC) == "-1428571428571428571");
+
+    BigWord out(0, 128);
+    REQUIRE(bigword::parse("340282366920938463463374607431768211455", NumberBase::DEC, out) == ParseError::None);
+    REQUIRE(out == BigWord(-1, 128));
+    REQUIRE(bigword::parse("340282366920938463463374607431768211456", NumberBase::DEC, out) == ParseError::Overflow);
+    REQUIRE(bigword::parse("-170141183460469231731687303715884105728", NumberBase::DEC, out) == ParseError::None);
+    REQUIRE(out == min);
+    REQUIRE(bigword::parse("-170141183460469231731687303715884105729", NumberBase::DEC, out) == ParseError::Overflow);
+    REQUIRE(bigword::parse("-80000000000000000000000000000000", NumberBase::HEX, out) == ParseError::None);
+    REQUIRE(out == min);
+    REQUIRE(bigword::parse("-80000000000000000000000000000001", NumberBase::HEX, out) == ParseError::Overflow);
+    REQUIRE(bigword::parse("-FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF", NumberBase::HEX, out) == ParseError::Overflow);
+    REQUIRE(bigword::parse("0x1" + std::string(32, '0'), NumberBase::DEC, out) == ParseError::Overflow);
+    REQUIRE(bigword::parse("12z", NumberBase::DEC, out) == ParseError::InvalidDigit);
+    REQUIRE(bigword::parse("-", NumberBase::DEC, out) == ParseError::Empty);
+
+    std::mt19937_64 rng(4);
+    for (unsigned bits : { 128u, 320u, 4096u })
+        for (NumberBase b : { NumberBase::DEC, NumberBase::BIN, NumberBase::OCT, NumberBase::HEX })
+            for (int i = 0; i < 20; ++i) {
+                BigWord v = randomWord(rng, bits);
+                BigWord back(0, bits);
+                REQUIRE(bigword::parse(bigword::format(v, b), b, back) == ParseError::None);
+                REQUIRE(back == v);
+            }
+}
+
+TEST_CASE("Calculator in wide mode") {
+
+    Calculator calc;
+    calc.setValue(-5);
+
+    calc.setWordBits(256);
+    REQUIRE(calc.isWide());
+    REQUIRE(calc.getWordBits() == 256);
+    REQUIRE(calc.getWide() == BigWord(-5, 256));
+    REQUIRE(calc.display() == "-5");
+
+    // int64_t ops work at 64 bits and sign-extend
+    calc.add(INT64_MAX, 1);
+    REQUIRE(calc.getWide() == BigWord(INT64_MIN, 256));
+
+    BigWord big = bigword::shl(BigWord(1, 256), 200);
+    calc.add(big, BigWord(3, 256));
+    calc.setBase(NumberBase::HEX);
+    REQUIRE(calc.display() == "1" + std::string(49, '0') + "3");
+    REQUIRE(calc.getValue() == 3);
+
+    DisplayBuffer buf;
+    REQUIRE_THROWS_AS(calc.display(buf), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.add(BigWord(1, 128), BigWord(1, 128)), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.mod(big, BigWord(0, 256)), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.setWordBits(96), std::invalid_argument);
+
+    // narrower wide word truncates, the narrow sizes take the low bits
+    calc.setWordBits(128);
+    REQUIRE(calc.getWide() == BigWord(3, 128));
+    calc.setWide(BigWord(-300, 128));
+    calc.setWordBits(8);
+    REQUIRE_FALSE(calc.isWide());
+    REQUIRE(calc.getWordSize() == WordSize::BYTE);
+    REQUIRE(calc.getValue() == -44);
+}
+
+TEST_CASE("DQWORD word size") {
+
+    Calculator calc;
+    calc.setValue(-1);
+    calc.setWordSize(WordSize::DQWORD);
+
+    REQUIRE(calc.isWide());
+    REQUIRE(calc.getWordSize() == WordSize::DQWORD);
+    REQUIRE(calc.getWordBits() == 128);
+    REQUIRE(calc.getWide() == BigWord(-1, 128));
+
+    // -1 in every base
+    REQUIRE(calc.display() == "-1");
+    calc.setBase(NumberBase::HEX);
+    REQUIRE(calc.display() == std::string(32, 'F'));
+    calc.setBase(NumberBase::OCT);
+    REQUIRE(calc.display() == "3" + std::string(42, '7'));
+    calc.setBase(NumberBase::BIN);
+    REQUIRE(calc.display() == std::string(128, '1'));
+
+    // the int64_t ops sign-extend into the high limb
+    calc.setValue(INT64_MIN);
+    REQUIRE(to128(calc.getWide()) == ~((u128(1) << 63) - 1));
+    calc.setValue(INT64_MAX);
+    REQUIRE(to128(calc.getWide()) == (u128(1) << 63) - 1);
+
+    // 2^64 * 2^63 is the 128-bit minimum, shown signed in DEC
+    calc.multiply(from128(u128(1) << 64), from128(u128(1) << 63));
+    REQUIRE(calc.getWide() == bigword::shl(BigWord(1, 128), 127));
+    calc.setBase(NumberBase::DEC);
+    REQUIRE(calc.display() == "-170141183460469231731687303715884105728");
+
+    calc.isqrt(from128(~u128(0) >> 1));
+    REQUIRE(to128(calc.getWide()) == 0xB504F333F9DE6484ULL);
+    REQUIRE_THROWS_AS(calc.isqrt(BigWord(-4, 128)), std::invalid_argument);
+    calc.reciprocal(BigWord(-1, 128));
+    REQUIRE(calc.getWide() == BigWord(-1, 128));
+    REQUIRE_THROWS_AS(calc.reciprocal(BigWord(3, 128)), std::invalid_argument);
+
+    // bit manipulation counts over all 128 bits
+    calc.clz(BigWord(1, 128));
+    REQUIRE(calc.getWide() == BigWord(127, 128));
+    calc.bswap(BigWord(0x12, 128));
+    REQUIRE(to128(calc.getWide()) == u128(0x12) << 120);
+
+    calc.setWordSize(WordSize::QWORD);
+    REQUIRE_FALSE(calc.isWide());
+    REQUIRE(calc.getWordBits() == 64);
+}
+
+TEST_CASE("Wide isqrt") {
+
+    std::mt19937_64 rng(17);
+
+    for (unsigned bits : { 128u, 256u, 1024u }) {
+        for (int i = 0; i < 100; ++i) {
+            BigWord a = randomWord(rng, bits);
+            a.limbs()[a.size() - 1] >>= 1;   // non-negative
+
+            BigWord r = bigword::isqrt(a);
+            BigWord r1 = bigword::add(r, BigWord(1, bits));
+            REQUIRE(bigword::compare(bigword::multiply(r, r), a) <= 0);
+
+            // (r + 1)^2 > a, unless it wraps past the width
+            BigWord sq = bigword::multiply(r1, r1);
+            if (!sq.isNegative() && bigword::compare(bigword::divide(sq, r1), r1) == 0)
+                REQUIRE(bigword::compare(sq, a) > 0);
+        }
+        REQUIRE(bigword::isqrt(BigWord(0, bits)).isZero());
+        REQUIRE(bigword::isqrt(BigWord(99, bits)) == BigWord(9, bits));
+    }
+}
+
+
+TEST_CASE("Wide flags") {
+
+    auto v = samples128();
+    Calculator calc;
+    calc.setWordSize(WordSize::DQWORD);
+
+    for (u128 x : v) {
+        for (u128 y : v) {
+            BigWord a = from128(x), b = from128(y);
+            i128 r;
+
+            calc.add(a, b);
+            u128 sum = x + y;
+            REQUIRE(bool(calc.getFlags() & flags::CF) == (sum < x));
+            REQUIRE(bool(calc.getFlags() & flags::OF) == __builtin_add_overflow(i128(x), i128(y), &r));
+            REQUIRE(bool(calc.getFlags() & flags::ZF) == (sum == 0));
+            REQUIRE(bool(calc.getFlags() & flags::SF) == (i128(sum) < 0));
+
+            // with the carry of a + b
+            calc.adc(a, b);
+            u128 c = sum < x;
+            REQUIRE(to128(calc.getWide()) == x + y + c);
+            REQUIRE(bool(calc.getFlags() & flags::CF) == (x + y + c < x || (c && y == ~u128(0))));
+
+            calc.subtract(a, b);
+            REQUIRE(bool(calc.getFlags() & flags::CF) == (x < y));
+            REQUIRE(bool(calc.getFlags() & flags::OF) == __builtin_sub_overflow(i128(x), i128(y), &r));
+
+            calc.multiply(a, b);
+            REQUIRE(bool(calc.getFlags() & flags::OF) == __builtin_mul_overflow(i128(x), i128(y), &r));
+        }
+    }
+
+    // wider products: exact at twice the width
+    std::mt19937_64 rng(31);
+    calc.setWordBits(256);
+    for (int i = 0; i < 300; ++i) {
+        BigWord a = randomWord(rng, 256), b = randomWord(rng, 256);
+        if (i % 3 == 0) a = BigWord(rng() % 2 ? -1 : 1, 256);
+        if (i % 7 == 0) b = bigword::shl(BigWord(1, 256), 255);
+
+        BigWord exact = bigword::multiply(a.resized(512), b.resized(512));
+        calc.multiply(a, b);
+        REQUIRE(bool(calc.getFlags() & flags::OF) == !(exact.resized(256).resized(512) == exact));
+    }
+
+    calc.divide(bigword::shl(BigWord(1, 256), 255), BigWord(-1, 256));
+    REQUIRE(calc.getFlags() == (flags::OF | flags::SF | flags::PF));
+    calc.shr(BigWord(1, 256), 1);
+    REQUIRE(calc.getFlags() == (flags::CF | flags::ZF | flags::PF));
+}
+
+
+TEST_CASE("Wide checked ops") {
+
+    Calculator calc;
+    calc.setWordBits(256);
+    calc.setWide(BigWord(42, 256));
+
+    REQUIRE(calc.tryDivide(BigWord(1, 256), BigWord(0, 256)).error == OpError::DivideByZero);
+    REQUIRE(calc.tryMod(BigWord(1, 256), BigWord(0, 256)).error == OpError::DivideByZero);
+    REQUIRE(calc.tryIsqrt(BigWord(-1, 256)).error == OpError::Domain);
+    REQUIRE(calc.tryReciprocal(BigWord(5, 256)).error == OpError::Domain);
+    REQUIRE(calc.getWide() == BigWord(42, 256));
+
+    WideResult r = calc.tryDivide(BigWord(-9, 256), BigWord(2, 256));
+    REQUIRE(r);
+    REQUIRE(r.value == BigWord(-4, 256));
+    REQUIRE(calc.getWide() == r.value);
+
+    REQUIRE_THROWS_AS(calc.tryDivide(BigWord(1, 128), BigWord(1, 128)), std::invalid_argument);
+}
+
+
+TEST_CASE("Wide pow and powmod") {
+
+    Calculator calc;
+    calc.setWordBits(128);
+
+    // pow wraps like __int128 multiplication
+    for (u128 a : samples128()) {
+        for (int e : { 0, 1, 2, 3, 5, 64, 127 }) {
+            u128 p = 1;
+            for (int i = 0; i < e; ++i) p *= a;
+            REQUIRE(to128(calc.pow(from128(a), BigWord(e, 128))) == p);
+        }
+    }
+    calc.pow(BigWord(3, 128), BigWord(81, 128));      // 3^81 > 2^127 > 3^80
+    REQUIRE(calc.getFlags() & flags::OF);
+    calc.pow(BigWord(3, 128), BigWord(80, 128));
+    REQUIRE_FALSE(calc.getFlags() & flags::OF);
+    REQUIRE(calc.tryPow(BigWord(0, 128), BigWord(-1, 128)).error == OpError::DivideByZero);
+    REQUIRE(calc.tryPow(BigWord(2, 128), BigWord(-1, 128)).error == OpError::Domain);
+    REQUIRE(calc.pow(BigWord(-1, 128), BigWord(-3, 128)) == BigWord(-1, 128));
+
+    // Fermat on 2^127 - 1, which needs 254-bit products
+    BigWord p = from128((u128(1) << 127) - 1);
+    BigWord pMinus1 = from128((u128(1) << 127) - 2);
+    for (int64_t a : { 2, 3, -5, 123456789 })
+        REQUIRE(calc.powmod(BigWord(a, 128), pMinus1, p) == BigWord(1, 128));
+
+    // moduli below 2^64 against the 64-bit core
+    std::mt19937_64 rng(22);
+    for (u128 a : samples128()) {
+        uint64_t m = rng() >> (rng() % 63), e = rng() % 5000;
+        if (m == 0) continue;
+        i128 sa = static_cast<i128>(a) % m;
+        uint64_t mod = static_cast<uint64_t>(sa < 0 ? sa + m : sa);
+        REQUIRE(to128(calc.powmod(from128(a), BigWord(static_cast<int64_t>(e), 128),
+                                  from128(m))) == wordops::powMod64(mod, e, m));
+    }
+
+    REQUIRE(calc.tryPowmod(BigWord(2, 128), BigWord(1, 128), BigWord(0, 128)).error == OpError::DivideByZero);
+    REQUIRE(calc.tryPowmod(BigWord(2, 128), BigWord(-1, 128), BigWord(7, 128)).error == OpError::Domain);
+    REQUIRE(calc.powmod(BigWord(-2, 128), BigWord(3, 128), BigWord(-5, 128)) == BigWord(2, 128));
+
+    // wider words go through the limb routines
+    calc.setWordBits(512);
+    BigWord m(0, 512);
+    m.limbs()[7] = 1;
+    m.limbs()[0] = 12345;
+    BigWord r = calc.powmod(BigWord(7, 512), BigWord(1000, 512), m);
+    BigWord slow(1, 512);
+    for (int i = 0; i < 1000; ++i) {
+        BigWord x = bigword::multiply(slow, BigWord(7, 512));   // below 7m, no wrap
+        slow = bigword::mod(x, m);
+    }
+    REQUIRE(r == slow);
+}
+
+TEST_CASE("Wide ops in modular mode") {
+
+    Calculator calc;
+    calc.setWordBits(256);
+    calc.setModulus(1000);
+
+    // the whole word is reduced, not just its low limb
+    BigWord big(0, 256);
+    big.limbs()[3] = 1;                     // 2^192 = 896 mod 1000
+    REQUIRE(calc.add(big, BigWord(0, 256)) == BigWord(896, 256));
+    REQUIRE(calc.multiply(big, BigWord(-3, 256)) == BigWord(312, 256));
+    REQUIRE(calc.subtract(BigWord(-1, 256), BigWord(0, 256)) == BigWord(999, 256));
+    REQUIRE(calc.getWide() == BigWord(999, 256));
+    REQUIRE((calc.getFlags() & (flags::CF | flags::OF)) == 0);
+
+    // an exponent past 64 bits, and a negative one
+    REQUIRE(calc.pow(BigWord(3, 256), big) == BigWord(321, 256));
+    REQUIRE(calc.pow(BigWord(7, 256), BigWord(-1, 256)) == BigWord(143, 256));
+    REQUIRE(calc.divide(BigWord(1, 256), BigWord(7, 256)) == BigWord(143, 256));
+    REQUIRE(calc.tryDivide(BigWord(1, 256), BigWord(4, 256)).error == OpError::Domain);
+    REQUIRE(calc.tryDivide(BigWord(1, 256), BigWord(2000, 256)).error == OpError::DivideByZero);
+    REQUIRE(calc.getWide() == BigWord(143, 256));
+    REQUIRE_THROWS_AS(calc.add(BigWord(0, 128), BigWord(0, 256)), std::invalid_argument);
+
+    calc.setModulus(0);
+    REQUIRE(calc.add(BigWord(999, 256), BigWord(1, 256)) == BigWord(1000, 256));
+}
+
+
+// ================= BENCHMARK =================
+// hidden, run with: calc_tests "[benchmark]"
+
+TEST_CASE("Wide multiplication, schoolbook and Karatsuba", "[.][benchmark]") {
+
+    std::mt19937_64 rng(6);
+
+    for (unsigned bits : { 512u, 1024u, 2048u, 4096u }) {
+        BigWord a(0, bits), b(0, bits);
+        for (uint64_t& x : a.limbs()) x = rng();
+        for (uint64_t& x : b.limbs()) x = rng();
+
+        std::string n = std::to_string(bits);
+        BENCHMARK("schoolbook " + n) { return bigword::multiplySchoolbook(a, b); };
+        BENCHMARK("multiply " + n) { return bigword::multiply(a, b); };
+        BENCHMARK("divide " + n) { return bigword::divide(a, bigword::shr(b, static_cast<int>(bits / 3))); };
+    }
+}
+
+TEST_CASE("DQWORD operations against raw __int128", "[.][benchmark]") {
+
+    std::mt19937_64 rng(12);
+    std::vector<u128> xs(1024);
+    for (u128& x : xs) x = (static_cast<u128>(rng()) << 64) | rng();
+
+    std::vector<BigWord> ws;
+    for (u128 x : xs) ws.push_back(from128(x));
+
+    BENCHMARK("u128 multiply") {
+        u128 acc = 1;
+        for (u128 x : xs) acc = acc * x + 1;
+        return acc;
+    };
+    BENCHMARK("DQWORD multiply") {
+        BigWord acc(1, 128), one(1, 128);
+        for (const BigWord& w : ws) acc = bigword::add(bigword::multiply(acc, w), one);
+        return acc;
+    };
+    BENCHMARK("DQWORD divide") {
+        BigWord acc(0, 128);
+        for (size_t i = 1; i < ws.size(); ++i) acc = bigword::add(acc, bigword::divide(ws[i], ws[i - 1]));
+        return acc;
+    };
+}
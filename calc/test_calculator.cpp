@@ -1,9 +1,18 @@
 #define CATCH_CONFIG_MAIN
 #include "catch_amalgamated.hpp"
 #include "calculator.h"
+#include "isa.h"
+#include "wordops.h"
 
+#include <algorithm>
+#include <bit>
 #include <limits>
+#include <numeric>
+#include <random>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 
 // ================= BASE / DISPLAY =================
@@ -510,3 +519,1383 @@ TEST_CASE("Binary representation BYTE") {
 
     REQUIRE(calc.display() == "11111111");
 }
+
+
+
+// ================= BATCH =================
+
+static const WordSize allWordSizes[] = {
+    WordSize::BYTE, WordSize::WORD, WordSize::DWORD, WordSize::QWORD
+};
+
+static std::vector<int64_t> batchInputs(size_t n, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<int64_t> v = { 0, 1, -1, 127, -128, 255, 0x7FFF, -0x8000,
+                               INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN };
+    while (v.size() < n)
+        v.push_back(static_cast<int64_t>(rng()));
+    return v;
+}
+
+TEST_CASE("Batch binary ops match scalar ops") {
+
+    // odd length so the SIMD loop and the scalar tail both run
+    auto a = batchInputs(37, 1);
+    auto b = batchInputs(37, 2);
+    std::vector<int64_t> out(a.size());
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        Calculator ref;
+        ref.setWordSize(w);
+
+        calc.add(a, b, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.add(a[i], b[i]));
+
+        calc.subtract(a, b, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.subtract(a[i], b[i]));
+
+        calc.multiply(a, b, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.multiply(a[i], b[i]));
+
+        calc.bitAnd(a, b, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.bitAnd(a[i], b[i]));
+
+        calc.bitOr(a, b, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.bitOr(a[i], b[i]));
+
+        calc.bitXor(a, b, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.bitXor(a[i], b[i]));
+
+        calc.bitNot(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.bitNot(a[i]));
+    }
+}
+
+TEST_CASE("Batch shifts and rotates match scalar ops") {
+
+    auto a = batchInputs(21, 3);
+    std::vector<int64_t> out(a.size());
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        Calculator ref;
+        ref.setWordSize(w);
+
+        for (int n = 0; n <= (int)w; ++n) {
+            calc.shl(a, n, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.shl(a[i], n));
+
+            calc.shr(a, n, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.shr(a[i], n));
+
+            calc.rol(a, n, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.rol(a[i], n));
+
+            calc.ror(a, n, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.ror(a[i], n));
+        }
+    }
+}
+
+TEST_CASE("Batch division and math ops") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+
+    std::vector<int64_t> a = { 100, -100, 7, 0 };
+    std::vector<int64_t> b = { 7, 7, -2, 3 };
+    std::vector<int64_t> out(4);
+
+    calc.divide(a, b, out);
+    REQUIRE(out == std::vector<int64_t>{ 14, -14, -3, 0 });
+
+    calc.mod(a, b, out);
+    REQUIRE(out == std::vector<int64_t>{ 2, -2, 1, 0 });
+
+    calc.isqrt(std::vector<int64_t>{ 0, 1, 15, 100 }, out);
+    REQUIRE(out == std::vector<int64_t>{ 0, 1, 3, 10 });
+
+    b[3] = 0;
+    REQUIRE_THROWS_AS(calc.divide(a, b, out), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.mod(a, b, out), std::invalid_argument);
+}
+
+static_assert(noexcept(std::declval<Calculator&>().tryDivide(1, 0)));
+static_assert(noexcept(std::declval<Calculator&>().tryReciprocal(0)));
+
+TEST_CASE("Checked ops return errors instead of throwing") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+    calc.add(0, 42);
+
+    REQUIRE(calc.tryDivide(7, 0).error == OpError::DivideByZero);
+    REQUIRE(calc.tryMod(7, 0).error == OpError::DivideByZero);
+    REQUIRE(calc.tryIsqrt(-4).error == OpError::Domain);
+    REQUIRE(calc.tryReciprocal(0).error == OpError::DivideByZero);
+    REQUIRE(calc.tryReciprocal(3).error == OpError::Domain);
+    REQUIRE(calc.getValue() == 42);
+
+    OpResult r = calc.tryDivide(-128, -1);
+    REQUIRE(r);
+    REQUIRE(r.value == -128);
+    REQUIRE(calc.getFlags() & flags::OF);
+    REQUIRE(calc.tryMod(100, 7).value == 2);
+    REQUIRE(calc.tryIsqrt(100).value == 10);
+    REQUIRE(calc.tryReciprocal(-1).value == -1);
+    REQUIRE(calc.getValue() == -1);
+
+    // the throwing forms keep their messages
+    auto message = [](auto fn) {
+        try { fn(); } catch (const std::invalid_argument& e) { return std::string(e.what()); }
+        return std::string();
+    };
+    REQUIRE(message([&] { calc.divide(1, 0); }) == "Division by zero");
+    REQUIRE(message([&] { calc.mod(1, 0); }) == "DIV/0");
+    REQUIRE(message([&] { calc.reciprocal(0); }) == "DIV/0");
+    REQUIRE(message([&] { calc.reciprocal(2); }) == "N/A");
+    REQUIRE(message([&] { calc.isqrt(-1); }) == "N/A");
+}
+
+TEST_CASE("Batch checked ops mark failed lanes") {
+
+    // zeros scattered over two mask words
+    auto a = batchInputs(100, 50);
+    std::vector<int64_t> b = batchInputs(100, 51);
+    for (size_t i : { 0, 5, 63, 64, 99 }) b[i] = 0;
+    std::vector<int64_t> out(a.size());
+    std::vector<uint64_t> failed(2, ~0ULL);
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        Calculator ref;
+        ref.setWordSize(w);
+
+        REQUIRE(calc.tryDivide(a, b, out, failed) == 5);
+        for (size_t i = 0; i < a.size(); ++i) {
+            OpResult r = ref.tryDivide(a[i], b[i]);
+            REQUIRE(out[i] == r.value);
+            REQUIRE(bool((failed[i / 64] >> (i % 64)) & 1) == !r);
+        }
+        REQUIRE(failed[1] >> 36 == 0);
+
+        REQUIRE(calc.tryMod(a, b, out, failed) == 5);
+        for (size_t i = 0; i < a.size(); ++i) {
+            OpResult r = ref.tryMod(a[i], b[i]);
+            REQUIRE(out[i] == r.value);
+            REQUIRE(bool((failed[i / 64] >> (i % 64)) & 1) == !r);
+        }
+
+        calc.tryIsqrt(a, out, failed);
+        for (size_t i = 0; i < a.size(); ++i) {
+            OpResult r = ref.tryIsqrt(a[i]);
+            REQUIRE(out[i] == r.value);
+            REQUIRE(bool((failed[i / 64] >> (i % 64)) & 1) == !r);
+        }
+
+        REQUIRE(calc.tryReciprocal(b, out, {}) == 98);
+        REQUIRE_THROWS_AS(calc.divide(a, b, out), std::invalid_argument);
+    }
+
+    Calculator calc;
+    std::vector<uint64_t> tooShort(1);
+    REQUIRE_THROWS_AS(calc.tryDivide(a, b, out, tooShort), std::invalid_argument);
+}
+
+TEST_CASE("Batch ops leave the stored value alone") {
+
+    Calculator calc;
+    calc.add(0, 42);
+
+    std::vector<int64_t> a = { 1, 2, 3 };
+    std::vector<int64_t> out(3);
+    calc.add(a, a, out);
+
+    REQUIRE(out == std::vector<int64_t>{ 2, 4, 6 });
+    REQUIRE(calc.getValue() == 42);
+
+    std::vector<int64_t> shorter(2);
+    REQUIRE_THROWS_AS(calc.add(a, a, shorter), std::invalid_argument);
+}
+
+
+TEST_CASE("Batch divide by an invariant divisor matches scalar ops") {
+
+    auto a = batchInputs(301, 12);
+    for (int64_t v : std::vector<int64_t>{ INT64_MIN + 1, -2, 2, 100, -100, 0xFF, 0xFFFF, 0xFFFFFFFFLL })
+        a.push_back(v);
+    std::vector<int64_t> out(a.size());
+
+    // powers of two, both magic shapes, and the edges of every word size
+    std::vector<int64_t> divisors = { 1, -1, 2, -2, 3, -3, 5, 6, 7, -7, 10, 60, 64, -64, 100, 127, -128,
+                                      255, 641, 1000, 0x7FFF, -0x8000, 0xFFFF, 65537, INT32_MAX, INT32_MIN,
+                                      0xFFFFFFFFLL, 1000000007, 1LL << 62, INT64_MAX, INT64_MIN,
+                                      INT64_MIN + 1, -3037000499LL, 0x123456789ABCDEFLL };
+    std::mt19937_64 rng(13);
+    for (int i = 0; i < 40; ++i)
+        divisors.push_back(static_cast<int64_t>(rng() >> (rng() % 64)) * (i % 2 ? -1 : 1));
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        Calculator ref;
+        ref.setWordSize(w);
+        const int bits = static_cast<int>(w);
+        const uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        auto narrow = [&](uint64_t v) {
+            const uint64_t sign = 1ULL << (bits - 1);
+            return static_cast<int64_t>(((v & mask) ^ sign) - sign);
+        };
+
+        for (int64_t d : divisors) {
+            INFO("bits " << bits << " d " << d);
+            calc.divide(a, d, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.divide(a[i], d));
+            calc.mod(a, d, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.mod(a[i], d));
+
+            const uint64_t ud = static_cast<uint64_t>(d) & mask;
+            if (ud == 0) {
+                REQUIRE_THROWS_AS(calc.divideUnsigned(a, d, out), std::invalid_argument);
+                continue;
+            }
+            calc.divideUnsigned(a, d, out);
+            for (size_t i = 0; i < a.size(); ++i)
+                REQUIRE(out[i] == narrow((static_cast<uint64_t>(a[i]) & mask) / ud));
+            calc.modUnsigned(a, d, out);
+            for (size_t i = 0; i < a.size(); ++i)
+                REQUIRE(out[i] == narrow((static_cast<uint64_t>(a[i]) & mask) % ud));
+        }
+    }
+
+    Calculator calc;
+    REQUIRE_THROWS_AS(calc.divide(a, 0, out), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.mod(a, 0, out), std::invalid_argument);
+    std::vector<int64_t> small(3);
+    REQUIRE_THROWS_AS(calc.divide(a, 3, small), std::invalid_argument);
+
+    // modular mode divides by the inverse, as the span form does
+    calc.setModulus(97);
+    std::vector<int64_t> x = { 1, 2, 50, -5 }, q(4), expect(4);
+    calc.divide(x, 3, q);
+    calc.divide(x, std::vector<int64_t>(4, 3), expect);
+    REQUIRE(q == expect);
+}
+
+TEST_CASE("Batch kernels agree at every ISA level") {
+
+    auto a = batchInputs(77, 10);
+    auto b = batchInputs(77, 11);
+    const IsaLevel startLevel = activeIsa();
+
+    // every op at every word size, in one vector
+    auto runAll = [&] {
+        std::vector<int64_t> all, out(a.size());
+        auto keep = [&] { all.insert(all.end(), out.begin(), out.end()); };
+
+        for (WordSize w : allWordSizes) {
+            Calculator calc;
+            calc.setWordSize(w);
+
+            calc.add(a, b, out); keep();
+            calc.subtract(a, b, out); keep();
+            calc.multiply(a, b, out); keep();
+            calc.bitAnd(a, b, out); keep();
+            calc.bitOr(a, b, out); keep();
+            calc.bitXor(a, b, out); keep();
+            calc.bitNot(a, out); keep();
+            calc.pdep(a, b, out); keep();
+            calc.pext(a, b, out); keep();
+            for (int n : { 0, 1, 7, 13, 63 }) {
+                calc.shl(a, n, out); keep();
+                calc.shr(a, n, out); keep();
+                calc.rol(a, n, out); keep();
+                calc.ror(a, n, out); keep();
+            }
+            calc.popcount(a, out); keep();
+            calc.parity(a, out); keep();
+            calc.clz(a, out); keep();
+            calc.ctz(a, out); keep();
+            calc.highestBit(a, out); keep();
+            calc.lowestBit(a, out); keep();
+            calc.bswap(a, out); keep();
+            calc.bitReverse(a, out); keep();
+            calc.blsr(a, out); keep();
+            calc.blsi(a, out); keep();
+            for (int64_t d : std::vector<int64_t>{ 1, -1, 7, -10, 64, 255, 0x7FFF, 1000000007, INT64_MIN + 1 }) {
+                calc.divide(a, d, out); keep();
+                calc.mod(a, d, out); keep();
+                calc.divideUnsigned(a, d, out); keep();
+                calc.modUnsigned(a, d, out); keep();
+            }
+        }
+        return all;
+    };
+
+    setIsa(IsaLevel::Generic);
+    REQUIRE(activeIsa() == IsaLevel::Generic);
+    auto expect = runAll();
+
+    for (IsaLevel l : { IsaLevel::SSE2, IsaLevel::SSE42, IsaLevel::AVX2, IsaLevel::AVX512 }) {
+        if (l > detectedIsa()) {
+            REQUIRE_THROWS_AS(setIsa(l), std::invalid_argument);
+            continue;
+        }
+        setIsa(l);
+        INFO(isaName(l));
+        REQUIRE(runAll() == expect);
+    }
+
+    setIsa(startLevel);
+}
+
+TEST_CASE("ISA names") {
+
+    IsaLevel l = IsaLevel::Generic;
+    REQUIRE(parseIsa("avx2", l));
+    REQUIRE(l == IsaLevel::AVX2);
+    REQUIRE(std::string(isaName(IsaLevel::SSE42)) == "sse4.2");
+    REQUIRE_FALSE(parseIsa("avx3", l));
+    REQUIRE(l == IsaLevel::AVX2);
+    REQUIRE(activeIsa() <= detectedIsa());
+}
+
+
+// ================= COMPILE-TIME CORE =================
+
+static_assert(wordops::mask<WordSize::BYTE>() == 0xFF);
+static_assert(wordops::mask<WordSize::QWORD>() == ~0ULL);
+static_assert(wordops::add<WordSize::BYTE>(127, 1) == -128);
+static_assert(wordops::subtract<WordSize::WORD>(-32768, 1) == 32767);
+static_assert(wordops::multiply<WordSize::BYTE>(64, 2) == -128);
+static_assert(wordops::divide<WordSize::QWORD>(INT64_MIN, -1) == INT64_MIN);
+static_assert(wordops::mod<WordSize::QWORD>(INT64_MIN, -1) == 0);
+static_assert(wordops::bitNot<WordSize::BYTE>(0x55) == -86);
+static_assert(wordops::shl<WordSize::BYTE>(0x01, 7) == -128);
+static_assert(wordops::shl<WordSize::BYTE>(0x01, 8) == 0);
+static_assert(wordops::shr<WordSize::DWORD>(-1, 28) == 0xF);
+static_assert(wordops::rol<WordSize::BYTE>(0xC0, 1) == -127);
+static_assert(wordops::ror<WordSize::WORD>(0x0001, 1) == INT16_MIN);
+static_assert(wordops::rol<WordSize::QWORD>(INT64_MIN, 0) == INT64_MIN);
+
+template <WordSize W>
+static void checkCoreAgainstCalculator(const std::vector<int64_t>& v)
+{
+    Calculator calc;
+    calc.setWordSize(W);
+
+    for (int64_t a : v) {
+        for (int64_t b : v) {
+            REQUIRE(wordops::add<W>(a, b) == calc.add(a, b));
+            REQUIRE(wordops::subtract<W>(a, b) == calc.subtract(a, b));
+            REQUIRE(wordops::multiply<W>(a, b) == calc.multiply(a, b));
+            REQUIRE(wordops::bitAnd<W>(a, b) == calc.bitAnd(a, b));
+            REQUIRE(wordops::bitOr<W>(a, b) == calc.bitOr(a, b));
+            REQUIRE(wordops::bitXor<W>(a, b) == calc.bitXor(a, b));
+            if (b != 0) {
+                REQUIRE(wordops::divide<W>(a, b) == calc.divide(a, b));
+                REQUIRE(wordops::mod<W>(a, b) == calc.mod(a, b));
+            }
+        }
+        REQUIRE(wordops::bitNot<W>(a) == calc.bitNot(a));
+
+        for (int n = 0; n <= wordops::bits<W>; ++n) {
+            REQUIRE(wordops::shl<W>(a, n) == calc.shl(a, n));
+            REQUIRE(wordops::shr<W>(a, n) == calc.shr(a, n));
+            REQUIRE(wordops::rol<W>(a, n) == calc.rol(a, n));
+            REQUIRE(wordops::ror<W>(a, n) == calc.ror(a, n));
+        }
+    }
+}
+
+TEST_CASE("Templated core agrees with runtime dispatch") {
+
+    auto v = batchInputs(16, 4);
+
+    checkCoreAgainstCalculator<WordSize::BYTE>(v);
+    checkCoreAgainstCalculator<WordSize::WORD>(v);
+    checkCoreAgainstCalculator<WordSize::DWORD>(v);
+    checkCoreAgainstCalculator<WordSize::QWORD>(v);
+}
+
+TEST_CASE("Division wraps INT_MIN / -1") {
+
+    Calculator calc;
+
+    REQUIRE(calc.divide(INT64_MIN, -1) == INT64_MIN);
+    REQUIRE(calc.mod(INT64_MIN, -1) == 0);
+
+    calc.setWordSize(WordSize::BYTE);
+    REQUIRE(calc.divide(-128, -1) == -128);
+}
+
+
+// ================= BIT MANIPULATION =================
+
+static_assert(wordops::clz<WordSize::BYTE>(1) == 7);
+static_assert(wordops::clz<WordSize::QWORD>(0) == 64);
+static_assert(wordops::ctz<WordSize::WORD>(0) == 16);
+static_assert(wordops::popcount<WordSize::BYTE>(-1) == 8);
+static_assert(wordops::parity<WordSize::DWORD>(7) == 1);
+static_assert(wordops::highestBit<WordSize::BYTE>(-1) == 7);
+static_assert(wordops::highestBit<WordSize::BYTE>(0) == -1);
+static_assert(wordops::lowestBit<WordSize::QWORD>(0) == -1);
+static_assert(wordops::bswap<WordSize::WORD>(0x1234) == 0x3412);
+static_assert(wordops::bswap<WordSize::DWORD>(0x12345678) == 0x78563412);
+static_assert(wordops::bitReverse<WordSize::BYTE>(1) == -128);
+static_assert(wordops::pdep<WordSize::BYTE>(0b101, 0b11100) == 0b10100);
+static_assert(wordops::pext<WordSize::BYTE>(0b10100, 0b11100) == 0b101);
+static_assert(wordops::blsr<WordSize::BYTE>(0b1100) == 0b1000);
+static_assert(wordops::blsi<WordSize::BYTE>(0b1100) == 0b0100);
+
+// bit-at-a-time references on the W-bit pattern
+static uint64_t bitOf(int64_t v, int i) { return (static_cast<uint64_t>(v) >> i) & 1; }
+
+static int64_t refClz(int64_t v, int bits)
+{
+    int n = 0;
+    for (int i = bits - 1; i >= 0 && !bitOf(v, i); --i) ++n;
+    return n;
+}
+
+static int64_t refPopcount(int64_t v, int bits)
+{
+    int n = 0;
+    for (int i = 0; i < bits; ++i) n += static_cast<int>(bitOf(v, i));
+    return n;
+}
+
+static uint64_t refReverse(int64_t v, int bits, int unit)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < bits; ++i) {
+        int j = (bits / unit - 1 - i / unit) * unit + (unit == 1 ? 0 : i % unit);
+        r |= bitOf(v, i) << j;
+    }
+    return r;
+}
+
+static uint64_t refDeposit(int64_t v, int64_t m, int bits)
+{
+    uint64_t r = 0;
+    for (int i = 0, k = 0; i < bits; ++i)
+        if (bitOf(m, i)) r |= bitOf(v, k++) << i;
+    return r;
+}
+
+static uint64_t refExtract(int64_t v, int64_t m, int bits)
+{
+    uint64_t r = 0;
+    for (int i = 0, k = 0; i < bits; ++i)
+        if (bitOf(m, i)) r |= bitOf(v, i) << k++;
+    return r;
+}
+
+TEST_CASE("Bit manipulation respects the word size") {
+
+    auto v = batchInputs(64, 7);
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        int bits = static_cast<int>(w);
+        uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        auto narrow = [&](uint64_t x) { calc.setRaw(x); return calc.getValue(); };
+
+        for (int64_t a : v) {
+            int64_t pop = refPopcount(a, bits);
+            int64_t lead = refClz(a, bits);
+            int64_t trail = refClz(static_cast<int64_t>(refReverse(a, bits, 1)), bits);
+
+            REQUIRE(calc.popcount(a) == pop);
+            REQUIRE(calc.parity(a) == (pop & 1));
+            REQUIRE(calc.clz(a) == lead);
+            REQUIRE(calc.ctz(a) == trail);
+            REQUIRE(calc.highestBit(a) == bits - 1 - lead);
+            REQUIRE(calc.lowestBit(a) == (trail == bits ? -1 : trail));
+            REQUIRE(calc.bitReverse(a) == narrow(refReverse(a, bits, 1)));
+            REQUIRE(calc.bswap(a) == narrow(refReverse(a, bits, 8)));
+
+            uint64_t u = static_cast<uint64_t>(a) & mask;
+            REQUIRE(calc.blsr(a) == narrow(u & (u - 1)));
+            REQUIRE(calc.blsi(a) == narrow(u & (0 - u)));
+
+            for (int64_t m : v) {
+                REQUIRE(calc.pdep(a, m) == narrow(refDeposit(a, m, bits)));
+                REQUIRE(calc.pext(a, m) == narrow(refExtract(a, m, bits)));
+            }
+        }
+    }
+}
+
+TEST_CASE("Bit manipulation results are stored") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+    calc.setBase(NumberBase::HEX);
+
+    calc.bswap(0x12);
+    REQUIRE(calc.display() == "12");
+    calc.bitReverse(0x01);
+    REQUIRE(calc.display() == "80");
+    calc.highestBit(0);
+    REQUIRE(calc.getValue() == -1);
+
+    calc.setWordSize(WordSize::WORD);
+    calc.bswap(0x12);
+    REQUIRE(calc.display() == "1200");
+    calc.clz(0x12);
+    REQUIRE(calc.getValue() == 11);
+}
+
+TEST_CASE("Batch bit manipulation matches scalar ops") {
+
+    auto a = batchInputs(37, 8);
+    auto m = batchInputs(37, 9);
+    std::vector<int64_t> out(a.size());
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        Calculator ref;
+        ref.setWordSize(w);
+
+        calc.popcount(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.popcount(a[i]));
+
+        calc.parity(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.parity(a[i]));
+
+        calc.clz(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.clz(a[i]));
+
+        calc.ctz(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.ctz(a[i]));
+
+        calc.highestBit(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.highestBit(a[i]));
+
+        calc.lowestBit(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.lowestBit(a[i]));
+
+        calc.bswap(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.bswap(a[i]));
+
+        calc.bitReverse(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.bitReverse(a[i]));
+
+        calc.pdep(a, m, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.pdep(a[i], m[i]));
+
+        calc.pext(a, m, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.pext(a[i], m[i]));
+
+        calc.blsr(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.blsr(a[i]));
+
+        calc.blsi(a, out);
+        for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.blsi(a[i]));
+    }
+}
+
+
+// ================= FLAGS =================
+
+static_assert(wordops::adc<WordSize::BYTE>(127, 1, false).flags == flags::OF);
+static_assert(wordops::adc<WordSize::BYTE>(-1, 0, true).flags == flags::CF);
+static_assert(wordops::adc<WordSize::BYTE>(-128, -1, true).flags == flags::CF);
+static_assert(wordops::sbb<WordSize::WORD>(0, 1, false).value == -1);
+static_assert(wordops::sbb<WordSize::WORD>(0, 1, false).flags == flags::CF);
+static_assert(wordops::imul<WordSize::DWORD>(0x10000, 0x10000).flags == (flags::CF | flags::OF));
+static_assert(wordops::mulHiLo<WordSize::BYTE>(-1, -1).hi == -2);
+static_assert(wordops::imulHiLo<WordSize::BYTE>(-1, -1).hi == 0);
+static_assert(wordops::imulHiLo<WordSize::QWORD>(INT64_MIN, 2).hi == -1);
+
+// x86's flags for a result r of `bits` bits
+static uint32_t refStatus(int64_t r, int bits)
+{
+    uint64_t m = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    uint64_t u = static_cast<uint64_t>(r) & m;
+    uint32_t f = 0;
+    if (u == 0) f |= flags::ZF;
+    if ((u >> (bits - 1)) & 1) f |= flags::SF;
+    if (refPopcount(r, 8) % 2 == 0) f |= flags::PF;
+    return f;
+}
+
+TEST_CASE("Add and subtract set x86 flags") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+
+    calc.add(0x7F, 1);
+    REQUIRE(calc.getFlags() == (flags::OF | flags::SF));
+    calc.add(-1, 1);
+    REQUIRE(calc.getFlags() == (flags::CF | flags::ZF | flags::PF));
+    calc.subtract(0, 1);
+    REQUIRE(calc.getFlags() == (flags::CF | flags::SF | flags::PF));
+    calc.subtract(-128, 1);
+    REQUIRE(calc.getFlags() == flags::OF);
+
+    // every BYTE pair and carry against plain int arithmetic
+    for (int a = -128; a < 128; ++a) {
+        for (int b = -128; b < 128; ++b) {
+            for (int c = 0; c < 2; ++c) {
+                int ua = a & 0xFF, ub = b & 0xFF;
+
+                calc.setFlags(c ? flags::CF : 0);
+                int64_t r = calc.adc(a, b);
+                uint32_t expect = refStatus(r, 8) |
+                                  (ua + ub + c > 0xFF ? flags::CF : 0) |
+                                  (a + b + c != r ? flags::OF : 0);
+                REQUIRE(r == static_cast<int8_t>(a + b + c));
+                REQUIRE(calc.getFlags() == expect);
+
+                calc.setFlags(c ? flags::CF : 0);
+                r = calc.sbb(a, b);
+                expect = refStatus(r, 8) |
+                         (ua < ub + c ? flags::CF : 0) |
+                         (a - b - c != r ? flags::OF : 0);
+                REQUIRE(r == static_cast<int8_t>(a - b - c));
+                REQUIRE(calc.getFlags() == expect);
+            }
+        }
+    }
+}
+
+TEST_CASE("Other ops set x86 flags") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::WORD);
+
+    calc.multiply(0x100, 0x100);
+    REQUIRE(calc.getFlags() == (flags::CF | flags::OF | flags::ZF | flags::PF));
+    calc.multiply(-0x80, 0x100);
+    REQUIRE(calc.getFlags() == (flags::SF | flags::PF));
+
+    calc.divide(INT16_MIN, -1);
+    REQUIRE(calc.getValue() == INT16_MIN);
+    REQUIRE(calc.getFlags() == (flags::OF | flags::SF | flags::PF));
+    calc.divide(-6, -1);
+    REQUIRE(calc.getFlags() == flags::PF);
+
+    // the last bit out goes to CF
+    calc.shl(0x8001, 1);
+    REQUIRE(calc.getFlags() == flags::CF);
+    calc.shl(0x0001, 16);
+    REQUIRE(calc.getFlags() == (flags::CF | flags::ZF | flags::PF));
+    calc.shr(0x0003, 1);
+    REQUIRE(calc.getFlags() == flags::CF);
+    calc.shr(0x0002, 1);
+    REQUIRE(calc.getFlags() == 0);
+    calc.rol(0x8000, 1);
+    REQUIRE(calc.getFlags() == flags::CF);
+    calc.ror(0x0001, 1);
+    REQUIRE(calc.getFlags() == (flags::CF | flags::SF | flags::PF));
+
+    // logic clears CF and OF
+    calc.add(0x7FFF, 1);
+    calc.bitAnd(0x0F, 0x03);
+    REQUIRE(calc.getFlags() == flags::PF);
+    calc.bitXor(5, 5);
+    REQUIRE(calc.getFlags() == (flags::ZF | flags::PF));
+
+    calc.add(0x7FFF, 1);
+    calc.setValue(1);
+    REQUIRE(calc.getFlags() == 0);
+}
+
+TEST_CASE("ADC and SBB chain multi-word arithmetic") {
+
+    using u128 = unsigned __int128;
+    std::mt19937_64 rng(23);
+    Calculator calc;
+
+    for (int i = 0; i < 1000; ++i) {
+        uint64_t a[2] = { rng(), rng() }, b[2] = { rng(), rng() };
+        u128 x = (u128(a[1]) << 64) | a[0];
+        u128 y = (u128(b[1]) << 64) | b[0];
+
+        uint64_t lo = static_cast<uint64_t>(calc.add(a[0], b[0]));
+        uint64_t hi = static_cast<uint64_t>(calc.adc(a[1], b[1]));
+        REQUIRE(((u128(hi) << 64) | lo) == x + y);
+        REQUIRE(bool(calc.getFlags() & flags::CF) == (x + y < x));
+
+        lo = static_cast<uint64_t>(calc.subtract(a[0], b[0]));
+        hi = static_cast<uint64_t>(calc.sbb(a[1], b[1]));
+        REQUIRE(((u128(hi) << 64) | lo) == x - y);
+        REQUIRE(bool(calc.getFlags() & flags::CF) == (x < y));
+    }
+}
+
+TEST_CASE("MUL and IMUL give the whole product") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+
+    for (int a = -128; a < 128; ++a) {
+        for (int b = -128; b < 128; ++b) {
+            int u = (a & 0xFF) * (b & 0xFF);
+            HiLo p = calc.mulHiLo(a, b);
+            REQUIRE(p.hi == static_cast<int8_t>(u >> 8));
+            REQUIRE(p.lo == static_cast<int8_t>(u));
+            REQUIRE(calc.getValue() == p.lo);
+            REQUIRE(bool(calc.getFlags() & flags::CF) == (u > 0xFF));
+
+            p = calc.imulHiLo(a, b);
+            REQUIRE(p.hi == static_cast<int8_t>((a * b) >> 8));
+            REQUIRE(p.lo == static_cast<int8_t>(a * b));
+            REQUIRE(bool(calc.getFlags() & flags::OF) == (a * b != p.lo));
+        }
+    }
+
+    using i128 = __int128;
+    using u128 = unsigned __int128;
+    calc.setWordSize(WordSize::QWORD);
+    auto a = batchInputs(200, 30), b = batchInputs(200, 31);
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        u128 u = u128(uint64_t(a[i])) * uint64_t(b[i]);
+        HiLo p = calc.mulHiLo(a[i], b[i]);
+        REQUIRE(uint64_t(p.hi) == uint64_t(u >> 64));
+        REQUIRE(uint64_t(p.lo) == uint64_t(u));
+
+        i128 s = i128(a[i]) * b[i];
+        p = calc.imulHiLo(a[i], b[i]);
+        REQUIRE(p.hi == int64_t(s >> 64));
+        REQUIRE(p.lo == int64_t(s));
+        REQUIRE(bool(calc.getFlags() & flags::OF) == (s != p.lo));
+
+        calc.multiply(a[i], b[i]);
+        REQUIRE(bool(calc.getFlags() & flags::OF) == (s != p.lo));
+    }
+}
+
+TEST_CASE("Batch flag masks match the scalar flags") {
+
+    // long enough for two mask words and a tail
+    auto a = batchInputs(141, 40);
+    auto b = batchInputs(141, 41);
+    std::vector<int64_t> out(a.size());
+    std::vector<uint64_t> carry(3), overflow(3);
+    const IsaLevel startLevel = activeIsa();
+
+    auto check = [&](Calculator& ref, int64_t (Calculator::*op)(int64_t, int64_t)) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            REQUIRE(out[i] == (ref.*op)(a[i], b[i]));
+            uint32_t f = ref.getFlags();
+            REQUIRE(bool((carry[i / 64] >> (i % 64)) & 1) == bool(f & flags::CF));
+            REQUIRE(bool((overflow[i / 64] >> (i % 64)) & 1) == bool(f & flags::OF));
+        }
+        REQUIRE(carry[2] >> (a.size() % 64) == 0);
+        REQUIRE(overflow[2] >> (a.size() % 64) == 0);
+    };
+
+    for (IsaLevel l : { IsaLevel::Generic, IsaLevel::SSE2, IsaLevel::SSE42, IsaLevel::AVX2, IsaLevel::AVX512 }) {
+        if (l > detectedIsa())
+            continue;
+        setIsa(l);
+        INFO(isaName(l));
+
+        for (WordSize w : allWordSizes) {
+            Calculator calc;
+            calc.setWordSize(w);
+            Calculator ref;
+            ref.setWordSize(w);
+
+            calc.add(a, b, out, carry, overflow);
+            check(ref, &Calculator::add);
+            calc.subtract(a, b, out, carry, overflow);
+            check(ref, &Calculator::subtract);
+            calc.multiply(a, b, out, carry, overflow);
+            check(ref, &Calculator::multiply);
+        }
+    }
+    setIsa(startLevel);
+
+    Calculator calc;
+    std::vector<uint64_t> tooShort(2);
+    REQUIRE_THROWS_AS(calc.add(a, b, out, tooShort, overflow), std::invalid_argument);
+}
+
+
+// ================= ROOTS AND LOGARITHMS =================
+
+static_assert(wordops::isqrt64(0) == 0 && wordops::isqrt64(UINT64_MAX) == 0xFFFFFFFF);
+static_assert(wordops::icbrt64(UINT64_MAX) == 2642245 && wordops::icbrt64(7) == 1);
+static_assert(wordops::iroot64(UINT64_MAX, 63) == 2 && wordops::iroot64(1ULL << 63, 64) == 1);
+static_assert(wordops::ilog10_64(UINT64_MAX) == 19 && wordops::ilog10_64(9) == 0);
+static_assert(wordops::digits64(0, NumberBase::BIN) == 1 && wordops::digits64(255, NumberBase::OCT) == 3);
+
+// r^k <= n < (r + 1)^k, in 128 bits so (r + 1)^k cannot wrap
+static bool isRoot(uint64_t n, int k, uint64_t r)
+{
+    auto power = [k](uint64_t x) {
+        unsigned __int128 p = 1;
+        for (int i = 0; i < k && p <= UINT64_MAX; ++i)
+            p *= x;
+        return p;
+    };
+    return power(r) <= n && power(r + 1) > n;
+}
+
+static int refLog10(uint64_t n)
+{
+    int l = 0;
+    for (; n >= 10; n /= 10) ++l;
+    return l;
+}
+
+static int refDigits(uint64_t n, int radix)
+{
+    int d = 1;
+    for (; n >= static_cast<uint64_t>(radix); n /= radix) ++d;
+    return d;
+}
+
+TEST_CASE("Integer roots and logarithms are exact for every BYTE and WORD value") {
+
+    for (uint64_t n = 0; n <= 0xFFFF; ++n) {
+        REQUIRE(isRoot(n, 2, wordops::isqrt64(n)));
+        REQUIRE(isRoot(n, 3, wordops::icbrt64(n)));
+        for (int k = 1; k <= 17; ++k)
+            REQUIRE(isRoot(n, k, wordops::iroot64(n, k)));
+
+        if (n == 0)
+            continue;
+        REQUIRE(wordops::ilog2_64(n) == 63 - std::countl_zero(n));
+        REQUIRE(wordops::ilog10_64(n) == refLog10(n));
+        REQUIRE(wordops::digits64(n, NumberBase::BIN) == refDigits(n, 2));
+        REQUIRE(wordops::digits64(n, NumberBase::OCT) == refDigits(n, 8));
+        REQUIRE(wordops::digits64(n, NumberBase::DEC) == refDigits(n, 10));
+        REQUIRE(wordops::digits64(n, NumberBase::HEX) == refDigits(n, 16));
+    }
+
+    // signed BYTE through the Calculator: odd roots keep the sign
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+    for (int a = -128; a <= 127; ++a) {
+        uint64_t mag = static_cast<uint64_t>(a < 0 ? -a : a);
+        for (int k = 1; k <= 8; ++k) {
+            OpResult r = calc.tryIroot(a, k);
+            if (a < 0 && k % 2 == 0) {
+                REQUIRE(r.error == OpError::Domain);
+                continue;
+            }
+            int64_t root = static_cast<int64_t>(wordops::iroot64(mag, k));
+            REQUIRE(r.value == static_cast<int8_t>(a < 0 ? -root : root));
+        }
+        REQUIRE(calc.icbrt(a) == calc.iroot(a, 3));
+        REQUIRE(calc.tryIlog2(a).error == (a < 1 ? OpError::Domain : OpError::None));
+    }
+}
+
+TEST_CASE("Integer roots and logarithms hold on DWORD and QWORD samples") {
+
+    std::vector<uint64_t> values = { UINT64_MAX, UINT64_MAX - 1, 1ULL << 63, (1ULL << 63) - 1,
+                                     0xFFFFFFFF, 1ULL << 32 };
+    // the edges where float-based roots go wrong
+    for (uint64_t r : { 0xFFFFFFFFULL, 0xFFFFFFFEULL, 3037000499ULL, 65536ULL, 46341ULL })
+        for (uint64_t d : { 0ULL, 1ULL, ~0ULL })
+            values.push_back(r * r + d);
+    for (uint64_t r : { 2642245ULL, 2097152ULL, 1625ULL })
+        for (uint64_t d : { 0ULL, 1ULL, ~0ULL })
+            values.push_back(r * r * r + d);
+    for (uint64_t p = 1; p <= 1000000000000000000ULL; p *= 10) {
+        values.push_back(p);
+        values.push_back(p - 1);
+    }
+    std::mt19937_64 rng(17);
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t v = rng() >> (rng() % 64);
+        values.push_back(v);
+        values.push_back(v & 0xFFFFFFFF);
+    }
+
+    for (uint64_t n : values) {
+        INFO(n);
+        REQUIRE(isRoot(n, 2, wordops::isqrt64(n)));
+        REQUIRE(isRoot(n, 3, wordops::icbrt64(n)));
+        for (int k : { 4, 5, 7, 13, 40, 64, 65 })
+            REQUIRE(isRoot(n, k, wordops::iroot64(n, k)));
+
+        if (n == 0)
+            continue;
+        REQUIRE(wordops::ilog10_64(n) == refLog10(n));
+        REQUIRE(wordops::digits64(n, NumberBase::DEC) == static_cast<int>(std::to_string(n).size()));
+        REQUIRE(wordops::digits64(n, NumberBase::OCT) == refDigits(n, 8));
+    }
+}
+
+TEST_CASE("Roots and logarithms follow the word size") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::QWORD);
+    REQUIRE(calc.isqrt(INT64_MAX) == 3037000499);
+    REQUIRE(calc.icbrt(INT64_MIN) == -2097152);
+    REQUIRE(calc.iroot(-32, 5) == -2);
+    REQUIRE(calc.ilog2(INT64_MAX) == 62);
+    REQUIRE(calc.ilog10(INT64_MAX) == 18);
+    REQUIRE(calc.getValue() == 18);
+    REQUIRE_THROWS_AS(calc.iroot(-4, 2), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.iroot(4, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.ilog10(0), std::invalid_argument);
+    REQUIRE(calc.getValue() == 18);
+
+    // digitCount() is display() without the sign
+    for (WordSize w : allWordSizes) {
+        Calculator c;
+        c.setWordSize(w);
+        for (NumberBase b : { NumberBase::BIN, NumberBase::OCT, NumberBase::DEC, NumberBase::HEX }) {
+            c.setBase(b);
+            for (int64_t v : batchInputs(50, 60)) {
+                c.setValue(v);
+                std::string shown = c.display();
+                size_t sign = shown[0] == '-' ? 1 : 0;
+                REQUIRE(c.digitCount(v) == static_cast<int64_t>(shown.size() - sign));
+            }
+        }
+    }
+}
+
+TEST_CASE("Batch roots and logarithms match scalar ops") {
+
+    auto a = batchInputs(100, 61);
+    a[3] = 0;
+    std::vector<int64_t> out(a.size());
+    std::vector<uint64_t> failed(2);
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        calc.setBase(NumberBase::OCT);
+        Calculator ref(calc);
+
+        calc.icbrt(a, out);
+        for (size_t i = 0; i < a.size(); ++i)
+            REQUIRE(out[i] == ref.icbrt(a[i]));
+
+        calc.digitCount(a, out);
+        for (size_t i = 0; i < a.size(); ++i)
+            REQUIRE(out[i] == ref.digitCount(a[i]));
+
+        auto checkLanes = [&](auto&& scalar) {
+            for (size_t i = 0; i < a.size(); ++i) {
+                OpResult r = scalar(a[i]);
+                REQUIRE(out[i] == r.value);
+                REQUIRE(bool((failed[i / 64] >> (i % 64)) & 1) == !r);
+            }
+        };
+        calc.tryIroot(a, 4, out, failed);
+        checkLanes([&](int64_t v) { return ref.tryIroot(v, 4); });
+        calc.tryIlog2(a, out, failed);
+        checkLanes([&](int64_t v) { return ref.tryIlog2(v); });
+        calc.tryIlog10(a, out, failed);
+        checkLanes([&](int64_t v) { return ref.tryIlog10(v); });
+
+        REQUIRE_THROWS_AS(calc.ilog2(a, out), std::invalid_argument);
+        REQUIRE_NOTHROW(calc.iroot(a, 5, out));
+    }
+}
+
+
+// ================= POWERS =================
+
+static_assert(wordops::powMod64(2, 10, 1000) == 24);
+static_assert(wordops::powMod64(3, 0, 7) == 1 && wordops::powMod64(5, 3, 1) == 0);
+static_assert(wordops::Montgomery(0xFFFFFFFFFFFFFFC5).pow(2, 0xFFFFFFFFFFFFFFC4) == 1);
+static_assert(wordops::ipow<WordSize::BYTE>(2, 7).value == -128);
+static_assert(noexcept(std::declval<Calculator&>().tryPowmod(1, 1, 0)));
+
+// a^e mod m one multiply at a time, in 128 bits
+static uint64_t refPowMod(uint64_t a, uint64_t e, uint64_t m)
+{
+    unsigned __int128 r = 1 % m, b = a % m;
+    for (; e; e >>= 1) {
+        if (e & 1) r = r * b % m;
+        b = b * b % m;
+    }
+    return static_cast<uint64_t>(r);
+}
+
+TEST_CASE("Pow wraps like repeated multiplication") {
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        Calculator ref;
+        ref.setWordSize(w);
+
+        for (int64_t a : std::vector<int64_t>{ 0, 1, -1, 2, -2, 3, 7, -10, 127, -128, 255, 1000, -65536, INT64_MAX }) {
+            int64_t base = ref.add(0, a);
+            int64_t p = ref.add(0, 1);
+            __int128 exact = 1;
+            bool over = false;
+            for (int e = 0; e <= 70; ++e) {
+                INFO(a << "^" << e);
+                REQUIRE(calc.pow(base, e) == p);
+                bool fits = !over && exact == ref.add(0, static_cast<int64_t>(exact));
+                REQUIRE(bool(calc.getFlags() & flags::OF) == !fits);
+                REQUIRE(bool(calc.getFlags() & flags::CF) == !fits);
+
+                p = ref.multiply(p, base);
+                over |= __builtin_mul_overflow(exact, static_cast<__int128>(base), &exact);
+            }
+        }
+    }
+
+    Calculator calc;
+    REQUIRE(calc.pow(-1, -3) == -1);
+    REQUIRE(calc.pow(1, INT64_MIN) == 1);
+    REQUIRE(calc.tryPow(0, -1).error == OpError::DivideByZero);
+    REQUIRE(calc.tryPow(2, -1).error == OpError::Domain);
+    REQUIRE(calc.pow(0, 0) == 1);
+    REQUIRE(calc.pow(3, 40) == static_cast<int64_t>(12157665459056928801ULL));
+}
+
+TEST_CASE("Powmod is exact at every word size") {
+
+    std::mt19937_64 rng(18);
+    std::vector<uint64_t> moduli = { 1, 2, 3, 1ULL << 32, (1ULL << 61) - 1, 0xFFFFFFFBULL,
+                                     (1ULL << 63) - 25, 1ULL << 62, 1000000007, 998244352 };
+    for (int i = 0; i < 200; ++i)
+        moduli.push_back((rng() >> (rng() % 63)) | 1);
+    for (int i = 0; i < 50; ++i)
+        moduli.push_back(std::max<uint64_t>(rng() >> (1 + rng() % 62) & ~1ULL, 2));
+
+    for (uint64_t m : moduli) {
+        for (int i = 0; i < 20; ++i) {
+            uint64_t a = rng(), e = rng() >> (rng() % 64);
+            INFO(a << "^" << e << " mod " << m);
+            REQUIRE(wordops::powMod64(a, e, m) == refPowMod(a, e, m));
+        }
+    }
+
+    // Fermat: a^(p-1) = 1 mod p, also for p right below 2^64
+    for (uint64_t p : { 0xFFFFFFFFFFFFFFC5ULL, (1ULL << 61) - 1, 4294967291ULL })
+        for (uint64_t a : { 2ULL, 3ULL, 0x123456789ULL })
+            REQUIRE(wordops::powMod64(a, p - 1, p) == 1);
+
+    // signs: the base is taken mod |m|, the result is never negative
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        REQUIRE(calc.powmod(-2, 3, 5) == 2);
+        REQUIRE(calc.powmod(-2, 3, -5) == 2);
+        REQUIRE(calc.powmod(7, 0, 5) == 1);
+        REQUIRE(calc.powmod(7, 0, -1) == 0);
+        REQUIRE(calc.tryPowmod(2, -1, 5).error == OpError::Domain);
+        REQUIRE(calc.tryPowmod(2, 3, 0).error == OpError::DivideByZero);
+    }
+
+    // a residue past the positive range of the word wraps, like gcd
+    Calculator byte;
+    byte.setWordSize(WordSize::BYTE);
+    REQUIRE(byte.tryPowmod(7, 3, 200).value == -113);      // 343 mod 200 = 143
+    REQUIRE(byte.getValue() == -113);
+    REQUIRE((byte.getFlags() & (flags::CF | flags::OF)) == (flags::CF | flags::OF));
+    REQUIRE(byte.powmod(7, 3, 100) == 43);
+    REQUIRE((byte.getFlags() & (flags::CF | flags::OF)) == 0);
+
+    Calculator calc;
+    REQUIRE(calc.powmod(-1, 1, INT64_MIN) == INT64_MAX);
+    REQUIRE(calc.powmod(INT64_MIN, 1, 7) == 6);     // 2^63 = 1 mod 7
+    calc.pow(3, 40);    // sets OF, powmod clears it
+    REQUIRE(calc.powmod(INT64_MAX, INT64_MAX, INT64_MAX - 24) ==
+            static_cast<int64_t>(refPowMod(INT64_MAX, INT64_MAX, INT64_MAX - 24)));
+    REQUIRE((calc.getFlags() & (flags::CF | flags::OF)) == 0);
+}
+
+TEST_CASE("Batch pow and powmod match scalar ops") {
+
+    auto a = batchInputs(100, 70);
+    std::vector<int64_t> e(a.size());
+    std::mt19937_64 rng(71);
+    for (int64_t& x : e) x = static_cast<int64_t>(rng() % 80) - 5;
+    std::vector<int64_t> out(a.size());
+    std::vector<uint64_t> failed(2);
+
+    auto check = [&](auto&& scalar) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            OpResult r = scalar(a[i], e[i]);
+            REQUIRE(out[i] == r.value);
+            REQUIRE(bool((failed[i / 64] >> (i % 64)) & 1) == !r);
+        }
+    };
+
+    for (WordSize w : allWordSizes) {
+        Calculator calc;
+        calc.setWordSize(w);
+        Calculator ref(calc);
+
+        calc.tryPow(a, e, out, failed);
+        check([&](int64_t x, int64_t y) { return ref.tryPow(x, y); });
+
+        for (int64_t m : { int64_t(1000000007), int64_t(-97), int64_t(200), int64_t(1) << 40, INT64_MIN, int64_t(1), int64_t(0) }) {
+            calc.tryPowmod(a, e, m, out, failed);
+            check([&](int64_t x, int64_t y) { return ref.tryPowmod(x, y, m); });
+        }
+
+        REQUIRE_THROWS_AS(calc.powmod(a, e, 0, out), std::invalid_argument);
+        REQUIRE_THROWS_AS(calc.pow(a, e, out), std::invalid_argument);
+    }
+}
+
+
+// ================= MODULAR MODE =================
+
+static_assert(wordops::Barrett(1000000007).reduce(999, 0xFFFFFFFFFFFFFFFF) ==
+              static_cast<uint64_t>(((static_cast<unsigned __int128>(999) << 64) | 0xFFFFFFFFFFFFFFFF) % 1000000007));
+static_assert(wordops::Barrett(1).reduce(12345) == 0);
+
+// the least non-negative residue of a signed value
+static uint64_t refResidue(__int128 a, uint64_t m)
+{
+    __int128 r = a % m;
+    return static_cast<uint64_t>(r < 0 ? r + m : r);
+}
+
+TEST_CASE("Barrett reduction matches a 128-bit remainder") {
+
+    std::mt19937_64 rng(81);
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t m = rng() >> (rng() % 64);
+        if (i < 4) m = std::vector<uint64_t>{ 1, 2, 1ULL << 63, ~0ULL }[i];
+        if (m == 0) continue;
+
+        wordops::Barrett b(m);
+        uint64_t hi = rng() % m, lo = rng();
+        INFO(m << " " << hi << " " << lo);
+        REQUIRE(b.reduce(hi, lo) == static_cast<uint64_t>(((static_cast<unsigned __int128>(hi) << 64) | lo) % m));
+        REQUIRE(b.reduce(lo) == lo % m);
+    }
+}
+
+TEST_CASE("Modular mode reduces every arithmetic op") {
+
+    std::mt19937_64 rng(83);
+    std::vector<int64_t> values = { 0, 1, -1, 2, -2, 1000000006, INT64_MAX, INT64_MIN };
+    for (int i = 0; i < 40; ++i)
+        values.push_back(static_cast<int64_t>(rng() >> (rng() % 64)));
+
+    for (int64_t m : { int64_t(1000000007), int64_t(1) << 40, int64_t(97), int64_t(1), INT64_MAX }) {
+        Calculator calc;
+        calc.setModulus(m);
+        REQUIRE(calc.getModulus() == m);
+        uint64_t um = static_cast<uint64_t>(m);
+
+        for (int64_t a : values) {
+            for (int64_t b : values) {
+                INFO(a << " " << b << " mod " << m);
+                uint64_t ra = refResidue(a, um), rb = refResidue(b, um);
+                REQUIRE(calc.add(a, b) == static_cast<int64_t>((static_cast<unsigned __int128>(ra) + rb) % um));
+                REQUIRE(calc.subtract(a, b) == static_cast<int64_t>(refResidue(__int128(ra) - rb, um)));
+                REQUIRE(calc.multiply(a, b) == static_cast<int64_t>(static_cast<unsigned __int128>(ra) * rb % um));
+                REQUIRE((calc.getFlags() & (flags::CF | flags::OF)) == 0);
+
+                OpResult q = calc.tryDivide(a, b);
+                if (rb == 0) {
+                    REQUIRE(q.error == OpError::DivideByZero);
+                }
+                else if (std::gcd(rb, um) != 1) {
+                    REQUIRE(q.error == OpError::Domain);
+                }
+                else {
+                    REQUIRE(q);
+                    REQUIRE(static_cast<unsigned __int128>(q.value) * rb % um == ra);
+                }
+
+                uint64_t e = static_cast<uint64_t>(b) >> 1;
+                REQUIRE(calc.pow(a, static_cast<int64_t>(e)) == static_cast<int64_t>(refPowMod(ra, e, um)));
+            }
+        }
+    }
+}
+
+TEST_CASE("Modular mode at narrow words and with inverses") {
+
+    Calculator calc;
+    calc.setModulus(1000);
+
+    // a residue the word cannot hold wraps like any other result
+    calc.setWordSize(WordSize::BYTE);
+    REQUIRE(calc.add(100, 100) == static_cast<int8_t>(200));
+    REQUIRE((calc.getFlags() & (flags::CF | flags::OF)) == (flags::CF | flags::OF));
+    REQUIRE(calc.add(-1, 0) == static_cast<int8_t>(999 & 0xFF));
+    REQUIRE(calc.multiply(10, 11) == 110);
+    REQUIRE((calc.getFlags() & (flags::CF | flags::OF)) == 0);
+
+    // negative exponents raise the inverse
+    calc.setWordSize(WordSize::QWORD);
+    REQUIRE(calc.pow(3, -1) == 667);
+    REQUIRE(calc.tryPow(2, -1).error == OpError::Domain);
+    REQUIRE(calc.tryPow(1000, -1).error == OpError::DivideByZero);
+    REQUIRE(calc.divide(1, 3) == 667);
+    REQUIRE_THROWS_AS(calc.divide(1, 2), std::invalid_argument);
+    REQUIRE_THROWS_AS(calc.divide(1, 2000), std::invalid_argument);
+
+    // the batch form reports its first failing lane with the scalar message
+    auto message = [](auto fn) {
+        try { fn(); } catch (const std::invalid_argument& e) { return std::string(e.what()); }
+        return std::string();
+    };
+    std::vector<int64_t> a = { 1, 1, 1 }, out(3);
+    REQUIRE(message([&] { calc.divide(1, 2000); }) == "Division by zero");
+    REQUIRE(message([&] { calc.divide(a, std::vector<int64_t>{ 3, 2000, 2 }, out); }) == "Division by zero");
+    REQUIRE(message([&] { calc.divide(a, std::vector<int64_t>{ 3, 2, 2000 }, out); }) == "N/A");
+    REQUIRE(out[0] == 667);
+
+    calc.setModulus(0);
+    REQUIRE(calc.getModulus() == 0);
+    REQUIRE(calc.add(999, 1) == 1000);
+    REQUIRE_THROWS_AS(calc.setModulus(-5), std::invalid_argument);
+}
+
+TEST_CASE("Batch ops in modular mode match scalar ops") {
+
+    auto a = batchInputs(200, 84);
+    auto b = batchInputs(200, 85);
+    std::vector<int64_t> out(a.size());
+    std::vector<uint64_t> failed((a.size() + 63) / 64);
+
+    for (WordSize w : allWordSizes) {
+        for (int64_t m : { int64_t(1000000007), int64_t(1) << 40, int64_t(250) }) {
+            Calculator calc;
+            calc.setWordSize(w);
+            calc.setModulus(m);
+            Calculator ref(calc);
+            INFO(static_cast<int>(w) << " mod " << m);
+
+            calc.add(a, b, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.add(a[i], b[i]));
+            calc.subtract(a, b, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.subtract(a[i], b[i]));
+            calc.multiply(a, b, out);
+            for (size_t i = 0; i < a.size(); ++i) REQUIRE(out[i] == ref.multiply(a[i], b[i]));
+
+            size_t count = calc.tryDivide(a, b, out, failed);
+            size_t expected = 0;
+            for (size_t i = 0; i < a.size(); ++i) {
+                OpResult r = ref.tryDivide(a[i], b[i]);
+                expected += !r;
+                REQUIRE(out[i] == r.value);
+                REQUIRE(bool((failed[i / 64] >> (i % 64)) & 1) == !r);
+            }
+            REQUIRE(count == expected);
+        }
+    }
+}
+
+// ================= PARSING =================
+
+static std::u16string widen(std::string_view s)
+{
+    return std::u16string(s.begin(), s.end());
+}
+
+TEST_CASE("Parsing all bases") {
+
+    REQUIRE(parseNumber("1234567890", NumberBase::DEC, WordSize::QWORD).value == 1234567890);
+    REQUIRE(parseNumber("DeadBeef", NumberBase::HEX, WordSize::QWORD).value == 0xDEADBEEF);
+    REQUIRE(parseNumber("777", NumberBase::OCT, WordSize::QWORD).value == 0777);
+    REQUIRE(parseNumber("101", NumberBase::BIN, WordSize::QWORD).value == 5);
+    REQUIRE(parseNumber("-42", NumberBase::DEC, WordSize::QWORD).value == -42);
+
+    // prefixes, 0b and 0o are digits in hex
+    REQUIRE(parseNumber("0x1F", NumberBase::DEC, WordSize::QWORD).value == 31);
+    REQUIRE(parseNumber("0o17", NumberBase::DEC, WordSize::QWORD).value == 15);
+    REQUIRE(parseNumber("0b11", NumberBase::OCT, WordSize::QWORD).value == 3);
+    REQUIRE(parseNumber("0b11", NumberBase::HEX, WordSize::QWORD).value == 0xB11);
+
+    // long enough to take the eight-at-a-time path, plus a tail
+    REQUIRE(parseNumber("000000000000000000000000012345", NumberBase::DEC, WordSize::QWORD).value == 12345);
+    REQUIRE(parseNumber("123456789abcdef0", NumberBase::HEX, WordSize::QWORD).value == 0x123456789ABCDEF0);
+    REQUIRE(parseNumber("1234567012345670", NumberBase::OCT, WordSize::QWORD).value == 01234567012345670);
+    REQUIRE(parseNumber("1100110011110000", NumberBase::BIN, WordSize::QWORD).value == 0xCCF0);
+}
+
+TEST_CASE("Parsing accepts two's-complement patterns of the word size") {
+
+    REQUIRE(parseNumber("FF", NumberBase::HEX, WordSize::BYTE).value == -1);
+    REQUIRE(parseNumber("255", NumberBase::DEC, WordSize::BYTE).value == -1);
+    REQUIRE(parseNumber("-128", NumberBase::DEC, WordSize::BYTE).value == -128);
+    REQUIRE(parseNumber("-80", NumberBase::HEX, WordSize::BYTE).value == -128);
+    REQUIRE(parseNumber("-1000000000000000000000", NumberBase::OCT, WordSize::QWORD).value == INT64_MIN);
+    REQUIRE(parseNumber("8000", NumberBase::HEX, WordSize::WORD).value == INT16_MIN);
+    REQUIRE(parseNumber("18446744073709551615", NumberBase::DEC, WordSize::QWORD).value == -1);
+    REQUIRE(parseNumber("-9223372036854775808", NumberBase::DEC, WordSize::QWORD).value == INT64_MIN);
+}
+
+TEST_CASE("Parsing reports errors without throwing") {
+
+    REQUIRE(parseNumber("", NumberBase::DEC, WordSize::QWORD).error == ParseError::Empty);
+    REQUIRE(parseNumber("-", NumberBase::DEC, WordSize::QWORD).error == ParseError::Empty);
+    REQUIRE(parseNumber("0x", NumberBase::DEC, WordSize::QWORD).error == ParseError::Empty);
+
+    REQUIRE(parseNumber("12a", NumberBase::DEC, WordSize::QWORD).error == ParseError::InvalidDigit);
+    REQUIRE(parseNumber("8", NumberBase::OCT, WordSize::QWORD).error == ParseError::InvalidDigit);
+    REQUIRE(parseNumber("1012", NumberBase::BIN, WordSize::QWORD).error == ParseError::InvalidDigit);
+    REQUIRE(parseNumber("0123456G89", NumberBase::HEX, WordSize::QWORD).error == ParseError::InvalidDigit);
+    REQUIRE(parseNumber("1234 5678", NumberBase::DEC, WordSize::QWORD).error == ParseError::InvalidDigit);
+    REQUIRE(parseNumber("1234567\xC3\xA9", NumberBase::DEC, WordSize::QWORD).error == ParseError::InvalidDigit);
+
+    REQUIRE(parseNumber("256", NumberBase::DEC, WordSize::BYTE).error == ParseError::Overflow);
+    REQUIRE(parseNumber("-129", NumberBase::DEC, WordSize::BYTE).error == ParseError::Overflow);
+    REQUIRE(parseNumber("-FF", NumberBase::HEX, WordSize::BYTE).error == ParseError::Overflow);
+    REQUIRE(parseNumber("-81", NumberBase::HEX, WordSize::BYTE).error == ParseError::Overflow);
+    REQUIRE(parseNumber("100", NumberBase::HEX, WordSize::BYTE).error == ParseError::Overflow);
+    REQUIRE(parseNumber("10000000000000000", NumberBase::HEX, WordSize::QWORD).error == ParseError::Overflow);
+    REQUIRE(parseNumber("18446744073709551616", NumberBase::DEC, WordSize::QWORD).error == ParseError::Overflow);
+    REQUIRE(parseNumber("99999999999999999999999999", NumberBase::DEC, WordSize::QWORD).error == ParseError::Overflow);
+    REQUIRE(parseNumber("-9223372036854775809", NumberBase::DEC, WordSize::QWORD).error == ParseError::Overflow);
+
+    // every position of a bad character, in the wide and the tail loop
+    for (size_t i = 0; i < 20; ++i) {
+        std::string s(20, '7');
+        s[i] = '9';
+        REQUIRE(parseNumber(s, NumberBase::OCT, WordSize::QWORD).error == ParseError::InvalidDigit);
+        s[i] = '/';
+        REQUIRE(parseNumber(s, NumberBase::DEC, WordSize::QWORD).error == ParseError::InvalidDigit);
+        s[i] = 'g';
+        REQUIRE(parseNumber(s, NumberBase::HEX, WordSize::QWORD).error == ParseError::InvalidDigit);
+    }
+}
+
+TEST_CASE("Parsing UTF-16 text") {
+
+    REQUIRE(parseNumber(u"-12345678901", NumberBase::DEC, WordSize::QWORD).value == -12345678901);
+    REQUIRE(parseNumber(u"ffffffffffff", NumberBase::HEX, WordSize::QWORD).value == 0xFFFFFFFFFFFF);
+    REQUIRE(parseNumber(u"1234567\u0661", NumberBase::DEC, WordSize::QWORD).error == ParseError::InvalidDigit);
+    REQUIRE(parseNumber(u"12345678\u0130", NumberBase::HEX, WordSize::QWORD).error == ParseError::InvalidDigit);
+    REQUIRE(parseNumber(u"\u0131", NumberBase::HEX, WordSize::QWORD).error == ParseError::InvalidDigit);
+}
+
+TEST_CASE("Parsing reads back everything display() shows") {
+
+    Calculator calc;
+    std::mt19937_64 rng(17);
+
+    for (WordSize w : allWordSizes) {
+        calc.setWordSize(w);
+        for (NumberBase b : { NumberBase::DEC, NumberBase::BIN, NumberBase::OCT, NumberBase::HEX }) {
+            calc.setBase(b);
+            for (int i = 0; i < 500; ++i) {
+                calc.setValue(static_cast<int64_t>(rng() >> (rng() % 64)));
+                std::string s = calc.display();
+
+                ParseResult r = parseNumber(s, b, w);
+                REQUIRE(r);
+                REQUIRE(r.value == calc.getValue());
+
+                r = parseNumber(widen(s), b, w);
+                REQUIRE(r);
+                REQUIRE(r.value == calc.getValue());
+            }
+        }
+    }
+}
@@ -0,0 +1,238 @@
+#include "catch_amalgamated.hpp"
+#include "calculator.h"
+#include "divmagic.h"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+static const WordSize allWordSizes[] = {
+    WordSize::BYTE, WordSize::WORD, WordSize::DWORD, WordSize::QWORD
+};
+
+static uint64_t wordMask(int bits)
+{
+    return bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+}
+
+// the quotient's word bits by real division, MIN / -1 wrapping
+static uint64_t quotient(const DivisionMagic& m, uint64_t n)
+{
+    const uint64_t mask = wordMask(m.bits);
+    if (!m.isSigned)
+        return (n & mask) / static_cast<uint64_t>(m.divisor);
+    const uint64_t sign = 1ULL << (m.bits - 1);
+    const int64_t sn = static_cast<int64_t>(((n & mask) ^ sign) - sign);
+    if (m.divisor == -1)
+        return (0 - static_cast<uint64_t>(sn)) & mask;
+    return static_cast<uint64_t>(sn / m.divisor) & mask;
+}
+
+
+// ================= GENERATION =================
+
+TEST_CASE("Magic numbers match libdivide's") {
+
+    struct { int64_t d; WordSize w; bool isSigned; uint64_t multiplier; int shift; bool add; } known[] = {
+        { 7, WordSize::DWORD, false, 0x24924925, 2, true },
+        { 10, WordSize::DWORD, false, 0xCCCCCCCD, 3, false },
+        { 3, WordSize::DWORD, false, 0xAAAAAAAB, 1, false },
+        { 7, WordSize::DWORD, true, 0x92492493, 2, true },
+        { -7, WordSize::DWORD, true, 0x6DB6DB6D, 2, true },
+        { 3, WordSize::DWORD, true, 0xAAAAAAAB, 1, true },     // 0x55555556 >> 0 also works
+        { 10, WordSize::DWORD, true, 0x66666667, 2, false },
+        { 7, WordSize::QWORD, false, 0x2492492492492493, 2, true },
+        { 7, WordSize::QWORD, true, 0x4924924924924925, 1, false },
+        { 10, WordSize::BYTE, false, 0xCD, 3, false },
+        { 8, WordSize::WORD, true, 0, 3, false },
+        { -1, WordSize::QWORD, true, 0, 0, false },
+    };
+    for (const auto& k : known) {
+        INFO(k.d << " at " << static_cast<int>(k.w) << (k.isSigned ? " signed" : " unsigned"));
+        DivisionMagic m = divmagic::compute(k.d, k.w, k.isSigned);
+        REQUIRE(m.multiplier == k.multiplier);
+        REQUIRE(m.shift == k.shift);
+        REQUIRE(m.add == k.add);
+        REQUIRE(m.tested == 0);
+    }
+
+    // the divisor is narrowed to the word first
+    REQUIRE(divmagic::compute(0x107, WordSize::BYTE, false).divisor == 7);
+    REQUIRE(divmagic::compute(0xF9, WordSize::BYTE, true).divisor == -7);
+    REQUIRE(divmagic::compute(-7, WordSize::BYTE, false).divisor == 0xF9);
+    REQUIRE_THROWS_AS(divmagic::compute(0x100, WordSize::BYTE, true), std::invalid_argument);
+    REQUIRE_THROWS_AS(divmagic::compute(0, WordSize::QWORD, false), std::invalid_argument);
+}
+
+TEST_CASE("Magic sequences divide every BYTE and WORD dividend") {
+
+    // every BYTE divisor
+    for (bool isSigned : { false, true }) {
+        for (int64_t d = 1; d < 256; ++d) {
+            DivisionMagic m = divmagic::compute(d, WordSize::BYTE, isSigned);
+            divmagic::verify(m);
+            INFO(m.divisor << (isSigned ? " signed" : " unsigned"));
+            REQUIRE(m.exhaustive);
+            REQUIRE(m.tested == 256);
+            REQUIRE(m.failures == 0);
+            for (uint64_t n = 0; n < 256; ++n)
+                REQUIRE(divmagic::apply(m, n) == quotient(m, n));
+        }
+    }
+
+    std::vector<int64_t> divisors;
+    for (int64_t d = 1; d < 200; ++d) {
+        divisors.push_back(d);
+        divisors.push_back(-d);
+    }
+    for (int64_t d : { 641, 1000, 0x7FFF, -0x7FFF, -0x8000, 0x8000, 0xFFFF, 0xFFFE, 12345 })
+        divisors.push_back(d);
+    for (bool isSigned : { false, true }) {
+        for (int64_t d : divisors) {
+            DivisionMagic m = divmagic::compute(d, WordSize::WORD, isSigned);
+            divmagic::verify(m, 2);
+            INFO(m.divisor << (isSigned ? " signed" : " unsigned"));
+            REQUIRE(m.tested == 65536);
+            REQUIRE(m.failures == 0);
+        }
+    }
+}
+
+TEST_CASE("Magic sequences at DWORD and QWORD against division") {
+
+    std::mt19937_64 rng(41);
+    std::vector<int64_t> divisors = { 1, -1, 3, -3, 5, 7, -7, 10, 641, 1000000007, -1000000007,
+                                      INT32_MAX, INT32_MIN, 0xFFFFFFFFLL, INT64_MAX, INT64_MIN,
+                                      INT64_MIN + 1, -3037000499LL, 1LL << 40 };
+    for (int i = 0; i < 100; ++i)
+        divisors.push_back(static_cast<int64_t>(rng() >> (rng() % 64)) * (i % 2 ? -1 : 1));
+
+    for (WordSize w : { WordSize::DWORD, WordSize::QWORD }) {
+        for (bool isSigned : { false, true }) {
+            for (int64_t d : divisors) {
+                DivisionMagic m;
+                try {
+                    m = divmagic::compute(d, w, isSigned);
+                }
+                catch (const std::invalid_argument&) {
+                    continue;   // 0 in the word
+                }
+                INFO(m.divisor << " at " << m.bits << (isSigned ? " signed" : " unsigned"));
+                for (int i = 0; i < 2000; ++i) {
+                    uint64_t n = i < 100 ? static_cast<uint64_t>(i - 50) : rng() >> (rng() % 64);
+                    REQUIRE(divmagic::apply(m, n) == quotient(m, n));
+                }
+            }
+        }
+    }
+
+    // QWORD verification is sampled
+    DivisionMagic m = divmagic::compute(7, WordSize::QWORD, true);
+    divmagic::verify(m, 0, 10000);
+    REQUIRE_FALSE(m.exhaustive);
+    REQUIRE(m.tested > 10000);
+    REQUIRE(m.failures == 0);
+}
+
+TEST_CASE("Verification catches a wrong magic") {
+
+    for (WordSize w : allWordSizes) {
+        if (w == WordSize::DWORD)
+            continue;   // 2^32 dividends, see the hidden test below
+        DivisionMagic m = divmagic::compute(7, w, false);
+        m.multiplier -= 1;
+        divmagic::verify(m, 0, 10000);
+        INFO(static_cast<int>(w));
+        REQUIRE(m.failures > 0);
+        REQUIRE(divmagic::apply(m, m.firstFailure) != quotient(m, m.firstFailure));
+    }
+
+    // the first failure of an exhaustive check is the smallest
+    DivisionMagic m = divmagic::compute(7, WordSize::WORD, false);
+    m.multiplier -= 1;
+    divmagic::verify(m, 3);
+    uint64_t first = 0;
+    while (divmagic::apply(m, first) == quotient(m, first))
+        ++first;
+    REQUIRE(m.firstFailure == first);
+}
+
+// ================= CALCULATOR AND C OUTPUT =================
+
+TEST_CASE("Calculator divisionMagic") {
+
+    Calculator c;
+    c.setWordSize(WordSize::WORD);
+    c.setValue(42);
+
+    DivisionMagic m = c.divisionMagic(10, false);
+    REQUIRE(m.bits == 16);
+    REQUIRE(m.multiplier == 0xCCCD);
+    REQUIRE(m.shift == 3);
+    REQUIRE(m.exhaustive);
+    REQUIRE(m.tested == 65536);
+    REQUIRE(m.failures == 0);
+    REQUIRE(c.getValue() == 42);
+
+    REQUIRE_THROWS_AS(c.divisionMagic(0, true), std::invalid_argument);
+    REQUIRE_THROWS_AS(c.divisionMagic(0x10000, false), std::invalid_argument);
+
+    c.setWordSize(WordSize::QWORD);
+    m = c.divisionMagic(-7, true);
+    REQUIRE(m.divisor == -7);
+    REQUIRE_FALSE(m.exhaustive);
+    REQUIRE(m.failures == 0);
+
+    c.setWordBits(128);
+    REQUIRE_THROWS_AS(c.divisionMagic(7, true), std::invalid_argument);
+}
+
+TEST_CASE("divisionMagic as C") {
+
+    DivisionMagic m = divmagic::compute(7, WordSize::DWORD, false);
+    std::string c = divmagic::toC(m);
+    REQUIRE(c.find("static inline uint32_t div_u32_7(uint32_t x)") != std::string::npos);
+    REQUIRE(c.find("multiplier 0x24924925, shift 2, add 1") != std::string::npos);
+    REQUIRE(c.find("((uint64_t)x * 0x24924925u) >> 32") != std::string::npos);
+    REQUIRE(c.find("Not verified") != std::string::npos);
+
+    m = divmagic::compute(-7, WordSize::WORD, true);
+    divmagic::verify(m);
+    c = divmagic::toC(m);
+    REQUIRE(c.find("static inline int16_t div_s16_m7(int16_t x)") != std::string::npos);
+    REQUIRE(c.find("Matches division for all 65536 dividends") != std::string::npos);
+
+    // a negative divisor with the add indicator subtracts x
+    m = divmagic::compute(-7, WordSize::DWORD, true);
+    REQUIRE(divmagic::toC(m).find("(uint32_t)q - (uint32_t)x") != std::string::npos);
+
+    m = divmagic::compute(8, WordSize::QWORD, false);
+    REQUIRE(divmagic::toC(m).find("return x >> 3;") != std::string::npos);
+
+    m = divmagic::compute(7, WordSize::BYTE, false);
+    m.multiplier -= 1;
+    divmagic::verify(m);
+    REQUIRE(divmagic::toC(m).find("WRONG for") != std::string::npos);
+}
+
+// seconds per divisor on one core, so hidden: run it with "[divmagic]"
+TEST_CASE("divisionMagic checks every DWORD dividend", "[.][divmagic]") {
+
+    for (int64_t d : { 7, -7, 10, 641 }) {
+        for (bool isSigned : { false, true }) {
+            DivisionMagic m = divmagic::compute(d, WordSize::DWORD, isSigned);
+            divmagic::verify(m);
+            INFO(m.divisor << (isSigned ? " signed" : " unsigned"));
+            REQUIRE(m.tested == 1ULL << 32);
+            REQUIRE(m.failures == 0);
+        }
+    }
+
+    DivisionMagic m = divmagic::compute(7, WordSize::DWORD, false);
+    m.multiplier -= 1;
+    divmagic::verify(m);
+    REQUIRE(m.failures > 0);
+}
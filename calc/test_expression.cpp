@@ -0,0 +1,149 @@
+#include "catch_amalgamated.hpp"
+#include "expression.h"
+
+#include <stdexcept>
+#include <string>
+
+
+static int64_t eval(const char* text, WordSize w = WordSize::QWORD,
+                    NumberBase b = NumberBase::DEC, int64_t x = 0)
+{
+    return Expression::compile(text, b).evaluate(w, x);
+}
+
+
+// ================= PRECEDENCE =================
+
+TEST_CASE("Arithmetic precedence") {
+
+    REQUIRE(eval("2 + 3 * 4") == 14);
+    REQUIRE(eval("(2 + 3) * 4") == 20);
+    REQUIRE(eval("10 - 4 - 3") == 3);
+    REQUIRE(eval("100 / 10 / 5") == 2);
+    REQUIRE(eval("17 % 5 * 2") == 4);
+    REQUIRE(eval("17 Mod 5") == 2);
+}
+
+TEST_CASE("Bitwise precedence follows C") {
+
+    REQUIRE(eval("1 | 2 ^ 3 & 4") == (1 | (2 ^ (3 & 4))));
+    REQUIRE(eval("1 << 2 + 1") == 8);
+    REQUIRE(eval("0xFF & 0x0F << 4") == 0xF0);
+    REQUIRE(eval("6 And 3 Or 8") == 10);
+    REQUIRE(eval("6 Xor 3") == 5);
+    REQUIRE(eval("1 Lsh 4 Rsh 2") == 4);
+}
+
+TEST_CASE("Unary operators") {
+
+    REQUIRE(eval("-5 + 3") == -2);
+    REQUIRE(eval("--5") == 5);
+    REQUIRE(eval("+7") == 7);
+    REQUIRE(eval("~0") == -1);
+    REQUIRE(eval("Not 0", WordSize::BYTE) == -1);
+    REQUIRE(eval("√16 + 1") == 5);
+    REQUIRE(eval("sqrt(99)") == 9);
+    REQUIRE(eval("-(2 * 3)") == -6);
+}
+
+
+// ================= WORD SIZE =================
+
+TEST_CASE("Expressions wrap at the word size like Calculator") {
+
+    REQUIRE(eval("127 + 1", WordSize::BYTE) == -128);
+    REQUIRE(eval("64 * 2", WordSize::BYTE) == -128);
+    REQUIRE(eval("0xFF", WordSize::BYTE) == -1);
+    REQUIRE(eval("0x80 RoL 1", WordSize::BYTE) == 1);
+    REQUIRE(eval("1 RoR 1", WordSize::WORD) == INT16_MIN);
+    REQUIRE(eval("1 << 8", WordSize::BYTE) == 0);
+    REQUIRE(eval("1 << 100") == 0);
+    REQUIRE(eval("0xFFFFFFFFFFFFFFFF") == -1);
+
+    // same as Calculator: operands are not narrowed before the op
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+    REQUIRE(eval("300 / 7", WordSize::BYTE) == calc.divide(300, 7));
+}
+
+TEST_CASE("Evaluation stores the result in the calculator") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::DWORD);
+
+    auto e = Expression::compile("x * x - 1");
+    REQUIRE(e.evaluate(calc, 0x10000) == -1);
+    REQUIRE(calc.getValue() == -1);
+    REQUIRE(calc.getRaw() == 0xFFFFFFFF);
+}
+
+
+// ================= BASES =================
+
+TEST_CASE("Numbers in the current base and with prefixes") {
+
+    REQUIRE(eval("FF + 1", WordSize::QWORD, NumberBase::HEX) == 0x100);
+    REQUIRE(eval("ADD", WordSize::QWORD, NumberBase::HEX) == 0xADD);
+    REQUIRE(eval("0b1B", WordSize::QWORD, NumberBase::HEX) == 0xB1B);
+    REQUIRE(eval("17", WordSize::QWORD, NumberBase::OCT) == 15);
+    REQUIRE(eval("1010", WordSize::QWORD, NumberBase::BIN) == 10);
+    REQUIRE(eval("0x10 + 0b11 + 0o7") == 26);
+
+    REQUIRE_THROWS_AS(Expression::compile("2", NumberBase::BIN), std::invalid_argument);
+    REQUIRE_THROWS_AS(Expression::compile("FF"), std::invalid_argument);
+}
+
+
+// ================= VARIABLE =================
+
+TEST_CASE("One compiled formula over many inputs") {
+
+    auto e = Expression::compile("(x ^ 0x5A) RoL 3 & 0xFF");
+    REQUIRE(e.usesX());
+
+    Calculator calc;
+    calc.setWordSize(WordSize::BYTE);
+
+    for (int64_t x = -128; x < 128; ++x) {
+        int64_t expect = calc.bitAnd(calc.rol(calc.bitXor(x, 0x5A), 3), 0xFF);
+        REQUIRE(e.evaluate(WordSize::BYTE, x) == expect);
+    }
+
+    REQUIRE_FALSE(Expression::compile("1 + 2").usesX());
+}
+
+
+// ================= ERRORS =================
+
+TEST_CASE("Syntax errors") {
+
+    const char* bad[] = { "", "1 +", "(1", "1)", "* 2", "1 2", "foo", "1 < 2", "0x" };
+
+    for (const char* t : bad)
+        REQUIRE_THROWS_AS(Expression::compile(t), std::invalid_argument);
+
+    REQUIRE_THROWS_AS(Expression::compile("99999999999999999999"), std::invalid_argument);
+}
+
+TEST_CASE("Runtime errors") {
+
+    REQUIRE_THROWS_AS(eval("1 / 0"), std::invalid_argument);
+    REQUIRE_THROWS_AS(eval("1 % (2 - 2)"), std::invalid_argument);
+    REQUIRE_THROWS_AS(eval("√-4"), std::invalid_argument);
+    REQUIRE_THROWS_AS(eval("1 / x", WordSize::QWORD, NumberBase::DEC, 0), std::invalid_argument);
+}
+
+TEST_CASE("Stack depth is bounded") {
+
+    std::string deep = "1";
+    for (int i = 0; i < 40; ++i)
+        deep = "1 + (" + deep + ")";
+    REQUIRE(eval(deep.c_str()) == 41);
+
+    std::string tooDeep;
+    for (int i = 0; i < Expression::maxStack + 1; ++i)
+        tooDeep += "1 + (";
+    tooDeep += "1";
+    tooDeep += std::string(Expression::maxStack + 1, ')');
+    REQUIRE_THROWS_AS(Expression::compile(tooDeep), std::invalid_argument);
+}
@@ -0,0 +1,335 @@
+#include "catch_amalgamated.hpp"
+#include "bigword.h"
+#include "format.h"
+#include "isa.h"
+#include "wordops.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+
+// the original prepend-one-char formatting, as reference and baseline
+static std::string legacyDisplay(uint64_t raw, WordSize w, NumberBase b)
+{
+    const WordOps& ops = wordOpsFor(w);
+    uint64_t v = raw & ops.mask;
+
+    if (b == NumberBase::DEC)
+        return std::to_string(ops.signExtend(v));
+    if (v == 0)
+        return "0";
+
+    int shift = b == NumberBase::BIN ? 1 : b == NumberBase::OCT ? 3 : 4;
+    const char* d = "0123456789ABCDEF";
+    std::string r;
+    while (v) {
+        r = d[v & ((1u << shift) - 1)] + r;
+        v >>= shift;
+    }
+    return r;
+}
+
+static const WordSize formatWordSizes[] = {
+    WordSize::BYTE, WordSize::WORD, WordSize::DWORD, WordSize::QWORD
+};
+
+static const NumberBase formatBases[] = {
+    NumberBase::DEC, NumberBase::BIN, NumberBase::OCT, NumberBase::HEX
+};
+
+static std::vector<uint64_t> formatSamples()
+{
+    std::vector<uint64_t> v;
+    for (int i = 0; i < 64; ++i) {
+        v.push_back(1ULL << i);
+        v.push_back((1ULL << i) - 1);
+        v.push_back(~0ULL << i);
+    }
+    for (uint64_t p = 1; p < 10000000000000000000ULL; p *= 10) {
+        v.push_back(p);
+        v.push_back(p - 1);
+    }
+    std::mt19937_64 rng(11);
+    for (int i = 0; i < 2000; ++i)
+        v.push_back(rng() >> (rng() % 64));
+    return v;
+}
+
+
+TEST_CASE("formatValue matches the original display()") {
+
+    DisplayBuffer buf;
+
+    for (uint64_t raw : formatSamples())
+        for (WordSize w : formatWordSizes)
+            for (NumberBase b : formatBases) {
+                size_t n = formatValue(buf.data(), raw, w, b);
+                REQUIRE(n <= maxDisplayLength);
+                REQUIRE(std::string(buf.data(), n) == legacyDisplay(raw, w, b));
+            }
+}
+
+TEST_CASE("Longest outputs fit the display buffer") {
+
+    DisplayBuffer buf;
+
+    REQUIRE(formatValue(buf.data(), ~0ULL, WordSize::QWORD, NumberBase::BIN) == 64);
+    REQUIRE(formatValue(buf.data(), 1ULL << 63, WordSize::QWORD, NumberBase::DEC) == 20);
+    REQUIRE(std::string(buf.data(), 20) == "-9223372036854775808");
+}
+
+TEST_CASE("display() into a caller buffer") {
+
+    Calculator calc;
+    calc.setWordSize(WordSize::WORD);
+    calc.setBase(NumberBase::HEX);
+    calc.setValue(-2);
+
+    DisplayBuffer buf;
+    std::string_view s = calc.display(buf);
+
+    REQUIRE(s == "FFFE");
+    REQUIRE(buf[s.size()] == '\0');
+    REQUIRE(calc.display() == "FFFE");
+}
+
+
+// ================= BULK =================
+
+TEST_CASE("Bulk formatting matches display() byte for byte") {
+
+    auto samples = formatSamples();
+    std::vector<int64_t> values(samples.begin(), samples.end());
+
+    for (WordSize w : formatWordSizes) {
+        for (NumberBase b : formatBases) {
+            Calculator calc;
+            calc.setWordSize(w);
+            calc.setBase(b);
+
+            std::string expect;
+            for (int64_t v : values) {
+                calc.setRaw(static_cast<uint64_t>(v));
+                expect += calc.display();
+                expect += '\n';
+            }
+
+            BulkFormat f;
+            f.base = b;
+            f.wordSize = w;
+            REQUIRE(formatBulk(values, f) == expect);
+        }
+    }
+}
+
+TEST_CASE("Bulk formatting pads to the word size") {
+
+    std::vector<int64_t> values = { 0, 1, 0xAB, -1 };
+
+    BulkFormat f;
+    f.pad = true;
+    f.separator = ' ';
+    f.wordSize = WordSize::WORD;
+
+    f.base = NumberBase::HEX;
+    REQUIRE(formatBulk(values, f) == "0000 0001 00AB FFFF ");
+
+    f.base = NumberBase::OCT;
+    REQUIRE(formatBulk(values, f) == "000000 000001 000253 177777 ");
+
+    f.base = NumberBase::BIN;
+    f.wordSize = WordSize::BYTE;
+    REQUIRE(formatBulk(values, f) == "00000000 00000001 10101011 11111111 ");
+
+    f.base = NumberBase::DEC;
+    REQUIRE(formatBulk(values, f) == "0 1 -85 -1 ");
+
+    f.base = NumberBase::HEX;
+    f.wordSize = WordSize::QWORD;
+    REQUIRE(formatBulk(std::vector<int64_t>{ 0x1234 }, f) == "0000000000001234 ");
+    REQUIRE(formatBulk(std::vector<int64_t>{}, f).empty());
+}
+
+TEST_CASE("Bulk formatting is the same at every ISA level") {
+
+    auto samples = formatSamples();
+    std::vector<int64_t> values(samples.begin(), samples.end());
+    const IsaLevel startLevel = activeIsa();
+
+    auto runAll = [&] {
+        std::string all;
+        for (WordSize w : formatWordSizes)
+            for (NumberBase b : formatBases)
+                for (bool pad : { false, true }) {
+                    BulkFormat f;
+                    f.base = b;
+                    f.wordSize = w;
+                    f.pad = pad;
+                    all += formatBulk(values, f);
+                }
+        return all;
+    };
+
+    setIsa(IsaLevel::Generic);
+    std::string expect = runAll();
+
+    for (IsaLevel l : { IsaLevel::SSE2, IsaLevel::SSE42, IsaLevel::AVX2, IsaLevel::AVX512 }) {
+        if (l > detectedIsa()) continue;
+        setIsa(l);
+        INFO(isaName(l));
+        REQUIRE(runAll() == expect);
+    }
+
+    setIsa(startLevel);
+}
+
+
+// ================= ALL BASES =================
+
+TEST_CASE("BaseTexts match display() in every base") {
+
+    BaseTexts texts;
+    for (WordSize w : formatWordSizes) {
+        for (uint64_t v : formatSamples()) {
+            Calculator calc;
+            calc.setWordSize(w);
+            calc.setRaw(v);
+            texts.set(calc);
+            for (NumberBase b : formatBases) {
+                calc.setBase(b);
+                REQUIRE(texts.text(b) == calc.display());
+            }
+        }
+    }
+
+    Calculator calc;
+    calc.setWordBits(256);
+    calc.setWide(bigword::shl(BigWord(-3, 256), 100));
+    texts.set(calc);
+    for (NumberBase b : formatBases) {
+        calc.setBase(b);
+        REQUIRE(texts.text(b) == calc.display());
+    }
+}
+
+TEST_CASE("BaseTexts format only what changed") {
+
+    BaseTexts texts;
+    texts.set(0x1F, WordSize::BYTE);
+    REQUIRE(texts.formats() == 0);
+    REQUIRE(texts.text(NumberBase::HEX) == "1F");
+    REQUIRE(texts.text(NumberBase::DEC) == "31");
+    REQUIRE(texts.formats() == 2);
+
+    // the same value, also with bits above the word, is a cache hit
+    REQUIRE_FALSE(texts.set(0x1F, WordSize::BYTE));
+    REQUIRE_FALSE(texts.set(0x71F, WordSize::BYTE));
+    REQUIRE(texts.text(NumberBase::HEX) == "1F");
+    REQUIRE(texts.text(NumberBase::DEC) == "31");
+    REQUIRE(texts.formats() == 2);
+
+    // a new value or a new width formats again
+    REQUIRE(texts.set(0x20, WordSize::BYTE));
+    REQUIRE(texts.text(NumberBase::HEX) == "20");
+    REQUIRE(texts.formats() == 3);
+    texts.set(0x20, WordSize::WORD);
+    REQUIRE(texts.text(NumberBase::HEX) == "20");
+    REQUIRE(texts.formats() == 4);
+    texts.set(0xFF, WordSize::BYTE);
+    REQUIRE(texts.text(NumberBase::DEC) == "-1");
+    texts.set(0xFF, WordSize::WORD);
+    REQUIRE(texts.text(NumberBase::DEC) == "255");
+    REQUIRE(texts.formats() == 6);
+
+    // wide values compare by limbs and width
+    BigWord v = bigword::shl(BigWord(1, 128), 64);
+    texts.set(v);
+    REQUIRE(texts.text(NumberBase::HEX) == "10000000000000000");
+    REQUIRE_FALSE(texts.set(bigword::shl(BigWord(1, 128), 64)));
+    REQUIRE(texts.text(NumberBase::HEX) == "10000000000000000");
+    REQUIRE(texts.formats() == 7);
+    REQUIRE(texts.set(v.resized(192)));
+    REQUIRE(texts.text(NumberBase::HEX) == "10000000000000000");
+    REQUIRE(texts.formats() == 8);
+    texts.set(1, WordSize::QWORD);
+    REQUIRE(texts.text(NumberBase::HEX) == "1");
+    REQUIRE(texts.formats() == 9);
+    REQUIRE(texts.changes() == 8);
+}
+
+TEST_CASE("BaseTexts group binary by nibbles") {
+
+    BaseTexts texts;
+    texts.set(0, WordSize::BYTE);
+    REQUIRE(texts.groupedBinary() == "0000");
+    texts.set(0x5, WordSize::BYTE);
+    REQUIRE(texts.groupedBinary() == "0101");
+    texts.set(0xA5, WordSize::BYTE);
+    REQUIRE(texts.groupedBinary() == "1010 0101");
+    texts.set(0x1A5, WordSize::WORD);
+    REQUIRE(texts.groupedBinary() == "0001 1010 0101");
+    REQUIRE(texts.formats() == 4);
+
+    texts.set(BigWord(-1, 128));
+    std::string all;
+    for (int i = 0; i < 32; ++i)
+        all += i ? " 1111" : "1111";
+    REQUIRE(texts.groupedBinary() == all);
+    REQUIRE(texts.formats() == 5);
+}
+
+
+// ================= BENCHMARK =================
+// hidden, run with: calc_tests "[benchmark]"
+
+TEST_CASE("Formatting cost per call, before and after", "[.][benchmark]") {
+
+    std::vector<uint64_t> values(1024);
+    std::mt19937_64 rng(3);
+    for (auto& v : values) v = rng();
+
+    const char* baseNames[] = { "dec", "bin", "oct", "hex" };
+
+    for (WordSize w : formatWordSizes) {
+        for (NumberBase b : formatBases) {
+            std::string name = std::string(baseNames[(int)b]) + " " + std::to_string((int)w) + "-bit";
+
+            BENCHMARK("legacy " + name) {
+                size_t total = 0;
+                for (uint64_t v : values) total += legacyDisplay(v, w, b).size();
+                return total;
+            };
+
+            BENCHMARK("formatValue " + name) {
+                DisplayBuffer buf;
+                size_t total = 0;
+                for (uint64_t v : values) total += formatValue(buf.data(), v, w, b);
+                return total;
+            };
+        }
+    }
+}
+
+TEST_CASE("Bulk formatting throughput", "[.][benchmark]") {
+
+    std::vector<int64_t> values(1 << 16);
+    std::mt19937_64 rng(9);
+    for (auto& v : values) v = static_cast<int64_t>(rng());
+
+    std::string out(bulkFormatCapacity(values.size()), '\0');
+    const char* baseNames[] = { "dec", "bin", "oct", "hex" };
+
+    for (NumberBase b : formatBases) {
+        for (bool pad : { false, true }) {
+            BulkFormat f;
+            f.base = b;
+            f.pad = pad;
+
+            std::string name = std::string("bulk ") + baseNames[(int)b] + (pad ? " padded" : "");
+            BENCHMARK(name.c_str()) {
+                return formatBulk(values, f, out.data());
+            };
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include "catch_amalgamated.hpp"
+#include "jit.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+
+static const WordSize jitWordSizes[] = {
+    WordSize::BYTE, WordSize::WORD, WordSize::DWORD, WordSize::QWORD
+};
+
+// random formula over the operators the native backend translates
+static std::string randomFormula(std::mt19937_64& rng, int depth)
+{
+    static const char* binary[] = {
+        "+", "-", "*", "&", "|", "^", "<<", ">>", "RoL", "RoR"
+    };
+    static const char* leaves[] = {
+        "x", "x", "1", "3", "7", "8", "31", "63", "64", "0xFF", "0x5A5A",
+        "0x80000000", "0xDEADBEEFCAFEBABE", "0x7FFFFFFFFFFFFFFF"
+    };
+
+    if (depth == 0 || rng() % 4 == 0)
+        return leaves[rng() % std::size(leaves)];
+
+    switch (rng() % 6) {
+        case 0:  return "-(" + randomFormula(rng, depth - 1) + ")";
+        case 1:  return "~(" + randomFormula(rng, depth - 1) + ")";
+        default:
+            return "(" + randomFormula(rng, depth - 1) + " " + binary[rng() % std::size(binary)] +
+                   " " + randomFormula(rng, depth - 1) + ")";
+    }
+}
+
+
+// ================= DIFFERENTIAL =================
+
+TEST_CASE("Native code matches the interpreter") {
+
+    std::mt19937_64 rng(42);
+
+    std::vector<int64_t> xs = { 0, 1, -1, 2, 7, 8, 63, 64, -64, 127, -128, 255,
+                                INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN };
+    while (xs.size() < 64)
+        xs.push_back(static_cast<int64_t>(rng()));
+
+    std::vector<int64_t> out(xs.size());
+
+    for (int n = 0; n < 300; ++n) {
+        std::string text = randomFormula(rng, 5);
+        Expression e = Expression::compile(text);
+
+        for (WordSize w : jitWordSizes) {
+            NativeExpression native(e, w);
+#if !defined(CALC_NO_JIT) && (defined(__x86_64__) || defined(_M_X64))
+            REQUIRE(native.isNative());
+#endif
+            native.evaluate(xs, out);
+
+            for (size_t i = 0; i < xs.size(); ++i) {
+                INFO(text << " at " << (int)w << " bits, x = " << xs[i]);
+                REQUIRE(out[i] == e.evaluate(w, xs[i]));
+                REQUIRE(native.evaluate(xs[i]) == out[i]);
+            }
+        }
+    }
+}
+
+TEST_CASE("Untranslated ops fall back to the interpreter") {
+
+    Expression e = Expression::compile("x / 3 + x % 5 + √16");
+    NativeExpression native(e, WordSize::WORD);
+
+    REQUIRE_FALSE(native.isNative());
+    REQUIRE(native.evaluate(100) == 33 + 0 + 4);
+    REQUIRE_THROWS_AS(NativeExpression(Expression::compile("1 / x"), WordSize::WORD).evaluate(0),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Native expressions can be moved") {
+
+    NativeExpression a(Expression::compile("x * 2"), WordSize::BYTE);
+    NativeExpression b = std::move(a);
+    REQUIRE(b.evaluate(64) == -128);
+
+    NativeExpression c(Expression::compile("x"), WordSize::BYTE);
+    c = std::move(b);
+    REQUIRE(c.evaluate(3) == 6);
+
+    std::vector<int64_t> none;
+    c.evaluate(none, none);
+}
+
+
+// ================= BENCHMARK =================
+// hidden, run with: calc_tests "[benchmark]"
+
+TEST_CASE("Native code vs interpreter vs Calculator", "[.][benchmark]") {
+
+    std::vector<int64_t> in(1 << 16);
+    std::mt19937_64 rng(7);
+    for (auto& v : in) v = static_cast<int64_t>(rng());
+    std::vector<int64_t> out(in.size());
+
+    const char* text = "((x ^ 0x5A5A5A5A) RoL 13 & 0xFFFF00FF) + (x >> 7)";
+    Expression e = Expression::compile(text);
+    NativeExpression native(e, WordSize::QWORD);
+
+    BENCHMARK("Calculator methods") {
+        Calculator c;
+        for (size_t i = 0; i < in.size(); ++i) {
+            int64_t x = in[i];
+            int64_t l = c.bitAnd(c.rol(c.bitXor(x, 0x5A5A5A5A), 13), 0xFFFF00FF);
+            out[i] = c.add(l, c.shr(x, 7));
+        }
+        return out.back();
+    };
+
+    BENCHMARK("Interpreter") {
+        for (size_t i = 0; i < in.size(); ++i)
+            out[i] = e.evaluate(WordSize::QWORD, in[i]);
+        return out.back();
+    };
+
+    BENCHMARK("Native") {
+        native.evaluate(in, out);
+        return out.back();
+    };
+}
@@ -0,0 +1,278 @@
+#include "catch_amalgamated.hpp"
+#include "calculator.h"
+#include "numtheory.h"
+
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+using u128 = unsigned __int128;
+
+static std::vector<bool> sieve(size_t n)
+{
+    std::vector<bool> prime(n, true);
+    prime[0] = prime[1] = false;
+    for (size_t p = 2; p * p < n; ++p)
+        if (prime[p])
+            for (size_t q = p * p; q < n; q += p)
+                prime[q] = false;
+    return prime;
+}
+
+// a random prime of about `bits` bits
+static uint64_t randomPrime(std::mt19937_64& rng, int bits)
+{
+    uint64_t top = 1ULL << (bits - 1);
+    for (;;) {
+        uint64_t p = (rng() & (top - 1)) | top | 1;
+        if (numtheory::isPrime(p))
+            return p;
+    }
+}
+
+static void checkFactors(uint64_t n)
+{
+    std::vector<uint64_t> f = numtheory::factor(n);
+    u128 product = 1;
+    for (size_t i = 0; i < f.size(); ++i) {
+        REQUIRE(numtheory::isPrime(f[i]));
+        if (i) REQUIRE(f[i - 1] <= f[i]);
+        product *= f[i];
+    }
+    REQUIRE(product == (n < 2 ? 1 : n));
+}
+
+
+// ================= GCD AND LCM =================
+
+TEST_CASE("gcd agrees with std::gcd") {
+
+    STATIC_REQUIRE(numtheory::gcd(0, 0) == 0);
+    STATIC_REQUIRE(numtheory::gcd(12, 18) == 6);
+
+    std::mt19937_64 rng(19);
+    for (int i = 0; i < 20000; ++i) {
+        uint64_t a = rng() >> (rng() % 64), b = rng() >> (rng() % 64);
+        uint64_t g = rng() >> (32 + rng() % 32);
+        REQUIRE(numtheory::gcd(a, b) == std::gcd(a, b));
+        REQUIRE(numtheory::gcd(a * g, b * g) == std::gcd(a * g, b * g));
+    }
+    REQUIRE(numtheory::gcd(0, UINT64_MAX) == UINT64_MAX);
+    REQUIRE(numtheory::gcd(1ULL << 63, 1ULL << 40) == 1ULL << 40);
+}
+
+TEST_CASE("Calculator gcd and lcm") {
+
+    Calculator c;
+    REQUIRE(c.gcd(-12, 18) == 6);
+    REQUIRE(c.gcd(0, -7) == 7);
+    REQUIRE(c.gcd(0, 0) == 0);
+    REQUIRE(c.lcm(-4, 6) == 12);
+    REQUIRE(c.lcm(0, 6) == 0);
+    REQUIRE((c.getFlags() & (flags::CF | flags::OF)) == 0);
+
+    // |MIN| is not a positive QWORD
+    REQUIRE(c.gcd(INT64_MIN, 0) == INT64_MIN);
+    REQUIRE((c.getFlags() & (flags::CF | flags::OF)) == (flags::CF | flags::OF));
+
+    // coprime values whose product leaves the word
+    c.setWordSize(WordSize::BYTE);
+    REQUIRE(c.lcm(16, 9) == static_cast<int8_t>(144));
+    REQUIRE((c.getFlags() & (flags::CF | flags::OF)) == (flags::CF | flags::OF));
+    REQUIRE(c.lcm(8, 12) == 24);
+    REQUIRE((c.getFlags() & (flags::CF | flags::OF)) == 0);
+
+    c.setWordSize(WordSize::QWORD);
+    c.lcm(1LL << 40, (1LL << 40) - 1);
+    REQUIRE((c.getFlags() & (flags::CF | flags::OF)) == (flags::CF | flags::OF));
+}
+
+// ================= EXTENDED EUCLID AND INVERSES =================
+
+TEST_CASE("egcd gives Bezout coefficients") {
+
+    std::mt19937_64 rng(23);
+    std::vector<uint64_t> v = { 0, 1, 2, 3, 1ULL << 63, UINT64_MAX, UINT64_MAX - 1, 0xFFFFFFFFULL };
+    for (int i = 0; i < 300; ++i)
+        v.push_back(rng() >> (rng() % 64));
+
+    for (uint64_t a : v) {
+        for (uint64_t b : v) {
+            int64_t x, y;
+            uint64_t g = numtheory::egcd(a, b, x, y);
+            REQUIRE(g == std::gcd(a, b));
+            // the identity holds mod 2^64 even where a * x does not fit
+            REQUIRE(a * static_cast<uint64_t>(x) + b * static_cast<uint64_t>(y) == g);
+            if (g && a && b && a != g && b != g) {
+                REQUIRE(static_cast<u128>(x < 0 ? -static_cast<u128>(x) : x) * 2 * g <= b);
+                REQUIRE(static_cast<u128>(y < 0 ? -static_cast<u128>(y) : y) * 2 * g <= a);
+            }
+        }
+    }
+
+    Calculator c;
+    Bezout r = c.egcd(-240, 46);
+    REQUIRE(r.g == 2);
+    REQUIRE(c.getValue() == 2);
+    REQUIRE(-240 * r.x + 46 * r.y == 2);
+}
+
+TEST_CASE("modInverse") {
+
+    std::mt19937_64 rng(29);
+    for (int i = 0; i < 20000; ++i) {
+        uint64_t m = rng() >> (rng() % 63);
+        if (m == 0) continue;
+        uint64_t a = rng(), inv;
+        bool ok = numtheory::modInverse(a, m, inv);
+        REQUIRE(ok == (std::gcd(a % m, m) == 1));
+        if (ok) {
+            REQUIRE(inv < m);
+            REQUIRE(static_cast<uint64_t>(static_cast<u128>(a % m) * inv % m) == 1 % m);
+        }
+    }
+
+    Calculator c;
+    REQUIRE(c.modInverse(3, 7) == 5);
+    REQUIRE(c.modInverse(-3, 7) == 2);
+    REQUIRE(c.modInverse(3, -7) == 5);
+    REQUIRE(c.tryModInverse(4, 8).error == OpError::Domain);
+    REQUIRE(c.tryModInverse(4, 0).error == OpError::DivideByZero);
+    REQUIRE_THROWS_AS(c.modInverse(2, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(c.modInverse(2, 4), std::invalid_argument);
+    REQUIRE(c.getValue() == 5);
+
+    // an inverse past the positive range of the word wraps, like gcd
+    c.setWordSize(WordSize::BYTE);
+    REQUIRE(c.tryModInverse(7, 200).value == -113);       // 7 * 143 = 1001
+    REQUIRE(c.getValue() == -113);
+    REQUIRE((c.getFlags() & (flags::CF | flags::OF)) == (flags::CF | flags::OF));
+    REQUIRE(c.modInverse(3, 7) == 5);
+    REQUIRE((c.getFlags() & (flags::CF | flags::OF)) == 0);
+}
+
+TEST_CASE("batch gcd, lcm and modInverse") {
+
+    Calculator c;
+    std::vector<int64_t> a = { 12, -12, 0, 7, INT64_MIN }, b = { 18, 8, 5, 0, 2 }, out(5);
+    c.gcd(a, b, out);
+    REQUIRE(out == std::vector<int64_t>{ 6, 4, 5, 7, 2 });
+    c.lcm(a, b, out);
+    REQUIRE(out == std::vector<int64_t>{ 36, 24, 0, 0, INT64_MIN });
+
+    std::vector<int64_t> x = { 1, 2, 3, 4, -1 };
+    std::vector<uint64_t> failed(1);
+    REQUIRE(c.tryModInverse(x, 10, out, failed) == 2);
+    REQUIRE(out == std::vector<int64_t>{ 1, 0, 7, 0, 9 });
+    REQUIRE(failed[0] == 0b01010);
+    REQUIRE_THROWS_AS(c.modInverse(x, 10, out), std::invalid_argument);
+    REQUIRE_THROWS_AS(c.modInverse(x, 0, out), std::invalid_argument);
+    std::vector<int64_t> odd = { 1, 3, 7, 9, -1 };
+    c.modInverse(odd, 10, out);
+    REQUIRE(out == std::vector<int64_t>{ 1, 7, 3, 9, 9 });
+
+    c.setWordSize(WordSize::BYTE);
+    c.modInverse(odd, 200, out);
+    REQUIRE(out == std::vector<int64_t>{ 1, 67, -113, 89, -57 });
+}
+
+// ================= PRIMALITY =================
+
+TEST_CASE("isPrime matches a sieve below 10^6") {
+
+    constexpr size_t limit = 1000000;
+    std::vector<bool> prime = sieve(limit);
+    for (size_t n = 0; n < limit; ++n)
+        REQUIRE(numtheory::isPrime(n) == prime[n]);
+}
+
+TEST_CASE("isPrime on large primes and strong pseudoprimes") {
+
+    for (uint64_t p : { 4294967291ULL, 4294967311ULL, 2305843009213693951ULL, 18446744073709551557ULL,
+                        9223372036854775783ULL, 1000000000000000003ULL })
+        REQUIRE(numtheory::isPrime(p));
+
+    // Carmichael numbers, strong pseudoprimes to several small bases, and
+    // products of large primes
+    for (uint64_t n : { 561ULL, 3215031751ULL, 2152302898747ULL, 3474749660383ULL, 341550071728321ULL,
+                        3825123056546413051ULL, 4759123141ULL,
+                        4294967291ULL * 4294967291ULL, 4294967291ULL * 4294967279ULL, 0xFFFFFFFFFFFFFFFFULL,
+                        18446744073709551557ULL - 2 })
+        REQUIRE_FALSE(numtheory::isPrime(n));
+
+    // a prime at 32 bits, which takes the three-base path
+    REQUIRE(numtheory::isPrime(4294967291ULL));
+    REQUIRE_FALSE(numtheory::isPrime(4294967291ULL - 2));
+
+    Calculator c;
+    REQUIRE(c.isPrime(97) == 1);
+    REQUIRE(c.isPrime(-97) == 0);
+    REQUIRE(c.isPrime(INT64_MAX) == 0);
+    REQUIRE(c.isPrime(9223372036854775783LL) == 1);
+}
+
+TEST_CASE("batch isPrime matches the scalar test on every thread count") {
+
+    std::mt19937_64 rng(31);
+    std::vector<int64_t> a(100000);
+    for (size_t i = 0; i < a.size(); ++i)
+        a[i] = i % 2 ? static_cast<int64_t>(rng() >> (rng() % 64)) : static_cast<int64_t>(i) - 50000;
+
+    Calculator c;
+    for (unsigned threads : { 0u, 1u, 3u, 8u }) {
+        std::vector<int64_t> out(a.size(), -1);
+        c.isPrime(a, out, threads);
+        for (size_t i = 0; i < a.size(); ++i)
+            REQUIRE(out[i] == (a[i] > 0 && numtheory::isPrime(static_cast<uint64_t>(a[i]))));
+    }
+
+    std::vector<int64_t> none;
+    c.isPrime(none, none);
+    std::vector<int64_t> small(3);
+    REQUIRE_THROWS_AS(c.isPrime(a, small), std::invalid_argument);
+}
+
+// ================= FACTORIZATION =================
+
+TEST_CASE("factor small and structured values") {
+
+    REQUIRE(numtheory::factor(0).empty());
+    REQUIRE(numtheory::factor(1).empty());
+    REQUIRE(numtheory::factor(360) == std::vector<uint64_t>{ 2, 2, 2, 3, 3, 5 });
+    REQUIRE(numtheory::factor(1ULL << 63) == std::vector<uint64_t>(63, 2));
+    REQUIRE(numtheory::factor(UINT64_MAX) ==
+            std::vector<uint64_t>{ 3, 5, 17, 257, 641, 65537, 6700417 });
+
+    for (uint64_t n = 0; n < 20000; ++n)
+        checkFactors(n);
+    for (uint64_t n : { 18446744073709551557ULL, 4294967291ULL * 4294967291ULL, 1000003ULL * 1000003 * 1000003 })
+        checkFactors(n);
+
+    uint64_t power = 1;
+    for (int i = 0; i < 40; ++i)
+        power *= 3;
+    REQUIRE(numtheory::factor(power) == std::vector<uint64_t>(40, 3));
+}
+
+TEST_CASE("factor random values and semiprimes") {
+
+    std::mt19937_64 rng(37);
+    for (int i = 0; i < 2000; ++i)
+        checkFactors(rng() >> (rng() % 64));
+
+    // the hard case for rho: two primes of about 32 bits
+    for (int i = 0; i < 50; ++i) {
+        uint64_t p = randomPrime(rng, 32), q = randomPrime(rng, 32);
+        std::vector<uint64_t> f = numtheory::factor(p * q);
+        REQUIRE(f == std::vector<uint64_t>{ std::min(p, q), std::max(p, q) });
+    }
+
+    Calculator c;
+    c.setValue(42);
+    REQUIRE(c.factor(-360) == std::vector<int64_t>{ 2, 2, 2, 3, 3, 5 });
+    REQUIRE(c.factor(INT64_MIN) == std::vector<int64_t>(63, 2));
+    REQUIRE(c.getValue() == 42);
+}
@@ -0,0 +1,148 @@
+#include "catch_amalgamated.hpp"
+#include "stream.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+
+static std::string tempPath(const char* name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static void writeFile(const std::string& path, const std::string& text)
+{
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+// runs the stream and returns everything it wrote
+static std::string runStream(const std::string& input, const char* expr,
+                             const StreamOptions& o, StreamStats* stats = nullptr)
+{
+    std::string path = tempPath("calc_stream_test.txt");
+    writeFile(path, input);
+
+    std::FILE* out = std::tmpfile();
+    REQUIRE(out != nullptr);
+
+    StreamStats st = streamFile(path, out, Expression::compile(expr, o.inputBase), o);
+    if (stats) *stats = st;
+
+    std::string result(static_cast<size_t>(std::ftell(out)), '\0');
+    std::rewind(out);
+    size_t n = std::fread(result.data(), 1, result.size(), out);
+    result.resize(n);
+    std::fclose(out);
+
+    std::filesystem::remove(path);
+    return result;
+}
+
+
+TEST_CASE("Stream converts mixed bases with display() formatting") {
+
+    StreamOptions o;
+    o.outputBase = NumberBase::HEX;
+    o.wordSize = WordSize::BYTE;
+
+    std::string in = "10\n0x1F\n0b101\n0o17\n-1\r\n  300 \n\n255";
+    REQUIRE(runStream(in, "x", o) == "A\n1F\n5\nF\nFF\n2C\n\nFF\n");
+
+    o.outputBase = NumberBase::DEC;
+    REQUIRE(runStream(in, "x", o) == "10\n31\n5\n15\n-1\n44\n\n-1\n");
+}
+
+TEST_CASE("Stream runs each number through the pipeline") {
+
+    StreamOptions o;
+    o.wordSize = WordSize::WORD;
+    o.outputBase = NumberBase::DEC;
+
+    REQUIRE(runStream("1\n2\n3\n", "x * x + 1", o) == "2\n5\n10\n");
+    REQUIRE(runStream("0x7FFF\n", "x + 1", o) == "-32768\n");
+}
+
+TEST_CASE("Stream writes Error for bad lines and keeps going") {
+
+    StreamOptions o;
+    StreamStats st;
+
+    REQUIRE(runStream("4\nzz\n0\n2\n", "100 / x", o, &st) == "25\nError\nError\n50\n");
+    REQUIRE(st.lines == 4);
+    REQUIRE(st.errors == 2);
+}
+
+TEST_CASE("Stream preserves order across chunks and threads") {
+
+    std::mt19937_64 rng(5);
+    std::string in, expect;
+
+    Calculator calc;
+    calc.setWordSize(WordSize::DWORD);
+    calc.setBase(NumberBase::BIN);
+
+    for (int i = 0; i < 5000; ++i) {
+        int64_t v = static_cast<int64_t>(rng() >> (rng() % 64));
+        in += "0x";
+        calc.setBase(NumberBase::HEX);
+        calc.setWordSize(WordSize::QWORD);
+        calc.setValue(v);
+        in += calc.display();
+        in += '\n';
+
+        calc.setWordSize(WordSize::DWORD);
+        calc.setBase(NumberBase::BIN);
+        calc.bitXor(v, 0x5A5A5A5A);
+        expect += calc.display();
+        expect += '\n';
+    }
+
+    StreamOptions o;
+    o.wordSize = WordSize::DWORD;
+    o.outputBase = NumberBase::BIN;
+    o.chunkSize = 100;
+    o.threads = 4;
+
+    StreamStats st;
+    REQUIRE(runStream(in, "x ^ 0x5A5A5A5A", o, &st) == expect);
+    REQUIRE(st.lines == 5000);
+    REQUIRE(st.errors == 0);
+}
+
+TEST_CASE("Stream edge cases") {
+
+    StreamOptions o;
+
+    REQUIRE(runStream("", "x", o).empty());
+    REQUIRE(runStream("7", "x", o) == "7\n");
+
+    // blank lines keep the output aligned with the input
+    StreamStats st;
+    REQUIRE(runStream("\n\n", "x", o, &st) == "\n\n");
+    REQUIRE(st.lines == 2);
+    REQUIRE(st.errors == 0);
+    REQUIRE(runStream("1\n\n-3\nzz\n0x10\n", "x*2", o, &st) == "2\n\n-6\nError\n32\n");
+    REQUIRE(st.errors == 1);
+
+    // a line too long to be a number is one Error line, however the chunks
+    // fall around it
+    StreamOptions small;
+    small.chunkSize = 64;
+    small.threads = 2;
+    std::string longLine(5000, '7');
+    REQUIRE(runStream("1\n" + longLine + "\n2\n" + longLine + "\n3", "x", small, &st) ==
+            "1\nError\n2\nError\n3\n");
+    REQUIRE(st.lines == 5);
+    REQUIRE(st.errors == 2);
+    REQUIRE(runStream(longLine, "x", small, &st) == "Error\n");
+    REQUIRE(st.lines == 1);
+
+    std::FILE* out = std::tmpfile();
+    REQUIRE_THROWS_AS(streamFile(tempPath("calc_no_such_file.txt"), out, Expression::compile("x")),
+                      std::runtime_error);
+    std::fclose(out);
+}
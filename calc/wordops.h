@@ -0,0 +1,753 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include "calculator.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// Word-size arithmetic core, specialized at compile time.
+//
+// Every function takes full 64-bit operands, does the 64-bit operation and
+// narrows the result to W bits with sign extension, exactly like the
+// Calculator ops. With W known the narrowing is a single movsx and shifts
+// and rotates are single instructions, and everything is usable in
+// constant expressions.
+
+namespace wordops {
+
+template <WordSize W>
+inline constexpr int bits = static_cast<int>(W);
+
+template <WordSize W>
+constexpr uint64_t mask()
+{
+    if constexpr (W == WordSize::QWORD) return ~0ULL;
+    else return (1ULL << bits<W>) - 1;
+}
+
+// the unsigned type that is exactly W bits wide
+template <WordSize W>
+using uword = std::conditional_t<W == WordSize::BYTE,  uint8_t,
+              std::conditional_t<W == WordSize::WORD,  uint16_t,
+              std::conditional_t<W == WordSize::DWORD, uint32_t, uint64_t>>>;
+
+template <WordSize W>
+using sword = std::make_signed_t<uword<W>>;
+
+template <WordSize W>
+constexpr int64_t signExtend(uint64_t v)
+{
+    return static_cast<sword<W>>(static_cast<uword<W>>(v));
+}
+
+// ================= ARITHMETIC =================
+
+template <WordSize W>
+constexpr int64_t add(int64_t a, int64_t b)
+{
+    return signExtend<W>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+template <WordSize W>
+constexpr int64_t subtract(int64_t a, int64_t b)
+{
+    return signExtend<W>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+
+template <WordSize W>
+constexpr int64_t multiply(int64_t a, int64_t b)
+{
+    return signExtend<W>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+// b must not be 0; INT64_MIN / -1 wraps instead of trapping
+template <WordSize W>
+constexpr int64_t divide(int64_t a, int64_t b)
+{
+    if (b == -1) return signExtend<W>(0 - static_cast<uint64_t>(a));
+    return signExtend<W>(static_cast<uint64_t>(a / b));
+}
+
+template <WordSize W>
+constexpr int64_t mod(int64_t a, int64_t b)
+{
+    if (b == -1) return 0;
+    return signExtend<W>(static_cast<uint64_t>(a % b));
+}
+
+// ================= BIT OPERATIONS =================
+
+template <WordSize W>
+constexpr int64_t bitAnd(int64_t a, int64_t b) { return signExtend<W>(static_cast<uint64_t>(a & b)); }
+
+template <WordSize W>
+constexpr int64_t bitOr(int64_t a, int64_t b) { return signExtend<W>(static_cast<uint64_t>(a | b)); }
+
+template <WordSize W>
+constexpr int64_t bitXor(int64_t a, int64_t b) { return signExtend<W>(static_cast<uint64_t>(a ^ b)); }
+
+template <WordSize W>
+constexpr int64_t bitNot(int64_t a) { return signExtend<W>(~static_cast<uint64_t>(a)); }
+
+// ================= SHIFT =================
+// shifting by the word size or more (or by a negative count) gives 0
+
+template <WordSize W>
+constexpr int64_t shl(int64_t a, int n)
+{
+    if (static_cast<unsigned>(n) >= static_cast<unsigned>(bits<W>)) return 0;
+    return signExtend<W>(static_cast<uword<W>>(a) << n);
+}
+
+template <WordSize W>
+constexpr int64_t shr(int64_t a, int n)
+{
+    if (static_cast<unsigned>(n) >= static_cast<unsigned>(bits<W>)) return 0;
+    return signExtend<W>(static_cast<uword<W>>(a) >> n);
+}
+
+// ================= ROTATE =================
+// the count is taken modulo the word size, negative counts rotate the other way
+
+template <WordSize W>
+constexpr int64_t rol(int64_t a, int n)
+{
+    return signExtend<W>(std::rotl(static_cast<uword<W>>(a), n % bits<W>));
+}
+
+template <WordSize W>
+constexpr int64_t ror(int64_t a, int n)
+{
+    return signExtend<W>(std::rotr(static_cast<uword<W>>(a), n % bits<W>));
+}
+
+// ================= BIT MANIPULATION =================
+// Counts and bit indexes come back as plain numbers, the rest are bit
+// patterns of the word. std::popcount, countl_zero and countr_zero become
+// POPCNT, LZCNT and TZCNT when the target has them, BLSR and BLSI are
+// what the compiler makes of x & (x - 1) and x & -x with BMI1, and PDEP
+// and PEXT use BMI2 when it is enabled.
+
+constexpr uint64_t byteSwap64(uint64_t v)
+{
+#if defined(__GNUC__)
+    return __builtin_bswap64(v);
+#else
+    v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+    v = ((v >> 16) & 0x0000FFFF0000FFFFULL) | ((v & 0x0000FFFF0000FFFFULL) << 16);
+    return (v >> 32) | (v << 32);
+#endif
+}
+
+constexpr uint64_t bitReverse64(uint64_t v)
+{
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return byteSwap64(v);
+}
+
+// the low bits of v, in order, to the set bits of m
+constexpr uint64_t deposit64(uint64_t v, uint64_t m)
+{
+#if defined(__BMI2__)
+    if (!std::is_constant_evaluated()) return _pdep_u64(v, m);
+#endif
+    uint64_t r = 0;
+    for (uint64_t bit = 1; m; bit <<= 1, m &= m - 1)
+        if (v & bit) r |= m & (0 - m);
+    return r;
+}
+
+// the bits of v under the set bits of m, packed to the bottom
+constexpr uint64_t extract64(uint64_t v, uint64_t m)
+{
+#if defined(__BMI2__)
+    if (!std::is_constant_evaluated()) return _pext_u64(v, m);
+#endif
+    uint64_t r = 0;
+    for (uint64_t bit = 1; m; bit <<= 1, m &= m - 1)
+        if (v & m & (0 - m)) r |= bit;
+    return r;
+}
+
+template <WordSize W>
+constexpr int64_t popcount(int64_t a) { return std::popcount(static_cast<uword<W>>(a)); }
+
+template <WordSize W>
+constexpr int64_t parity(int64_t a) { return std::popcount(static_cast<uword<W>>(a)) & 1; }
+
+// leading zeros count from the top bit of the word; 0 has bits<W> of both
+template <WordSize W>
+constexpr int64_t clz(int64_t a) { return std::countl_zero(static_cast<uword<W>>(a)); }
+
+template <WordSize W>
+constexpr int64_t ctz(int64_t a) { return std::countr_zero(static_cast<uword<W>>(a)); }
+
+// index of the highest / lowest set bit, -1 for 0
+template <WordSize W>
+constexpr int64_t highestBit(int64_t a) { return bits<W> - 1 - std::countl_zero(static_cast<uword<W>>(a)); }
+
+template <WordSize W>
+constexpr int64_t lowestBit(int64_t a)
+{
+    uword<W> v = static_cast<uword<W>>(a);
+    return v ? std::countr_zero(v) : -1;
+}
+
+template <WordSize W>
+constexpr int64_t bswap(int64_t a)
+{
+    return signExtend<W>(byteSwap64(static_cast<uword<W>>(a)) >> (64 - bits<W>));
+}
+
+template <WordSize W>
+constexpr int64_t bitReverse(int64_t a)
+{
+    return signExtend<W>(bitReverse64(static_cast<uword<W>>(a)) >> (64 - bits<W>));
+}
+
+template <WordSize W>
+constexpr int64_t pdep(int64_t a, int64_t m)
+{
+    return signExtend<W>(deposit64(static_cast<uint64_t>(a), static_cast<uword<W>>(m)));
+}
+
+template <WordSize W>
+constexpr int64_t pext(int64_t a, int64_t m)
+{
+    return signExtend<W>(extract64(static_cast<uint64_t>(a), static_cast<uword<W>>(m)));
+}
+
+// clear / isolate the lowest set bit
+template <WordSize W>
+constexpr int64_t blsr(int64_t a)
+{
+    uint64_t v = static_cast<uint64_t>(a);
+    return signExtend<W>(v & (v - 1));
+}
+
+template <WordSize W>
+constexpr int64_t blsi(int64_t a)
+{
+    uint64_t v = static_cast<uint64_t>(a);
+    return signExtend<W>(v & (0 - v));
+}
+
+// ================= ROOTS AND LOGARITHMS =================
+// Exact and integer-only, so the result never depends on the precision of
+// long double. Newton's method starts above the root and from there falls
+// monotonically onto floor(root); it stops when a step no longer goes
+// down. Square and cube roots look the start up in a small table indexed
+// by the top 8 or 9 bits; it is already about 8 bits right, so two or
+// three divides remain. Other degrees start from a power of two above the
+// root.
+
+// ceil(root(t + 1)) with 8 fraction bits: shifted back up and rounded up
+// it is always above the root of anything with the index as its top bits
+template <int K, size_t N>
+constexpr std::array<uint16_t, N> rootSeeds()
+{
+    auto pow = [](uint64_t x) { uint64_t p = 1; for (int j = 0; j < K; ++j) p *= x; return p; };
+    std::array<uint16_t, N> t{};
+    uint64_t r = 0;
+    for (size_t i = 0; i < N; ++i) {
+        while (pow(r) < (i + 1) << (8 * K)) ++r;
+        t[i] = static_cast<uint16_t>(r);
+    }
+    return t;
+}
+
+inline constexpr auto sqrtSeeds = rootSeeds<2, 512>();
+inline constexpr auto cbrtSeeds = rootSeeds<3, 512>();
+
+// floor(sqrt(n))
+constexpr uint64_t isqrt64(uint64_t n)
+{
+    if (n < 2) return n;
+    int bits = 64 - std::countl_zero(n);
+    int shift = bits > 9 ? (bits - 8) & ~1 : 0;     // even, leaves 8 or 9 bits
+    uint64_t x = ((uint64_t(sqrtSeeds[n >> shift]) << (shift / 2)) + 255) >> 8;
+    uint64_t y = (x + n / x) / 2;
+    while (y < x) {
+        x = y;
+        y = (x + n / x) / 2;
+    }
+    return x;
+}
+
+// floor(cbrt(n))
+constexpr uint64_t icbrt64(uint64_t n)
+{
+    if (n < 2) return n;
+    int bits = 64 - std::countl_zero(n);
+    int shift = bits > 9 ? (bits - 7) / 3 * 3 : 0;  // leaves 7 to 9 bits
+    uint64_t x = ((uint64_t(cbrtSeeds[n >> shift]) << (shift / 3)) + 255) >> 8;
+    uint64_t y = (2 * x + n / (x * x)) / 3;
+    while (y < x) {
+        x = y;
+        y = (2 * x + n / (x * x)) / 3;
+    }
+    return x;
+}
+
+// floor(n^(1/k)) for k >= 1
+constexpr uint64_t iroot64(uint64_t n, int k)
+{
+    if (k == 1 || n < 2) return n;
+    if (k == 2) return isqrt64(n);
+    if (k == 3) return icbrt64(n);
+
+    int bits = 64 - std::countl_zero(n);
+    if (k >= bits) return 1;                        // n < 2^k
+
+    // x^(k-1), or 0 once it passes n (then n / x^(k-1) is 0 too)
+    auto power = [&](uint64_t x) {
+        uint64_t p = 1;
+        for (int i = 1; i < k; ++i)
+            if (__builtin_mul_overflow(p, x, &p) || p > n) return uint64_t(0);
+        return p;
+    };
+    auto step = [&](uint64_t x) {
+        uint64_t p = power(x);
+        return ((k - 1) * x + (p ? n / p : 0)) / k;
+    };
+
+    uint64_t x = 1ULL << ((bits + k - 1) / k);
+    uint64_t y = step(x);
+    while (y < x) {
+        x = y;
+        y = step(x);
+    }
+    return x;
+}
+
+// for n > 0
+constexpr int ilog2_64(uint64_t n)
+{
+    return 63 - std::countl_zero(n);
+}
+
+// for n > 0: log10(2) ~ 1233 / 4096 turns the bit length into a guess that
+// is exact or one too high, one table lookup settles it
+constexpr int ilog10_64(uint64_t n)
+{
+    constexpr uint64_t powers[20] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+        100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+        10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+        10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL,
+    };
+    int t = ((ilog2_64(n) + 1) * 1233) >> 12;
+    return t - (n < powers[t]);
+}
+
+// digits of n in base b, 1 for 0
+constexpr int digits64(uint64_t n, NumberBase b)
+{
+    int bits = n ? ilog2_64(n) + 1 : 1;
+    switch (b) {
+        case NumberBase::BIN: return bits;
+        case NumberBase::OCT: return (bits + 2) / 3;
+        case NumberBase::HEX: return (bits + 3) / 4;
+        case NumberBase::DEC: return n ? ilog10_64(n) + 1 : 1;
+    }
+    return bits;
+}
+
+// ================= FLAGS =================
+// The carrying ops return their value together with the CF and OF it
+// raises. The overflow builtins give the W-bit result and the unsigned
+// carry or the signed overflow in one go, an ADD / SUB / IMUL plus a SETC
+// or SETO.
+
+struct Flagged {
+    int64_t value;
+    uint32_t flags;     // CF and OF only
+};
+
+// multiplies rather than ?: so the compiler emits SETcc, not a branch that
+// random overflows would mispredict
+constexpr uint32_t carryFlags(bool cf, bool of)
+{
+    return static_cast<uint32_t>(cf) * flags::CF | static_cast<uint32_t>(of) * flags::OF;
+}
+
+// a + b + carry. The unsigned steps cannot both carry, the signed ones can
+// overflow and cancel out (-128 + -1 + 1 in a BYTE), hence the xor.
+template <WordSize W>
+constexpr Flagged adc(int64_t a, int64_t b, bool carry)
+{
+    uword<W> u{};
+    sword<W> s{};
+    bool cf = __builtin_add_overflow(static_cast<uword<W>>(a), static_cast<uword<W>>(b), &u);
+    cf |= __builtin_add_overflow(u, static_cast<uword<W>>(carry), &u);
+    bool of = __builtin_add_overflow(static_cast<sword<W>>(a), static_cast<sword<W>>(b), &s);
+    of ^= __builtin_add_overflow(s, static_cast<sword<W>>(carry), &s);
+    return { signExtend<W>(u), carryFlags(cf, of) };
+}
+
+// a - b - borrow
+template <WordSize W>
+constexpr Flagged sbb(int64_t a, int64_t b, bool borrow)
+{
+    uword<W> u{};
+    sword<W> s{};
+    bool cf = __builtin_sub_overflow(static_cast<uword<W>>(a), static_cast<uword<W>>(b), &u);
+    cf |= __builtin_sub_overflow(u, static_cast<uword<W>>(borrow), &u);
+    bool of = __builtin_sub_overflow(static_cast<sword<W>>(a), static_cast<sword<W>>(b), &s);
+    of ^= __builtin_sub_overflow(s, static_cast<sword<W>>(borrow), &s);
+    return { signExtend<W>(u), carryFlags(cf, of) };
+}
+
+// multiply() with IMUL's flags: CF = OF = the signed product did not fit
+template <WordSize W>
+constexpr Flagged imul(int64_t a, int64_t b)
+{
+    sword<W> s{};
+    bool of = __builtin_mul_overflow(static_cast<sword<W>>(a), static_cast<sword<W>>(b), &s);
+    return { s, carryFlags(of, of) };
+}
+
+// high 64 bits of the unsigned 128-bit product
+constexpr uint64_t mulHigh64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#else
+    uint64_t lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t mid1 = (a >> 32) * (b & 0xFFFFFFFF) + (lo >> 32);
+    uint64_t mid2 = (a & 0xFFFFFFFF) * (b >> 32) + (mid1 & 0xFFFFFFFF);
+    return (a >> 32) * (b >> 32) + (mid1 >> 32) + (mid2 >> 32);
+#endif
+}
+
+// (hi:lo) / d and its remainder, for hi < d so the quotient fits: DIV with
+// a 128-bit dividend. For setting up reciprocals, not for hot loops.
+constexpr uint64_t divide128(uint64_t hi, uint64_t lo, uint64_t d, uint64_t& rem)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 n = static_cast<unsigned __int128>(hi) << 64 | lo;
+    rem = static_cast<uint64_t>(n % d);
+    return static_cast<uint64_t>(n / d);
+#else
+    // restoring division, one quotient bit per step
+    uint64_t q = 0;
+    for (int i = 63; i >= 0; --i) {
+        bool top = hi >> 63;
+        hi = hi << 1 | lo >> 63;
+        lo <<= 1;
+        if (top || hi >= d) {
+            hi -= d;
+            q |= 1ULL << i;
+        }
+    }
+    rem = hi;
+    return q;
+#endif
+}
+
+// the 2W-bit products; below a QWORD they fit a 64-bit multiply
+template <WordSize W>
+constexpr HiLo mulHiLo(int64_t a, int64_t b)
+{
+    uint64_t ua = static_cast<uword<W>>(a);
+    uint64_t ub = static_cast<uword<W>>(b);
+    if constexpr (W == WordSize::QWORD) {
+        return { static_cast<int64_t>(mulHigh64(ua, ub)), static_cast<int64_t>(ua * ub) };
+    } else {
+        uint64_t p = ua * ub;
+        return { signExtend<W>(p >> bits<W>), signExtend<W>(p) };
+    }
+}
+
+// signed high half: the unsigned one less b for a negative a and a for a
+// negative b
+template <WordSize W>
+constexpr HiLo imulHiLo(int64_t a, int64_t b)
+{
+    int64_t sa = static_cast<sword<W>>(a);
+    int64_t sb = static_cast<sword<W>>(b);
+    uint64_t ua = static_cast<uint64_t>(sa);
+    uint64_t ub = static_cast<uint64_t>(sb);
+    if constexpr (W == WordSize::QWORD) {
+        uint64_t hi = mulHigh64(ua, ub) - (sa < 0 ? ub : 0) - (sb < 0 ? ua : 0);
+        return { static_cast<int64_t>(hi), static_cast<int64_t>(ua * ub) };
+    } else {
+        uint64_t p = ua * ub;      // |sa * sb| <= 2^62
+        return { signExtend<W>(p >> bits<W>), signExtend<W>(p) };
+    }
+}
+
+// ================= POWERS =================
+
+// a^e by squaring, wrapping at W bits like repeated multiply(). CF and OF
+// are IMUL's, set when the exact power does not fit. The base is never
+// squared past the top bit of e, so an overflow on the way is an overflow
+// of the result.
+template <WordSize W>
+constexpr Flagged ipow(int64_t a, uint64_t e)
+{
+    int64_t r = 1, b = signExtend<W>(static_cast<uint64_t>(a));
+    bool over = false;
+    while (e) {
+        // times b or times 1, picked with a mask so the random bits of e
+        // are not branches
+        uint64_t pick = 0 - (e & 1);
+        int64_t f = static_cast<int64_t>(1 + ((static_cast<uint64_t>(b) - 1) & pick));
+        over |= __builtin_mul_overflow(r, f, &r);
+        e >>= 1;
+        if (e) over |= __builtin_mul_overflow(b, b, &b);
+    }
+    int64_t v = signExtend<W>(static_cast<uint64_t>(r));
+    over |= v != r;
+    return { v, carryFlags(over, over) };
+}
+
+// a * b mod m for m > 0, without the product wrapping
+constexpr uint64_t mulMod64(uint64_t a, uint64_t b, uint64_t m)
+{
+    if ((a | b) >> 32 == 0)
+        return a * b % m;
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b % m);
+#else
+    // double and add, one bit of b at a time
+    uint64_t r = 0;
+    a %= m;
+    for (; b; b >>= 1) {
+        if (b & 1) r = r >= m - a ? r - (m - a) : r + a;
+        a = a >= m - a ? a - (m - a) : a + a;
+    }
+    return r;
+#endif
+}
+
+// Montgomery form modulo an odd m: x is kept as x * 2^64 mod m, and a
+// modular multiply is three multiplies and a subtract instead of a divide
+struct Montgomery {
+    uint64_t m;
+    uint64_t inv;   // m^-1 mod 2^64
+    uint64_t r2;    // 2^128 mod m, to bring values into the form
+
+    constexpr explicit Montgomery(uint64_t odd) : m(odd), inv(odd), r2(0)
+    {
+        // m * m = 1 mod 8, so m is its own inverse to 3 bits; each Newton
+        // step doubles that
+        for (int i = 0; i < 5; ++i)
+            inv *= 2 - m * inv;
+        uint64_t r = (0 - m) % m;   // 2^64 mod m
+        r2 = mulMod64(r, r, m);
+    }
+
+    // (hi:lo) * 2^-64 mod m, for hi < m. u * m has the same low limb as
+    // (hi:lo), so the difference is exact in the high limb alone.
+    constexpr uint64_t reduce(uint64_t hi, uint64_t lo) const
+    {
+        uint64_t h = mulHigh64(lo * inv, m);
+        return hi >= h ? hi - h : hi - h + m;
+    }
+
+    constexpr uint64_t multiply(uint64_t a, uint64_t b) const { return reduce(mulHigh64(a, b), a * b); }
+    // any a: a * r2 < 2^64 * m, so reduce() needs no a % m first
+    constexpr uint64_t toForm(uint64_t a) const { return multiply(a, r2); }
+    constexpr uint64_t fromForm(uint64_t a) const { return reduce(0, a); }
+
+    // b^e with b and the result in the form
+    constexpr uint64_t powInForm(uint64_t b, uint64_t e) const
+    {
+        uint64_t r = toForm(1);
+        for (; e; e >>= 1) {
+            uint64_t t = multiply(r, b), pick = 0 - (e & 1);
+            r = (t & pick) | (r & ~pick);       // no branch on the bits of e
+            b = multiply(b, b);
+        }
+        return r;
+    }
+
+    // a^e mod m, in [0, m)
+    constexpr uint64_t pow(uint64_t a, uint64_t e) const { return fromForm(powInForm(toForm(a), e)); }
+};
+
+// a^e mod m for m > 0, in [0, m): Montgomery for an odd m, the 128-bit
+// products of mulMod64() for an even one
+constexpr uint64_t powMod64(uint64_t a, uint64_t e, uint64_t m)
+{
+    if (m == 1) return 0;
+    if (m & 1) return Montgomery(m).pow(a, e);
+
+    uint64_t r = 1, b = a % m;
+    for (; e; e >>= 1) {
+        if (e & 1) r = mulMod64(r, b, m);
+        b = mulMod64(b, b, m);
+    }
+    return r;
+}
+
+// ================= FIXED MODULUS =================
+// Remainders by an m known ahead of time, as in modular mode
+// (Calculator::setModulus()): the divide is traded for a multiply by a
+// precomputed reciprocal.
+
+// Barrett reduction in the form of Moller and Granlund's 2-by-1 division:
+// m is shifted up until its top bit is set (d), and v = floor((2^128 - 1)
+// / d) - 2^64 estimates the quotient with two multiplies, off by at most
+// one each way, which two compare-and-adjusts fix.
+struct Barrett {
+    uint64_t m;
+    uint64_t d;     // m << shift
+    uint64_t v;
+    int shift;
+
+    constexpr explicit Barrett(uint64_t modulus)    // > 0
+        : m(modulus), d(modulus << std::countl_zero(modulus)), v(0), shift(std::countl_zero(modulus))
+    {
+        // (2^128 - 1) / d - 2^64 is (~d : ~0) / d, and ~d < d
+        uint64_t rem = 0;
+        v = divide128(~d, ~0ULL, d, rem);
+    }
+
+    // (hi:lo) mod m, for hi < m
+    constexpr uint64_t reduce(uint64_t hi, uint64_t lo) const
+    {
+        uint64_t u1 = shift ? hi << shift | lo >> (64 - shift) : hi;
+        uint64_t u0 = lo << shift;
+
+        uint64_t q0 = v * u1 + u0;
+        uint64_t q1 = mulHigh64(v, u1) + u1 + 1 + (q0 < u0);
+        uint64_t r = u0 - q1 * d;
+        r += r > q0 ? d : 0;
+        r -= r >= d ? d : 0;
+        return r >> shift;
+    }
+
+    constexpr uint64_t reduce(uint64_t x) const { return reduce(0, x); }
+
+    // for a, b < m, so the high limb of the product is below m
+    constexpr uint64_t multiply(uint64_t a, uint64_t b) const { return reduce(mulHigh64(a, b), a * b); }
+};
+
+// The ring Z/m for modular mode, all constants worked out up front:
+// operands are brought to [0, m) with Barrett, products use Barrett too and
+// powers run in Montgomery form when m is odd. None of them divides.
+struct Modulus {
+    Barrett barrett;
+    Montgomery mont;    // of m when it is odd, else unused
+    bool odd;
+
+    explicit Modulus(uint64_t m)    // > 0
+        : barrett(m), mont(m & 1 ? m : 1), odd((m & 1) && m > 1) {}
+
+    uint64_t value() const { return barrett.m; }
+
+    // the least non-negative residue of a signed value; a result fed back
+    // in is one already
+    uint64_t residue(int64_t a) const
+    {
+        if (static_cast<uint64_t>(a) < barrett.m)
+            return static_cast<uint64_t>(a);
+        uint64_t r = barrett.reduce(a < 0 ? 0 - static_cast<uint64_t>(a) : static_cast<uint64_t>(a));
+        return a < 0 && r ? barrett.m - r : r;
+    }
+
+    // on residues
+    uint64_t add(uint64_t a, uint64_t b) const
+    {
+        const uint64_t m = barrett.m;
+        return a >= m - b ? a - (m - b) : a + b;
+    }
+
+    uint64_t subtract(uint64_t a, uint64_t b) const
+    {
+        return a >= b ? a - b : a + (barrett.m - b);
+    }
+
+    uint64_t multiply(uint64_t a, uint64_t b) const { return barrett.multiply(a, b); }
+
+    uint64_t pow(uint64_t a, uint64_t e) const
+    {
+        if (odd)
+            return mont.pow(a, e);
+
+        uint64_t r = barrett.reduce(1);
+        for (; e; e >>= 1) {
+            uint64_t t = multiply(r, a), pick = 0 - (e & 1);
+            r = (t & pick) | (r & ~pick);
+            a = multiply(a, a);
+        }
+        return r;
+    }
+};
+
+} // namespace wordops
+
+
+// Runtime dispatch: one table per word size, picked when the word size
+// changes so the ops themselves never branch on it.
+struct WordOps {
+    WordSize size;
+    int bits;
+    uint64_t mask;
+
+    int64_t (*signExtend)(uint64_t);
+
+    int64_t (*add)(int64_t, int64_t);
+    int64_t (*subtract)(int64_t, int64_t);
+    int64_t (*multiply)(int64_t, int64_t);
+    int64_t (*divide)(int64_t, int64_t);
+    int64_t (*mod)(int64_t, int64_t);
+
+    int64_t (*bitAnd)(int64_t, int64_t);
+    int64_t (*bitOr)(int64_t, int64_t);
+    int64_t (*bitXor)(int64_t, int64_t);
+    int64_t (*bitNot)(int64_t);
+
+    int64_t (*shl)(int64_t, int);
+    int64_t (*shr)(int64_t, int);
+    int64_t (*rol)(int64_t, int);
+    int64_t (*ror)(int64_t, int);
+
+    int64_t (*popcount)(int64_t);
+    int64_t (*parity)(int64_t);
+    int64_t (*clz)(int64_t);
+    int64_t (*ctz)(int64_t);
+    int64_t (*highestBit)(int64_t);
+    int64_t (*lowestBit)(int64_t);
+    int64_t (*bswap)(int64_t);
+    int64_t (*bitReverse)(int64_t);
+    int64_t (*pdep)(int64_t, int64_t);
+    int64_t (*pext)(int64_t, int64_t);
+    int64_t (*blsr)(int64_t);
+    int64_t (*blsi)(int64_t);
+
+    wordops::Flagged (*adc)(int64_t, int64_t, bool);
+    wordops::Flagged (*sbb)(int64_t, int64_t, bool);
+    wordops::Flagged (*imul)(int64_t, int64_t);
+    HiLo (*mulHiLo)(int64_t, int64_t);
+    HiLo (*imulHiLo)(int64_t, int64_t);
+    wordops::Flagged (*ipow)(int64_t, uint64_t);
+};
+
+template <WordSize W>
+inline constexpr WordOps wordOpsTable = {
+    W, wordops::bits<W>, wordops::mask<W>(),
+    wordops::signExtend<W>,
+    wordops::add<W>, wordops::subtract<W>, wordops::multiply<W>,
+    wordops::divide<W>, wordops::mod<W>,
+    wordops::bitAnd<W>, wordops::bitOr<W>, wordops::bitXor<W>, wordops::bitNot<W>,
+    wordops::shl<W>, wordops::shr<W>, wordops::rol<W>, wordops::ror<W>,
+    wordops::popcount<W>, wordops::parity<W>, wordops::clz<W>, wordops::ctz<W>,
+    wordops::highestBit<W>, wordops::lowestBit<W>,
+    wordops::bswap<W>, wordops::bitReverse<W>, wordops::pdep<W>, wordops::pext<W>,
+    wordops::blsr<W>, wordops::blsi<W>,
+    wordops::adc<W>, wordops::sbb<W>, wordops::imul<W>,
+    wordops::mulHiLo<W>, wordops::imulHiLo<W>,
+    wordops::ipow<W>,
+};
+
+const WordOps& wordOpsFor(WordSize w);